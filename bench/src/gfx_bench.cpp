@@ -0,0 +1,377 @@
+// Headless benchmarks for the renderer and the math helpers.
+//
+//   gfx_bench [--filter TEXT] [--min-time SECONDS] [--font FILE] [--out FILE]
+//
+// Runs on SDL's dummy video driver with the software renderer unless
+// SDL_VIDEODRIVER / SDL_RENDER_DRIVER say otherwise, so it needs no display
+// or GPU. Results are written as JSON to stdout (or --out) and as a table to
+// stderr. Text cases are skipped without --font.
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "gfx/gfx.h"
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+constexpr int window_width  = 640;
+constexpr int window_height = 480;
+
+constexpr std::array<size_t, 4> primitive_counts{100, 1000, 10000, 100000};
+constexpr std::array<size_t, 4> shape_counts{10, 100, 1000, 10000};
+constexpr std::array<size_t, 3> sprite_counts{100, 1000, 10000};
+constexpr std::array<size_t, 3> text_counts{1, 10, 100};
+constexpr std::array<size_t, 3> label_counts{10, 100, 1000};
+constexpr std::array<size_t, 3> math_counts{1000, 100000, 1000000};
+constexpr std::array<size_t, 3> particle_counts{10000, 100000, 1000000};
+
+template <typename T> void keep(T const &value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static_cast<void>(value);
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+struct result {
+    std::string name;
+    size_t      count;
+    size_t      iterations;
+    double      ns_per_iteration;
+};
+
+class runner {
+    std::string         m_filter;
+    double              m_min_time;
+    std::vector<result> m_results;
+
+  public:
+    runner(std::string filter, double min_time)
+        : m_filter{std::move(filter)}, m_min_time{min_time} {}
+
+    // Times body, which processes count objects, until min_time has passed.
+    template <typename F>
+    void run(std::string const &name, size_t count, F &&body) {
+        if(!m_filter.empty() && name.find(m_filter) == std::string::npos) {
+            return;
+        }
+        body();
+
+        size_t                        iterations = 0;
+        std::chrono::duration<double> elapsed{};
+        auto                          start = clock_type::now();
+        do {
+            body();
+            ++iterations;
+            elapsed = clock_type::now() - start;
+        } while(elapsed.count() < m_min_time);
+
+        auto ns = elapsed.count() * 1e9 / static_cast<double>(iterations);
+        m_results.push_back({name, count, iterations, ns});
+        fmt::print(stderr, "{:<28} {:>8} {:>14.0f} ns/iter {:>10.2f} ns/obj\n",
+                   name, count, ns, ns / static_cast<double>(count));
+    }
+
+    void write_json(std::FILE *out) const {
+        fmt::print(out, "{{\"benchmarks\": [");
+        for(size_t i = 0; i < m_results.size(); ++i) {
+            auto const &r = m_results[i];
+            fmt::print(out,
+                       "{}\n  {{\"name\": \"{}\", \"count\": {}, "
+                       "\"iterations\": {}, \"ns_per_iteration\": {:.1f}, "
+                       "\"ns_per_object\": {:.3f}}}",
+                       i == 0 ? "" : ",", r.name, r.count, r.iterations,
+                       r.ns_per_iteration,
+                       r.ns_per_iteration / static_cast<double>(r.count));
+        }
+        fmt::print(out, "\n]}}\n");
+    }
+};
+
+struct options {
+    std::string filter;
+    std::string font;
+    std::string out;
+    double      min_time{0.25};
+};
+
+auto parse(int argc, char **argv) -> options {
+    options opts;
+    for(int i = 1; i + 1 < argc; i += 2) {
+        std::string_view flag{argv[i]};
+        std::string      value{argv[i + 1]};
+        if(flag == "--filter") {
+            opts.filter = value;
+        } else if(flag == "--font") {
+            opts.font = value;
+        } else if(flag == "--out") {
+            opts.out = value;
+        } else if(flag == "--min-time") {
+            opts.min_time = std::stod(value);
+        } else {
+            throw std::runtime_error{fmt::format("unknown option {}", flag)};
+        }
+    }
+    return opts;
+}
+
+// Makes SDL run the queued commands, since the software renderer batches
+// them internally until the next present or flush, and ends the frame so
+// textures released during it don't pile up.
+void finish(gfx::renderer &r) {
+    r.flush();
+    SDL_RenderFlush(r.get_sdl_renderer());
+    r.end_frame();
+}
+
+template <typename T>
+auto random_points(std::mt19937 &rng, size_t n, T width, T height)
+    -> std::vector<vec2d_t<T>> {
+    std::uniform_real_distribution<double> x{0, static_cast<double>(width)};
+    std::uniform_real_distribution<double> y{0, static_cast<double>(height)};
+    std::vector<vec2d_t<T>>                points;
+    points.reserve(n);
+    for(size_t i = 0; i < n; ++i) {
+        points.push_back({static_cast<T>(x(rng)), static_cast<T>(y(rng))});
+    }
+    return points;
+}
+
+void bench_primitives(runner &bench, gfx::renderer &r, std::mt19937 &rng) {
+    for(size_t n : primitive_counts) {
+        auto points =
+            random_points<int>(rng, n, window_width, window_height);
+        for(bool batched : {false, true}) {
+            auto suffix = batched ? "/batched" : "";
+            r.set_batching(batched);
+            bench.run(fmt::format("draw_point{}", suffix), n, [&] {
+                for(auto const &p : points) {
+                    r.draw_point(p);
+                }
+                finish(r);
+            });
+            bench.run(fmt::format("draw_line{}", suffix), n, [&] {
+                for(size_t i = 1; i < points.size(); ++i) {
+                    r.draw_line(points[i - 1], points[i]);
+                }
+                finish(r);
+            });
+        }
+        r.set_batching(false);
+
+        std::vector<SDL_FPoint> strip;
+        for(auto const &p : points) {
+            strip.push_back(
+                {static_cast<float>(p.x), static_cast<float>(p.y)});
+        }
+        bench.run("draw_lines", n, [&] {
+            r.draw_lines(std::span<SDL_FPoint const>{strip});
+            finish(r);
+        });
+    }
+
+    for(size_t n : shape_counts) {
+        auto centers =
+            random_points<double>(rng, n, window_width, window_height);
+        bench.run("draw_circle", n, [&] {
+            for(auto const &c : centers) {
+                r.draw_circle(c, 20.0);
+            }
+            finish(r);
+        });
+
+        std::vector<gfx::circle_instance> circles;
+        for(auto const &c : centers) {
+            circles.push_back({c, 20.0, {255, 255, 255}});
+        }
+        rect_t<double> view{0, 0, window_width, window_height};
+        bench.run("fill_circles", n, [&] {
+            r.fill_circles(circles, view);
+            finish(r);
+        });
+    }
+}
+
+void bench_textures(runner &bench, gfx::renderer &r, std::mt19937 &rng) {
+    gfx::texture   sprite{r.get_sdl_renderer(), 32, 32};
+    rect_t<double> view{0, 0, window_width, window_height};
+    for(size_t n : sprite_counts) {
+        auto positions =
+            random_points<double>(rng, n, window_width, window_height);
+        bench.run("draw_texture", n, [&] {
+            for(auto const &p : positions) {
+                r.draw_texture(sprite, p, view);
+            }
+            finish(r);
+        });
+    }
+}
+
+void bench_text(runner &bench, gfx::renderer &r, std::string const &file) {
+    gfx::font font{file, 16};
+    auto      white = gfx::color{255, 255, 255};
+    for(size_t n : text_counts) {
+        bench.run("draw_wrapped_text", n, [&] {
+            for(size_t i = 0; i < n; ++i) {
+                r.draw_wrapped_text(font, "The quick brown fox jumps over",
+                                    vec2d_t<int>{10, 10}, 200, white);
+            }
+            finish(r);
+        });
+    }
+    for(size_t n : label_counts) {
+        std::vector<std::string> strings;
+        for(size_t i = 0; i < n; ++i) {
+            strings.push_back(fmt::format("Label number {}", i));
+        }
+        bench.run("text_to_texture/hit", n, [&] {
+            for(auto const &s : strings) {
+                keep(r.text_to_texture<int>(font, s.c_str(), white));
+            }
+        });
+        bench.run("text_to_texture/miss", n, [&] {
+            r.get_text_cache().clear();
+            for(auto const &s : strings) {
+                keep(r.text_to_texture<int>(font, s.c_str(), white));
+            }
+        });
+    }
+}
+
+void bench_particles(runner &bench, gfx::renderer &r) {
+    gfx::particle_settings settings;
+    settings.position        = {window_width / 2.0F, window_height / 2.0F};
+    settings.spread          = {window_width / 2.0F, window_height / 2.0F};
+    settings.velocity_stddev = 20;
+    settings.acceleration    = {0, 10};
+    // Long enough that nothing dies while a case runs.
+    settings.lifetime = 1e6F;
+
+    gfx::thread_pool pool;
+    rect_t<double>   view{0, 0, window_width, window_height};
+    for(size_t n : particle_counts) {
+        gfx::particle_emitter emitter{n, settings};
+        emitter.emit(n);
+        bench.run("particles/update", n, [&] { emitter.update(1 / 60.0F); });
+        bench.run("particles/update/threads", n,
+                  [&] { emitter.update(1 / 60.0F, &pool); });
+        bench.run("particles/draw", n, [&] {
+            emitter.draw(r, view, &pool);
+            finish(r);
+        });
+    }
+}
+
+void bench_surfaces(runner &bench, std::mt19937 &rng) {
+    gfx::surface source{32, 32};
+    auto         target = std::make_shared<gfx::surface>(1024, 1024);
+    for(size_t n : sprite_counts) {
+        auto positions = random_points<int>(rng, n, 1024 - 32, 1024 - 32);
+        bench.run("surface::blit_onto", n, [&] {
+            for(auto const &p : positions) {
+                source.blit_onto(target, p.x, p.y);
+            }
+        });
+    }
+}
+
+void bench_math(runner &bench, std::mt19937 &rng) {
+    rect_t<double> view{100, 50, 800, 600};
+    for(size_t n : math_counts) {
+        auto a = random_points<double>(rng, n, 1000, 1000);
+        auto b = random_points<double>(rng, n, 1000, 1000);
+        std::vector<vec2d_t<double>> out(n);
+
+        bench.run("vec2d", n, [&] {
+            double total = 0;
+            for(size_t i = 0; i < n; ++i) {
+                auto v = (a[i] - b[i]) * 0.5 + b[i];
+                total  += v.mag();
+            }
+            keep(total);
+        });
+        bench.run("world_to_window/scalar", n, [&] {
+            for(size_t i = 0; i < n; ++i) {
+                out[i] = gfx::world_to_window(a[i], view, window_width);
+            }
+            keep(out);
+        });
+        bench.run("world_to_window/span", n, [&] {
+            gfx::world_to_window(std::span<vec2d_t<double> const>{a},
+                                 std::span<vec2d_t<double>>{out}, view,
+                                 window_width);
+            keep(out);
+        });
+
+        gfx::random_engine engine{42};
+        bench.run("random/distribution", n, [&] {
+            std::uniform_real_distribution<double> dist{0, 1000};
+            for(auto &v : out) {
+                v = {dist(engine), dist(engine)};
+            }
+            keep(out);
+        });
+        bench.run("random/fill_uniform", n, [&] {
+            engine.fill_uniform(std::span<vec2d_t<double>>{out}, {0, 0},
+                                {1000, 1000});
+            keep(out);
+        });
+    }
+}
+
+} // namespace
+
+auto main(int argc, char **argv) -> int {
+    try {
+        auto opts = parse(argc, argv);
+
+        SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+        SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+        gfx::gfx     context;
+        auto         win = gfx::create_window("gfx_bench", window_width,
+                                              window_height, false,
+                                              SDL_WINDOW_HIDDEN);
+        auto        &r   = win->get_renderer();
+        std::mt19937 rng{42};
+        runner       bench{opts.filter, opts.min_time};
+
+        bench_primitives(bench, r, rng);
+        bench_textures(bench, r, rng);
+        if(!opts.font.empty()) {
+            bench_text(bench, r, opts.font);
+        }
+        bench_particles(bench, r);
+        bench_surfaces(bench, rng);
+        bench_math(bench, rng);
+
+        std::FILE *out = stdout;
+        if(!opts.out.empty()) {
+            out = std::fopen(opts.out.c_str(), "w");
+            if(out == nullptr) {
+                throw std::runtime_error{
+                    fmt::format("couldn't open {}", opts.out)};
+            }
+        }
+        bench.write_json(out);
+        if(out != stdout) {
+            std::fclose(out);
+        }
+    } catch(std::exception const &e) {
+        fmt::print(stderr, "gfx_bench: {}\n", e.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
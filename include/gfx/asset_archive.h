@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace gfx {
+
+class mapped_file;
+class renderer;
+class surface;
+class texture;
+
+// An image in an archive as tightly packed RGBA32 rows.
+struct archive_image {
+    int                        width{};
+    int                        height{};
+    std::span<std::byte const> pixels;
+};
+
+// Images packed ahead of time (see tools/gfx_pack), already decoded to
+// RGBA32 and either stored as is or LZ4-compressed. The file is mapped and
+// its index searched in place, so opening it only touches the index, and
+// uncompressed images go from the mapping to SDL without being copied.
+class asset_archive {
+    std::shared_ptr<mapped_file const> m_file;
+    size_t                             m_count{};
+    std::string_view                   m_names;
+
+    struct entry;
+    [[nodiscard]] auto get_entry(size_t i) const -> entry;
+    [[nodiscard]] auto find(std::string_view name) const
+        -> std::optional<entry>;
+    [[nodiscard]] auto at(std::string_view name) const -> entry;
+
+  public:
+    explicit asset_archive(std::string const &path);
+
+    [[nodiscard]] auto size() const -> size_t { return m_count; }
+    // Names are sorted.
+    [[nodiscard]] auto name(size_t i) const -> std::string_view;
+    [[nodiscard]] auto contains(std::string_view name) const -> bool;
+    [[nodiscard]] auto is_compressed(std::string_view name) const -> bool;
+
+    // The pixels point into the mapping unless the image is compressed, in
+    // which case they are decompressed into scratch.
+    [[nodiscard]] auto read(std::string_view name,
+                            std::vector<std::byte> &scratch) const
+        -> archive_image;
+
+    // Uncompressed images share the archive's memory, which is read-only:
+    // the surface can be blitted or uploaded but not drawn onto.
+    [[nodiscard]] auto load_surface(std::string_view name) const
+        -> std::shared_ptr<surface>;
+    [[nodiscard]] auto load_texture(renderer &r, std::string_view name) const
+        -> std::shared_ptr<texture>;
+};
+
+// Builds an archive, e.g. at build time from the game's image files.
+class archive_writer {
+    struct pending_image {
+        std::string            name;
+        int                    width;
+        int                    height;
+        std::vector<std::byte> pixels;
+    };
+
+    std::vector<pending_image> m_images;
+
+  public:
+    // pixels are tightly packed RGBA32 rows.
+    void add(std::string name, int width, int height,
+             std::span<std::byte const> pixels);
+    // Converted to RGBA32 first if needed.
+    void add(std::string name, surface const &image);
+
+    // Compression needs gfx built with LZ4, and is skipped for images it
+    // doesn't make smaller.
+    void save(std::string const &path, bool compress = false) const;
+
+    [[nodiscard]] auto size() const -> size_t { return m_images.size(); }
+
+    [[nodiscard]] static auto can_compress() -> bool;
+};
+
+} // namespace gfx
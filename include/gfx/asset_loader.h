@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "font.h"
+#include "surface.h"
+#include "texture.h"
+#include "thread_pool.h"
+
+namespace gfx {
+
+class renderer;
+
+struct loader_stats {
+    size_t total{};
+    size_t decoding{};
+    size_t awaiting_upload{};
+    size_t completed{};
+    size_t failed{};
+
+    [[nodiscard]] auto progress() const -> double {
+        return total == 0 ? 1.0
+                          : static_cast<double>(completed + failed) /
+                                static_cast<double>(total);
+    }
+};
+
+// Decodes images and opens fonts on worker threads. Textures need the
+// renderer, so decoded images wait until upload_pending() is called on the
+// render thread, which spends at most the given budget per call.
+class asset_loader {
+    struct upload {
+        std::shared_ptr<surface>                                pixels;
+        std::shared_ptr<std::promise<std::shared_ptr<texture>>> promise;
+    };
+
+    std::mutex          m_upload_mutex;
+    std::deque<upload>  m_uploads;
+    std::atomic<size_t> m_total{0};
+    std::atomic<size_t> m_decoding{0};
+    std::atomic<size_t> m_completed{0};
+    std::atomic<size_t> m_failed{0};
+
+    // Declared last so its workers are joined before anything they use goes.
+    thread_pool m_pool;
+
+  public:
+    explicit asset_loader(size_t threads = thread_pool::default_thread_count())
+        : m_pool{threads} {}
+
+    auto load_surface(std::string file_name)
+        -> std::shared_future<std::shared_ptr<surface>>;
+    auto load_texture(std::string file_name)
+        -> std::shared_future<std::shared_ptr<texture>>;
+    auto load_font(std::string file_name, int size)
+        -> std::shared_future<std::shared_ptr<font>>;
+
+    // Creates textures for decoded images until the budget is spent, always
+    // at least one if any are waiting. Returns how many were uploaded.
+    auto upload_pending(renderer &r, std::chrono::microseconds budget)
+        -> size_t;
+
+    [[nodiscard]] auto get_stats() -> loader_stats;
+    [[nodiscard]] auto idle() -> bool;
+};
+
+} // namespace gfx
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <SDL.h>
+
+#include "surface.h"
+#include "texture.h"
+
+namespace gfx {
+
+class renderer;
+
+// Bottom-left skyline packer for one fixed-size page.
+class skyline_packer {
+    struct segment {
+        int x;
+        int y;
+        int width;
+    };
+
+    int                  m_width;
+    int                  m_height;
+    std::vector<segment> m_skyline;
+
+  public:
+    skyline_packer(int width, int height);
+
+    // Position of the packed rectangle, or nullopt if it doesn't fit.
+    [[nodiscard]] auto insert(int width, int height) -> std::optional<SDL_Point>;
+    void reset();
+};
+
+struct atlas_entry {
+    std::string name;
+    uint32_t    page{};
+    SDL_Rect    bounds{};
+};
+
+// Where every image went, which can be written at build time and loaded at
+// startup instead of packing again.
+struct atlas_layout {
+    int                      page_size{};
+    uint32_t                 page_count{};
+    std::vector<atlas_entry> entries;
+
+    void save(std::string const &file_name) const;
+    [[nodiscard]] static auto load(std::string const &file_name)
+        -> atlas_layout;
+};
+
+class texture_atlas {
+    std::vector<texture>                            m_pages;
+    std::unordered_map<std::string, texture_region> m_regions;
+
+    friend class atlas_builder;
+
+  public:
+    [[nodiscard]] auto region(std::string const &name) const -> texture_region;
+    [[nodiscard]] auto contains(std::string const &name) const -> bool {
+        return m_regions.contains(name);
+    }
+
+    [[nodiscard]] auto page_count() const -> size_t { return m_pages.size(); }
+    [[nodiscard]] auto get_page(size_t page) const -> texture const & {
+        return m_pages[page];
+    }
+};
+
+class atlas_builder {
+    constexpr static int default_page_size = 2048;
+
+    struct image {
+        std::string              name;
+        std::shared_ptr<surface> pixels;
+    };
+
+    int                m_page_size;
+    int                m_padding;
+    std::vector<image> m_images;
+
+  public:
+    explicit atlas_builder(int page_size = default_page_size, int padding = 1)
+        : m_page_size{page_size}, m_padding{padding} {}
+
+    void add(std::string name, std::shared_ptr<surface> pixels) {
+        m_images.push_back({std::move(name), std::move(pixels)});
+    }
+
+    // Loads the file and adds it under its file name.
+    void add_file(std::string const &file_name);
+
+    [[nodiscard]] auto pack() const -> atlas_layout;
+
+    // Packs, then blits every image into RGBA32 pages and uploads each page
+    // once. The second form reuses a layout from pack() and skips packing.
+    [[nodiscard]] auto build(renderer &r) const -> texture_atlas;
+    [[nodiscard]] auto build(renderer &r, atlas_layout const &layout) const
+        -> texture_atlas;
+};
+
+} // namespace gfx
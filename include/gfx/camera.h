@@ -0,0 +1,133 @@
+#pragma once
+
+#include <span>
+
+#include "rect.h"
+#include "vec2d.h"
+
+namespace gfx {
+
+// out[i] = (in[i] - origin) * scale + offset over whole arrays. The origin
+// is subtracted first, so positions close to each other but far from the
+// world origin keep their precision in float. Uses SSE2 where the target
+// has it, and AVX where the target has it or, on GCC and Clang for x86,
+// where the CPU running the code does. The vec2d_t forms take interleaved
+// (x, y) pairs, the scalar forms one coordinate axis of a
+// structure-of-arrays layout.
+void scale_offset(std::span<vec2d_t<double> const> in,
+                  std::span<vec2d_t<double>> out, vec2d_t<double> origin,
+                  double scale, vec2d_t<double> offset);
+void scale_offset(std::span<vec2d_t<float> const> in,
+                  std::span<vec2d_t<float>> out, vec2d_t<float> origin,
+                  float scale, vec2d_t<float> offset);
+void scale_offset(std::span<double const> in, std::span<double> out,
+                  double origin, double scale, double offset);
+void scale_offset(std::span<float const> in, std::span<float> out,
+                  float origin, float scale, float offset);
+
+// A view and window width with the zoom and offset between world and window
+// coordinates worked out once.
+class camera {
+    rect_t<double> m_view;
+    double         m_window_width{};
+    double         m_zoom{1};
+
+    void update() { m_zoom = m_window_width / m_view.size.x; }
+
+  public:
+    camera(rect_t<double> view, double window_width)
+        : m_view{view}, m_window_width{window_width} {
+        update();
+    }
+
+    void set_view(rect_t<double> view) {
+        m_view = view;
+        update();
+    }
+
+    void set_window_width(double window_width) {
+        m_window_width = window_width;
+        update();
+    }
+
+    [[nodiscard]] auto get_view() const -> rect_t<double> const & {
+        return m_view;
+    }
+    [[nodiscard]] auto get_window_width() const -> double {
+        return m_window_width;
+    }
+    [[nodiscard]] auto zoom() const -> double { return m_zoom; }
+
+    [[nodiscard]] auto world_to_window(vec2d_t<double> world) const
+        -> vec2d_t<double> {
+        return (world - m_view.position) * m_zoom;
+    }
+
+    [[nodiscard]] auto window_to_world(vec2d_t<double> window) const
+        -> vec2d_t<double> {
+        return window / m_zoom + m_view.position;
+    }
+
+    void world_to_window(std::span<vec2d_t<double> const> world,
+                         std::span<vec2d_t<double>>       window) const {
+        scale_offset(world, window, m_view.position, m_zoom, {0, 0});
+    }
+
+    void world_to_window(std::span<vec2d_t<float> const> world,
+                         std::span<vec2d_t<float>>       window) const {
+        scale_offset(world, window,
+                     static_cast<vec2d_t<float>>(m_view.position),
+                     static_cast<float>(m_zoom), {0, 0});
+    }
+
+    void world_to_window(std::span<double const> world_x,
+                         std::span<double const> world_y,
+                         std::span<double> window_x,
+                         std::span<double> window_y) const {
+        scale_offset(world_x, window_x, m_view.position.x, m_zoom, 0);
+        scale_offset(world_y, window_y, m_view.position.y, m_zoom, 0);
+    }
+
+    void world_to_window(std::span<float const> world_x,
+                         std::span<float const> world_y,
+                         std::span<float> window_x,
+                         std::span<float> window_y) const {
+        auto zoom = static_cast<float>(m_zoom);
+        scale_offset(world_x, window_x, static_cast<float>(m_view.position.x),
+                     zoom, 0);
+        scale_offset(world_y, window_y, static_cast<float>(m_view.position.y),
+                     zoom, 0);
+    }
+
+    void window_to_world(std::span<vec2d_t<double> const> window,
+                         std::span<vec2d_t<double>>       world) const {
+        scale_offset(window, world, {0, 0}, 1 / m_zoom, m_view.position);
+    }
+
+    void window_to_world(std::span<vec2d_t<float> const> window,
+                         std::span<vec2d_t<float>>       world) const {
+        scale_offset(window, world, {0, 0}, static_cast<float>(1 / m_zoom),
+                     static_cast<vec2d_t<float>>(m_view.position));
+    }
+
+    void window_to_world(std::span<double const> window_x,
+                         std::span<double const> window_y,
+                         std::span<double> world_x,
+                         std::span<double> world_y) const {
+        scale_offset(window_x, world_x, 0, 1 / m_zoom, m_view.position.x);
+        scale_offset(window_y, world_y, 0, 1 / m_zoom, m_view.position.y);
+    }
+
+    void window_to_world(std::span<float const> window_x,
+                         std::span<float const> window_y,
+                         std::span<float> world_x,
+                         std::span<float> world_y) const {
+        auto scale = static_cast<float>(1 / m_zoom);
+        scale_offset(window_x, world_x, 0, scale,
+                     static_cast<float>(m_view.position.x));
+        scale_offset(window_y, world_y, 0, scale,
+                     static_cast<float>(m_view.position.y));
+    }
+};
+
+} // namespace gfx
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+
+#include <SDL.h>
+
+#include "color.h"
+#include "vec2d.h"
+
+namespace gfx {
+
+constexpr size_t min_circle_segments = 8;
+constexpr size_t max_circle_segments = 256;
+
+constexpr double default_circle_tolerance = 0.25;
+
+// The smallest segment count, clamped to [min, max]_circle_segments, for
+// which the polygon stays within tolerance pixels of the true circle.
+[[nodiscard]] auto circle_segments(double pixel_radius,
+                                   double tolerance = default_circle_tolerance)
+    -> size_t;
+
+// Points on the unit circle for the given segment count (at least 1), with
+// the first point repeated at the end. Tables up to max_circle_segments are
+// computed once and live for the rest of the program; larger counts are
+// computed on every call into a per-thread buffer that stays valid until the
+// next such call on the same thread.
+[[nodiscard]] auto unit_circle(size_t segments) -> std::span<SDL_FPoint const>;
+
+struct circle_instance {
+    vec2d_t<double> center;
+    double          radius{};
+    color           fill;
+};
+
+} // namespace gfx
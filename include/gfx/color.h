@@ -30,7 +30,13 @@ struct color {
         return {r, g, b, alpha};
     }
 
-    [[nodiscard]] auto get_sdl_color() -> SDL_Color {
+    [[nodiscard]] constexpr auto packed() const -> uint32_t {
+        return static_cast<uint32_t>(r) << 24U |
+               static_cast<uint32_t>(g) << 16U |
+               static_cast<uint32_t>(b) << 8U | static_cast<uint32_t>(a);
+    }
+
+    [[nodiscard]] auto get_sdl_color() const -> SDL_Color {
         return SDL_Color{r, g, b, a};
     }
 };
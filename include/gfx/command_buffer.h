@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <SDL.h>
+
+#include "color.h"
+#include "render_state.h"
+
+namespace gfx {
+
+enum class command_kind : uint8_t { point, strip, geometry };
+
+struct draw_command {
+    SDL_Texture  *target{};
+    SDL_Texture  *texture{};
+    SDL_BlendMode blend{SDL_BLENDMODE_BLEND};
+    color         draw_color;
+    command_kind  kind{};
+    uint32_t      first{};
+    uint32_t      count{};
+    uint32_t      first_index{};
+    uint32_t      index_count{};
+};
+
+struct batch_stats {
+    size_t recorded_calls{};
+    size_t submitted_calls{};
+    size_t flushes{};
+
+    [[nodiscard]] auto saved_calls() const -> size_t {
+        return recorded_calls > submitted_calls
+                   ? recorded_calls - submitted_calls
+                   : 0;
+    }
+};
+
+// Records draw primitives and submits them in as few SDL calls as possible.
+// Consecutive commands with the same target, blend mode, kind, texture and
+// color are merged into one call, so nothing is ever drawn out of the order
+// it was recorded in. Lines are submitted as thin quads, so that a run of
+// them is one call whether or not they join up. Textures that commands
+// draw or target have to outlive the submission.
+class command_buffer {
+    std::vector<draw_command> m_commands;
+    std::vector<SDL_FPoint>   m_points;
+    std::vector<SDL_Vertex>   m_vertices;
+    std::vector<int>          m_indices;
+
+    std::vector<SDL_FPoint> m_point_scratch;
+    std::vector<uint32_t>   m_strip_ends;
+    std::vector<SDL_Vertex> m_vertex_scratch;
+    std::vector<int>        m_index_scratch;
+
+    SDL_Texture  *m_target{};
+    SDL_BlendMode m_blend{SDL_BLENDMODE_BLEND};
+    color         m_color;
+    bool          m_synced{false};
+    batch_stats   m_stats;
+
+    void push(command_kind kind, SDL_Texture *texture, uint32_t first,
+              uint32_t count, uint32_t first_index = 0,
+              uint32_t index_count = 0);
+    void append_line_quad(SDL_FPoint a, SDL_FPoint b, SDL_Color c,
+                          bool cap_start, bool cap_end);
+
+  public:
+    void set_color(color const &c) {
+        m_color  = c;
+        m_synced = false;
+        ++m_stats.recorded_calls;
+    }
+
+    void set_blend_mode(SDL_BlendMode blend) {
+        m_blend  = blend;
+        m_synced = false;
+        ++m_stats.recorded_calls;
+    }
+
+    void set_target(SDL_Texture *target) {
+        m_target = target;
+        m_synced = false;
+        ++m_stats.recorded_calls;
+    }
+
+    [[nodiscard]] auto get_color() const -> color { return m_color; }
+    [[nodiscard]] auto get_blend_mode() const -> SDL_BlendMode {
+        return m_blend;
+    }
+    [[nodiscard]] auto get_target() const -> SDL_Texture * { return m_target; }
+
+    void record_point(SDL_FPoint point);
+    void record_line(SDL_FPoint from, SDL_FPoint to);
+    void record_lines(std::span<SDL_FPoint const> points);
+    void record_geometry(SDL_Texture                 *texture,
+                         std::span<SDL_Vertex const> vertices,
+                         std::span<int const>        indices = {});
+
+    // Adds other's commands after this buffer's, as if they had been
+    // recorded here. The current color, blend mode and target stay.
+    void append(command_buffer const &other);
+
+    // Submits all recorded commands and leaves the SDL renderer in the
+    // buffer's current color, blend mode and target. State changes go
+    // through state, so ones the renderer is already in are skipped.
+    void submit(render_state &state);
+    void submit(SDL_Renderer *renderer);
+    void clear();
+    // Also goes back to the initial color, blend mode and target.
+    void reset();
+
+    [[nodiscard]] auto empty() const -> bool { return m_commands.empty(); }
+    [[nodiscard]] auto size() const -> size_t { return m_commands.size(); }
+
+    [[nodiscard]] auto get_stats() const -> batch_stats const & {
+        return m_stats;
+    }
+    void reset_stats() { m_stats = {}; }
+};
+
+} // namespace gfx
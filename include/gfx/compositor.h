@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <SDL.h>
+
+#include "rect.h"
+#include "texture.h"
+#include "vec2d.h"
+
+namespace gfx {
+
+class renderer;
+
+// Parts of an area that need redrawing. Rects that overlap or touch are
+// merged as they are added, and past max_rects everything collapses into
+// one bounding rect, so redrawing the list never costs much more than the
+// damage itself.
+class damage_region {
+    rect_t<int>              m_bounds;
+    size_t                   m_max_rects;
+    std::vector<rect_t<int>> m_rects;
+
+  public:
+    constexpr static size_t default_max_rects = 16;
+
+    explicit damage_region(rect_t<int> bounds,
+                           size_t      max_rects = default_max_rects)
+        : m_bounds{bounds}, m_max_rects{max_rects} {}
+
+    // r is clipped to the bounds first.
+    void add(rect_t<int> r);
+    void add_all() { add(m_bounds); }
+    void clear() { m_rects.clear(); }
+
+    [[nodiscard]] auto rects() const -> std::vector<rect_t<int>> const & {
+        return m_rects;
+    }
+    [[nodiscard]] auto empty() const -> bool { return m_rects.empty(); }
+    [[nodiscard]] auto area() const -> int64_t;
+};
+
+class compositor;
+
+// A full-size cached image redrawn through a callback. The callback gets
+// the region being redrawn with the clip rect already set to it, and may
+// skip whatever lies outside.
+class layer {
+    friend class compositor;
+
+  public:
+    using draw_function = std::function<void(renderer &, rect_t<int> const &)>;
+
+  private:
+    draw_function m_draw;
+    texture       m_pixels;
+    damage_region m_damage;
+    bool          m_visible{true};
+    bool          m_visibility_changed{false};
+
+  public:
+    layer(vec2d_t<int> size, draw_function draw)
+        : m_draw{std::move(draw)}, m_damage{{{0, 0}, size}} {
+        m_damage.add_all();
+    }
+
+    void invalidate(rect_t<int> r) { m_damage.add(r); }
+    void invalidate() { m_damage.add_all(); }
+
+    void set_visible(bool visible) {
+        m_visibility_changed = m_visibility_changed || visible != m_visible;
+        m_visible            = visible;
+    }
+    [[nodiscard]] auto is_visible() const -> bool { return m_visible; }
+};
+
+struct compositor_stats {
+    size_t  layers_redrawn{};
+    size_t  regions_redrawn{};
+    int64_t pixels_redrawn{};
+    size_t  regions_composited{};
+};
+
+// Stacks layers bottom to top into an output texture and redraws only what
+// was invalidated: damaged parts of a layer are cleared and passed to its
+// callback, and the same parts of the output are re-blended from the layer
+// caches. compose() then draws the output onto the current target with a
+// single copy. Everything is in target pixels, from the top left corner.
+// Layers and output hold premultiplied alpha and are blended as such, so
+// translucent pixels come out as if drawn directly, except on renderers
+// without custom blend modes like SDL's software renderer.
+class compositor {
+    vec2d_t<int>                        m_size;
+    std::vector<std::unique_ptr<layer>> m_layers;
+    texture                             m_output;
+    damage_region                       m_damage;
+    compositor_stats                    m_stats;
+    bool                                m_premultiplied{false};
+
+    auto make_texture(renderer &r) -> texture;
+    void clear_region(renderer &r, rect_t<int> const &region);
+    void redraw(renderer &r, layer &l);
+    void composite(renderer &r, rect_t<int> const &region);
+
+  public:
+    explicit compositor(vec2d_t<int> size)
+        : m_size{size}, m_damage{{{0, 0}, size}} {}
+
+    // Adds a layer above the existing ones. The reference stays valid for
+    // the compositor's lifetime.
+    auto add_layer(layer::draw_function draw) -> layer &;
+
+    // Redraws every layer, e.g. after SDL reset the render targets.
+    void invalidate();
+
+    void compose(renderer &r);
+
+    [[nodiscard]] auto get_size() const -> vec2d_t<int> { return m_size; }
+    [[nodiscard]] auto layer_count() const -> size_t { return m_layers.size(); }
+    // Whether the renderer took the premultiplied blend mode, known once
+    // something was composed.
+    [[nodiscard]] auto is_premultiplied() const -> bool {
+        return m_premultiplied;
+    }
+
+    // Counts for the last compose().
+    [[nodiscard]] auto get_stats() const -> compositor_stats const & {
+        return m_stats;
+    }
+};
+
+} // namespace gfx
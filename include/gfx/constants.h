@@ -7,7 +7,8 @@ namespace gfx {
 constexpr int default_window_width  = 1024;
 constexpr int default_window_height = 768;
 
-constexpr int bits_per_pixel = 32;
+constexpr int bits_per_pixel  = 32;
+constexpr int bytes_per_pixel = bits_per_pixel / 8;
 
 constexpr static color color_clear{};
 constexpr static color color_red{color::max_value, color::min_value,
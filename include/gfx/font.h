@@ -1,31 +1,84 @@
 #pragma once
 
 #include <SDL2/SDL_ttf.h>
+#include <atomic>
 #include <fmt/core.h>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
 
 namespace gfx {
 
+class mapped_file;
+
+// Fonts can be opened on worker threads, e.g. by asset_loader, and closed
+// on whichever thread drops the last reference. SDL_ttf shares the
+// FreeType library between all fonts, which isn't safe to use from two
+// threads at once, so opening and closing take a process-wide lock. Using
+// one font from several threads still needs the caller's own locking.
 class font {
-    TTF_Font *m_font;
+    TTF_Font *m_font{nullptr};
+    uint64_t  m_id{next_id()};
+    // Where TTF_OpenFontRW() reads the font from as long as it is open.
+    std::shared_ptr<mapped_file const> m_source;
+
+    static auto next_id() -> uint64_t {
+        static std::atomic<uint64_t> counter{0};
+        return ++counter;
+    }
+
+    void close() {
+        if(m_font != nullptr) {
+            std::lock_guard lock{ttf_mutex()};
+            TTF_CloseFont(m_font);
+            m_font = nullptr;
+        }
+    }
 
   public:
     font(font const &)                     = delete;
-    font(font &&)                          = default;
+    font(font &&rhs) noexcept
+        : m_font{std::exchange(rhs.m_font, nullptr)}, m_id{rhs.m_id},
+          m_source{std::move(rhs.m_source)} {}
     auto operator=(font const &) -> font & = delete;
-    auto operator=(font &&) -> font      & = default;
+    auto operator=(font &&rhs) noexcept -> font & {
+        if(this != &rhs) {
+            close();
+            m_font   = std::exchange(rhs.m_font, nullptr);
+            m_id     = rhs.m_id;
+            m_source = std::move(rhs.m_source);
+        }
+        return *this;
+    }
 
-    font(std::string const &file_name, int size)
-        : m_font(TTF_OpenFont(file_name.c_str(), size)) {
+    font(std::string const &file_name, int size) {
+        {
+            std::lock_guard lock{ttf_mutex()};
+            m_font = TTF_OpenFont(file_name.c_str(), size);
+        }
         if(m_font == nullptr) {
             throw std::runtime_error{
                 fmt::format("error opening font: {}", TTF_GetError())};
         }
     }
 
+    // Opens the font from memory, without reading the file again.
+    font(std::shared_ptr<mapped_file const> source, int size,
+         int style = TTF_STYLE_NORMAL);
+
     auto get_ttf_font() -> TTF_Font * { return m_font; }
 
-    ~font() { TTF_CloseFont(m_font); }
+    // Unique for the lifetime of the process, unlike the TTF_Font address.
+    [[nodiscard]] auto get_id() const -> uint64_t { return m_id; }
+
+    ~font() { close(); }
+
+    // Held while SDL_ttf opens or closes a font.
+    static auto ttf_mutex() -> std::mutex & {
+        static std::mutex mutex;
+        return mutex;
+    }
 };
 
 } // namespace gfx
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace gfx {
+
+// Bump allocation for objects that only live until the end of the frame.
+// reset() destroys them all at once and keeps the memory for the next
+// frame, growing the first block to fit what the busiest frame used. The
+// renderer doesn't own one: keep it next to the loop and reset it after
+// present().
+class frame_arena {
+    struct cleanup {
+        void (*destroy)(void *);
+        void *object;
+    };
+
+    std::unique_ptr<std::byte[]>                         m_block;
+    size_t                                               m_capacity;
+    size_t                                               m_used{};
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> m_memory;
+    std::vector<cleanup>                                 m_cleanups;
+
+    // Counts what goes through the arena, to size the next frame's block.
+    class counting_resource : public std::pmr::memory_resource {
+        frame_arena *m_arena;
+
+        auto do_allocate(size_t bytes, size_t alignment) -> void * override {
+            m_arena->m_used += bytes + alignment - 1;
+            return m_arena->m_memory->allocate(bytes, alignment);
+        }
+        void do_deallocate(void * /*p*/, size_t /*bytes*/,
+                           size_t /*alignment*/) override {}
+        [[nodiscard]] auto
+        do_is_equal(std::pmr::memory_resource const &other) const noexcept
+            -> bool override {
+            return this == &other;
+        }
+
+      public:
+        explicit counting_resource(frame_arena *arena) : m_arena{arena} {}
+    };
+
+    std::unique_ptr<counting_resource> m_resource;
+
+  public:
+    constexpr static size_t default_capacity = size_t{64} << 10U;
+
+    explicit frame_arena(size_t capacity = default_capacity)
+        : m_block{std::make_unique<std::byte[]>(capacity)},
+          m_capacity{capacity},
+          m_memory{std::make_unique<std::pmr::monotonic_buffer_resource>(
+              m_block.get(), capacity)},
+          m_resource{std::make_unique<counting_resource>(this)} {}
+
+    frame_arena(frame_arena const &)                     = delete;
+    frame_arena(frame_arena &&)                          = delete;
+    auto operator=(frame_arena const &) -> frame_arena & = delete;
+    auto operator=(frame_arena &&) -> frame_arena      & = delete;
+    ~frame_arena() { reset(); }
+
+    // For pmr containers that only live for the frame.
+    [[nodiscard]] auto resource() -> std::pmr::memory_resource * {
+        return m_resource.get();
+    }
+
+    template <typename T, typename... Args> auto make(Args &&...args) -> T & {
+        void *memory = resource()->allocate(sizeof(T), alignof(T));
+        auto *object = ::new(memory) T(std::forward<Args>(args)...);
+        if constexpr(!std::is_trivially_destructible_v<T>) {
+            m_cleanups.push_back(
+                {[](void *p) { static_cast<T *>(p)->~T(); }, object});
+        }
+        return *object;
+    }
+
+    // Destroys everything made this frame, newest first.
+    void reset() {
+        for(auto it = m_cleanups.rbegin(); it != m_cleanups.rend(); ++it) {
+            it->destroy(it->object);
+        }
+        m_cleanups.clear();
+        if(m_used > m_capacity) {
+            m_memory.reset();
+            m_capacity = m_used;
+            m_block    = std::make_unique<std::byte[]>(m_capacity);
+            m_memory   = std::make_unique<std::pmr::monotonic_buffer_resource>(
+                m_block.get(), m_capacity);
+        } else {
+            m_memory->release();
+        }
+        m_used = 0;
+    }
+
+    [[nodiscard]] auto capacity() const -> size_t { return m_capacity; }
+    [[nodiscard]] auto used() const -> size_t { return m_used; }
+};
+
+} // namespace gfx
@@ -5,23 +5,44 @@
 #include <SDL2/SDL_ttf.h>
 #include <fmt/core.h>
 #include <memory>
-#include <random>
 #include <vector>
 
+#include "asset_archive.h"
+#include "asset_loader.h"
+#include "atlas.h"
+#include "compositor.h"
 #include "constants.h"
 #include "font.h"
+#include "frame_arena.h"
+#include "handle_pool.h"
+#include "headless.h"
+#include "particles.h"
+#include "profiler.h"
+#include "random.h"
+#include "rasterizer.h"
+#include "render_state.h"
+#include "render_thread.h"
 #include "renderer.h"
+#include "resource_registry.h"
+#include "sdf_font.h"
+#include "sparse_grid.h"
+#include "sprite_batch.h"
+#include "streaming_texture.h"
 #include "surface.h"
 #include "texture.h"
+#include "tilemap.h"
 #include "window.h"
 
 namespace gfx {
 
 void show_cursor(bool visible);
 auto get_mouse_state(double &x, double &y) -> uint32_t;
+// Each of these allocates its object on its own; renderer::create_texture()
+// makes pooled textures instead.
 auto create_window(std::string_view title, int width = default_window_width,
                    int height = default_window_height, bool vsync = false,
                    uint32_t flags = 0) -> std::shared_ptr<window>;
+auto create_headless(int width, int height) -> std::shared_ptr<headless>;
 auto create_surface_from_file(std::string const &file_name)
     -> std::shared_ptr<surface>;
 auto create_texture(renderer &r, int w, int h) -> std::shared_ptr<texture>;
@@ -31,11 +52,12 @@ auto modifier_key_pressed(uint32_t key) -> bool;
 class gfx {
     bool m_initialized{false};
 
-    std::random_device         m_rdev;
-    std::default_random_engine m_reng{m_rdev()};
+    random_engine m_rng{random_engine::random_seed()};
 
   public:
-    gfx() : m_initialized(SDL_Init(SDL_INIT_VIDEO) >= 0) {
+    // Pass 0 for headless use, which doesn't need the video subsystem.
+    explicit gfx(uint32_t subsystems = SDL_INIT_VIDEO)
+        : m_initialized(SDL_Init(subsystems) >= 0) {
         if(!m_initialized) {
             throw std::runtime_error{
                 fmt::format("error initializing graphics: {}", SDL_GetError())};
@@ -58,14 +80,17 @@ class gfx {
 
     [[nodiscard]] auto is_initialized() const -> bool { return m_initialized; }
 
+    // Makes the random numbers below repeatable.
+    void seed(uint64_t value) { m_rng = random_engine{value}; }
+    [[nodiscard]] auto get_random() -> random_engine & { return m_rng; }
+
     auto uniform_random_between(double a, double b) -> double {
-        std::uniform_real_distribution<double> dist{a, b};
-        return dist(m_reng);
+        return m_rng.uniform(a, b);
     }
 
+    // a is the mean, b the standard deviation.
     auto normal_random_between(double a, double b) -> double {
-        std::normal_distribution<double> dist{a, b};
-        return dist(m_reng);
+        return m_rng.normal(a, b);
     }
 };
 
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include "color.h"
+#include "texture.h"
+#include "vec2d.h"
+
+namespace gfx {
+
+struct glyph {
+    uint32_t page{};
+    SDL_Rect source{};
+    int      offset_x{};
+    int      advance{};
+};
+
+// Decodes one UTF-8 sequence starting at pos and advances pos past it.
+// Malformed input decodes to U+FFFD.
+[[nodiscard]] auto decode_utf8(std::string_view text, size_t &pos) -> uint32_t;
+
+// Where TTF_RenderGlyph32_Blended() puts the left edge of its surface,
+// relative to the pen. SDL_ttf lays a glyph out like one character of text,
+// whose surface starts at the pen unless ink reaches left of it, so glyphs
+// with a positive minx come with blank columns in front.
+[[nodiscard]] constexpr auto glyph_surface_offset(int minx) -> int {
+    return minx < 0 ? minx : 0;
+}
+
+struct text_mesh {
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int>        indices;
+};
+
+// Glyphs of a single font rasterized once into shared texture pages. Text is
+// laid out (and wrapped) here and turned into one quad mesh per page. The
+// pages belong to the renderer, which keeps one atlas per font.
+class glyph_atlas {
+    constexpr static int      default_page_size = 1024;
+    constexpr static uint32_t ascii_count       = 128;
+    constexpr static int32_t  no_glyph          = -1;
+
+    struct placement {
+        int32_t index;
+        int     x;
+        int     y;
+    };
+
+    SDL_Renderer *m_sdl_renderer;
+    TTF_Font     *m_font;
+    int           m_page_size;
+    int           m_line_skip;
+    int           m_cursor_x{};
+    int           m_cursor_y{};
+    int           m_shelf_height{};
+
+    std::vector<texture>                  m_pages;
+    std::vector<glyph>                    m_glyphs;
+    std::array<int32_t, ascii_count>      m_ascii{};
+    std::unordered_map<uint32_t, int32_t> m_other;
+
+    std::vector<uint32_t>  m_codepoints;
+    std::vector<placement> m_placements;
+    std::vector<text_mesh> m_meshes;
+
+    void clear_page(texture const &page) const;
+    auto index_of(uint32_t codepoint) -> int32_t;
+    auto rasterize(uint32_t codepoint) -> int32_t;
+    auto layout(std::string_view text, uint32_t wrap_width) -> vec2d_t<int>;
+
+  public:
+    glyph_atlas(SDL_Renderer *renderer, TTF_Font *font,
+                int page_size = default_page_size);
+
+    [[nodiscard]] auto get_glyph(uint32_t codepoint) -> glyph const &;
+
+    // Lays out text at origin, wrapping at wrap_width pixels (0 disables
+    // wrapping), and fills one mesh per page tinted with the given color.
+    void build_text(std::string_view text, SDL_FPoint origin, color color,
+                    uint32_t wrap_width = 0);
+
+    [[nodiscard]] auto measure(std::string_view text, uint32_t wrap_width = 0)
+        -> vec2d_t<int>;
+
+    [[nodiscard]] auto page_count() const -> uint32_t {
+        return static_cast<uint32_t>(m_pages.size());
+    }
+    [[nodiscard]] auto get_page(uint32_t page) const -> texture const & {
+        return m_pages[page];
+    }
+    [[nodiscard]] auto get_mesh(uint32_t page) const -> text_mesh const & {
+        return m_meshes[page];
+    }
+    [[nodiscard]] auto line_skip() const -> int { return m_line_skip; }
+
+    [[nodiscard]] auto get_sdl_renderer() const -> SDL_Renderer * {
+        return m_sdl_renderer;
+    }
+};
+
+} // namespace gfx
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace gfx {
+
+// 32 bits naming an object in a handle_pool<T>: a slot index and the
+// generation of the slot when the object was created, so handles to
+// released objects stop resolving instead of reaching whatever moved into
+// the slot since. The default handle never resolves.
+template <typename T> class pool_handle {
+  public:
+    constexpr static uint32_t index_bits      = 20;
+    constexpr static uint32_t generation_bits = 32 - index_bits;
+    constexpr static uint32_t max_index       = (1U << index_bits) - 1;
+    constexpr static uint32_t max_generation  = (1U << generation_bits) - 1;
+
+  private:
+    uint32_t m_value{};
+
+  public:
+    constexpr pool_handle() = default;
+    constexpr pool_handle(uint32_t index, uint32_t generation)
+        : m_value{generation << index_bits | index} {}
+
+    [[nodiscard]] constexpr auto index() const -> uint32_t {
+        return m_value & max_index;
+    }
+    [[nodiscard]] constexpr auto generation() const -> uint32_t {
+        return m_value >> index_bits;
+    }
+    [[nodiscard]] constexpr auto value() const -> uint32_t { return m_value; }
+
+    constexpr explicit operator bool() const { return m_value != 0; }
+    constexpr auto operator==(pool_handle const &) const -> bool = default;
+};
+
+// Objects stored contiguously, named by generational handles. Releasing
+// an object invalidates its handles at once but only destroys it in
+// collect(), called once per frame, so anything recorded earlier in the
+// frame may still use it. Objects move as others are created and
+// collected, so keep handles rather than pointers to them.
+template <typename T> class handle_pool {
+  public:
+    using handle = pool_handle<T>;
+
+  private:
+    struct slot {
+        uint32_t dense{};
+        // Never 0, so that the default handle stays invalid.
+        uint32_t generation{1};
+        bool     live{};
+    };
+
+    std::vector<T>        m_objects;
+    std::vector<uint32_t> m_owners;
+    std::vector<slot>     m_slots;
+    std::vector<uint32_t> m_free;
+    std::vector<uint32_t> m_released;
+
+    [[nodiscard]] auto resolve(handle h) const -> slot const * {
+        if(h.index() >= m_slots.size()) {
+            return nullptr;
+        }
+        auto const &s = m_slots[h.index()];
+        return s.live && s.generation == h.generation() ? &s : nullptr;
+    }
+
+  public:
+    template <typename... Args> auto create(Args &&...args) -> handle {
+        uint32_t index{};
+        if(!m_free.empty()) {
+            index = m_free.back();
+            m_free.pop_back();
+        } else if(m_slots.size() <= handle::max_index) {
+            index = static_cast<uint32_t>(m_slots.size());
+            m_slots.emplace_back();
+        } else {
+            throw std::runtime_error{"handle pool is full"};
+        }
+        m_objects.emplace_back(std::forward<Args>(args)...);
+        m_owners.push_back(index);
+        auto &s = m_slots[index];
+        s.dense = static_cast<uint32_t>(m_objects.size() - 1);
+        s.live  = true;
+        return {index, s.generation};
+    }
+
+    [[nodiscard]] auto get(handle h) -> T * {
+        auto const *s = resolve(h);
+        return s != nullptr ? &m_objects[s->dense] : nullptr;
+    }
+    [[nodiscard]] auto get(handle h) const -> T const * {
+        auto const *s = resolve(h);
+        return s != nullptr ? &m_objects[s->dense] : nullptr;
+    }
+    [[nodiscard]] auto contains(handle h) const -> bool {
+        return resolve(h) != nullptr;
+    }
+
+    // Stale handles are ignored.
+    void release(handle h) {
+        if(resolve(h) == nullptr) {
+            return;
+        }
+        auto &s = m_slots[h.index()];
+        s.live  = false;
+        m_released.push_back(h.index());
+    }
+
+    // Destroys the released objects and frees their slots.
+    void collect() {
+        for(auto index : m_released) {
+            auto &s    = m_slots[index];
+            auto  last = static_cast<uint32_t>(m_objects.size() - 1);
+            if(s.dense != last) {
+                auto moved           = m_owners[last];
+                m_objects[s.dense]   = std::move(m_objects[last]);
+                m_owners[s.dense]    = moved;
+                m_slots[moved].dense = s.dense;
+            }
+            m_objects.pop_back();
+            m_owners.pop_back();
+            // A slot whose generations ran out is retired for good.
+            if(s.generation < handle::max_generation) {
+                ++s.generation;
+                m_free.push_back(index);
+            }
+        }
+        m_released.clear();
+    }
+
+    // Live objects plus those waiting for collect().
+    [[nodiscard]] auto size() const -> size_t { return m_objects.size(); }
+    [[nodiscard]] auto pending() const -> size_t { return m_released.size(); }
+
+    // Every stored object, released ones included, in no particular order.
+    [[nodiscard]] auto begin() { return m_objects.begin(); }
+    [[nodiscard]] auto end() { return m_objects.end(); }
+    [[nodiscard]] auto begin() const { return m_objects.begin(); }
+    [[nodiscard]] auto end() const { return m_objects.end(); }
+};
+
+} // namespace gfx
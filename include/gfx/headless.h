@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+
+#include <SDL.h>
+
+#include "renderer.h"
+#include "streaming_texture.h"
+#include "surface.h"
+
+namespace gfx {
+
+// The renderer API without a window: a software renderer drawing into an
+// RGBA32 surface in memory. Needs no video subsystem, so gfx can be
+// initialized with gfx{0} on machines without a display.
+class headless {
+    surface  m_target;
+    renderer m_renderer;
+
+  public:
+    headless(int width, int height);
+
+    // Renders straight into caller-owned memory, which must stay valid for
+    // the lifetime of this object; a pitch of 0 means tightly packed rows.
+    // Frames need no readback at all this way.
+    headless(std::span<std::byte> pixels, int width, int height,
+             int pitch = 0);
+
+    [[nodiscard]] auto get_renderer() -> renderer & { return m_renderer; }
+    [[nodiscard]] auto get_surface() -> surface & { return m_target; }
+
+    // Finishes any pending drawing and returns the frame in place. The view
+    // stays valid until the next draw call.
+    [[nodiscard]] auto frame() -> locked_pixels;
+
+    // Copies the finished frame into out, with rows pitch bytes apart (0 for
+    // tightly packed).
+    void read_frame(std::span<std::byte> out, int pitch = 0);
+};
+
+// Reads the current render target of any renderer, e.g. an offscreen target
+// texture on a GPU renderer, as RGBA32 into out. area defaults to the whole
+// target.
+void read_pixels(renderer &r, std::span<std::byte> out, int pitch = 0,
+                 SDL_Rect const *area = nullptr);
+
+} // namespace gfx
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <SDL.h>
+
+#include "color.h"
+#include "constants.h"
+#include "random.h"
+#include "rect.h"
+#include "texture.h"
+#include "thread_pool.h"
+#include "vec2d.h"
+
+namespace gfx {
+
+class renderer;
+
+// How an emitter spawns and moves its particles, in world units and
+// seconds.
+struct particle_settings {
+    vec2d_t<float> position;
+    // Particles spawn uniformly within position +- spread.
+    vec2d_t<float> spread;
+    vec2d_t<float> velocity;
+    float          velocity_stddev{};
+    vec2d_t<float> acceleration;
+    // Fraction of the velocity lost per second.
+    float          drag{};
+    float          lifetime{1};
+    // Lifetimes are uniform in lifetime * (1 +- lifetime_variance).
+    float          lifetime_variance{};
+    // Particles spawned per second by update().
+    float          rate{};
+    float          size{2};
+    color          tint{color_white};
+    // Scales alpha down to 0 over each particle's life.
+    bool           fade{true};
+};
+
+// A fixed-capacity set of particles stored as parallel arrays, so that
+// integration runs on whole registers of floats. Dead particles are
+// replaced by the last live one, which keeps the arrays dense without
+// allocating but doesn't preserve spawn order. Everything is drawn as one
+// geometry call of square quads, textured if a region is set.
+class particle_emitter {
+    constexpr static size_t chunk_size = 16384;
+
+    particle_settings m_settings;
+    random_engine     m_rng;
+    float             m_pending{};
+    size_t            m_size{};
+    size_t            m_capacity;
+
+    std::vector<float>     m_x;
+    std::vector<float>     m_y;
+    std::vector<float>     m_vx;
+    std::vector<float>     m_vy;
+    std::vector<float>     m_life;
+    std::vector<float>     m_inv_lifetime;
+    std::vector<SDL_Color> m_color;
+
+    std::optional<texture_region> m_region;
+    std::vector<SDL_Vertex>       m_vertices;
+    std::vector<int>              m_indices;
+
+    void move_particle(size_t from, size_t to);
+    void compact();
+    void build_vertices(size_t begin, size_t end, vec2d_t<float> offset,
+                        float zoom);
+
+  public:
+    explicit particle_emitter(size_t            capacity,
+                              particle_settings settings = {},
+                              uint64_t seed = random_engine::default_seed);
+
+    [[nodiscard]] auto get_settings() -> particle_settings & {
+        return m_settings;
+    }
+    void set_texture(texture_region const &region) { m_region = region; }
+    void reset_texture() { m_region.reset(); }
+
+    // Returns how many were spawned, which is less than n when full.
+    auto emit(size_t n) -> size_t { return emit(n, m_settings.tint); }
+    auto emit(size_t n, color tint) -> size_t;
+
+    // Spawns settings.rate * dt particles, then moves and ages all of them
+    // and removes the dead. With a pool the arrays are split across it.
+    void update(float dt, thread_pool *pool = nullptr);
+
+    void draw(renderer &r, rect_t<double> view, thread_pool *pool = nullptr);
+
+    void clear() { m_size = 0; }
+
+    [[nodiscard]] auto size() const -> size_t { return m_size; }
+    [[nodiscard]] auto capacity() const -> size_t { return m_capacity; }
+    [[nodiscard]] auto empty() const -> bool { return m_size == 0; }
+
+    [[nodiscard]] auto x() const -> std::span<float const> {
+        return {m_x.data(), m_size};
+    }
+    [[nodiscard]] auto y() const -> std::span<float const> {
+        return {m_y.data(), m_size};
+    }
+    [[nodiscard]] auto life() const -> std::span<float const> {
+        return {m_life.data(), m_size};
+    }
+};
+
+} // namespace gfx
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace gfx {
+
+enum class counter : uint8_t {
+    draw_calls,
+    primitives,
+    state_changes,
+    state_changes_skipped,
+    texture_creations,
+    texture_uploads,
+    bytes_uploaded,
+    text_rasterizations,
+    draws_culled,
+    count
+};
+
+enum class timer : uint8_t { renderer, present, count };
+
+constexpr auto counter_count = static_cast<size_t>(counter::count);
+constexpr auto timer_count   = static_cast<size_t>(timer::count);
+
+[[nodiscard]] auto counter_name(counter c) -> char const *;
+[[nodiscard]] auto timer_name(timer t) -> char const *;
+
+struct frame_profile {
+    using duration = std::chrono::nanoseconds;
+
+    uint64_t                            index{};
+    duration                            start{};
+    duration                            length{};
+    std::array<uint64_t, counter_count> counters{};
+    std::array<duration, timer_count>   timers{};
+
+    [[nodiscard]] auto operator[](counter c) const -> uint64_t {
+        return counters[static_cast<size_t>(c)];
+    }
+    [[nodiscard]] auto operator[](timer t) const -> duration {
+        return timers[static_cast<size_t>(t)];
+    }
+};
+
+// A named span of time on one thread; the name must be a string literal.
+struct trace_event {
+    char const              *name{};
+    std::chrono::nanoseconds start{};
+    std::chrono::nanoseconds length{};
+    uint32_t                 thread{};
+};
+
+// Process-wide frame statistics. The library only feeds it when built with
+// GFX_ENABLE_PROFILING (the gfx_ENABLE_PROFILING CMake option); otherwise
+// the instrumentation macros below expand to nothing and every frame reads
+// as zero. Frames end in renderer::present(). Times are relative to the
+// creation of the profiler.
+class profiler {
+    using clock = std::chrono::steady_clock;
+
+    clock::time_point m_epoch{clock::now()};
+    clock::time_point m_frame_start{m_epoch};
+    uint64_t          m_frame_index{};
+
+    std::array<std::atomic<uint64_t>, counter_count> m_counters{};
+    std::array<std::atomic<int64_t>, timer_count>    m_timers{};
+
+    mutable std::mutex        m_mutex;
+    std::deque<frame_profile> m_frames;
+    std::deque<trace_event>   m_events;
+    size_t                    m_frame_capacity{default_frame_capacity};
+    size_t                    m_event_capacity{default_event_capacity};
+
+    profiler() = default;
+
+  public:
+    constexpr static size_t default_frame_capacity = 240;
+    constexpr static size_t default_event_capacity = 65536;
+
+    [[nodiscard]] constexpr static auto compiled_in() -> bool {
+#ifdef GFX_ENABLE_PROFILING
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    static auto instance() -> profiler &;
+
+    void add(counter c, uint64_t n = 1) {
+        m_counters[static_cast<size_t>(c)].fetch_add(n,
+                                                     std::memory_order_relaxed);
+    }
+
+    void add(timer t, std::chrono::nanoseconds elapsed) {
+        m_timers[static_cast<size_t>(t)].fetch_add(elapsed.count(),
+                                                   std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] auto now() const -> std::chrono::nanoseconds {
+        return clock::now() - m_epoch;
+    }
+
+    void record(trace_event const &event);
+
+    // Closes the current frame, keeping the last frame_capacity of them.
+    void end_frame();
+
+    // The frame in progress, and the finished ones oldest first.
+    [[nodiscard]] auto current() const -> frame_profile;
+    [[nodiscard]] auto frames() const -> std::vector<frame_profile>;
+    [[nodiscard]] auto events() const -> std::vector<trace_event>;
+
+    void set_capacity(size_t frames, size_t events);
+    void reset();
+
+    // {"frames": [...]} with one object per finished frame, times in ms.
+    void write_json(std::ostream &out) const;
+    // The Trace Event Format read by chrome://tracing and Perfetto.
+    void write_chrome_trace(std::ostream &out) const;
+};
+
+// Adds the time until it goes out of scope to a frame timer, unless another
+// timed scope is already open on the same thread, so nested renderer calls
+// are only counted once.
+class profile_timer {
+    timer                    m_timer;
+    bool                     m_outermost;
+    std::chrono::nanoseconds m_start{};
+
+    static auto depth() -> int & {
+        thread_local int open = 0;
+        return open;
+    }
+
+  public:
+    explicit profile_timer(timer t) : m_timer{t}, m_outermost{depth()++ == 0} {
+        if(m_outermost) {
+            m_start = profiler::instance().now();
+        }
+    }
+
+    profile_timer(profile_timer const &)                     = delete;
+    profile_timer(profile_timer &&)                          = delete;
+    auto operator=(profile_timer const &) -> profile_timer & = delete;
+    auto operator=(profile_timer &&) -> profile_timer      & = delete;
+
+    ~profile_timer() {
+        --depth();
+        if(m_outermost) {
+            auto &p = profiler::instance();
+            p.add(m_timer, p.now() - m_start);
+        }
+    }
+};
+
+// Records a trace event covering its lifetime.
+class profile_scope {
+    char const              *m_name;
+    std::chrono::nanoseconds m_start;
+
+  public:
+    explicit profile_scope(char const *name)
+        : m_name{name}, m_start{profiler::instance().now()} {}
+
+    profile_scope(profile_scope const &)                     = delete;
+    profile_scope(profile_scope &&)                          = delete;
+    auto operator=(profile_scope const &) -> profile_scope & = delete;
+    auto operator=(profile_scope &&) -> profile_scope      & = delete;
+
+    ~profile_scope();
+};
+
+} // namespace gfx
+
+#define GFX_PROFILE_CONCAT_INNER(a, b) a##b
+#define GFX_PROFILE_CONCAT(a, b)       GFX_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef GFX_ENABLE_PROFILING
+#define GFX_PROFILE_COUNT(what, n)                                             \
+    ::gfx::profiler::instance().add(::gfx::counter::what,                      \
+                                    static_cast<uint64_t>(n))
+#define GFX_PROFILE_TIME(what)                                                 \
+    ::gfx::profile_timer GFX_PROFILE_CONCAT(gfx_profile_timer_,                \
+                                            __LINE__){::gfx::timer::what}
+#define GFX_PROFILE_SCOPE(name)                                                \
+    ::gfx::profile_scope GFX_PROFILE_CONCAT(gfx_profile_scope_, __LINE__){name}
+#define GFX_PROFILE_END_FRAME() ::gfx::profiler::instance().end_frame()
+#else
+#define GFX_PROFILE_COUNT(what, n) static_cast<void>(0)
+#define GFX_PROFILE_TIME(what)     static_cast<void>(0)
+#define GFX_PROFILE_SCOPE(name)    static_cast<void>(0)
+#define GFX_PROFILE_END_FRAME()    static_cast<void>(0)
+#endif
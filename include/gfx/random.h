@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+#include "vec2d.h"
+
+namespace gfx {
+
+// xoshiro256++ with bulk fills. Single values come from the main state; the
+// fill_* functions run four independent lanes side by side, which compilers
+// vectorize, so they produce a different (but equally deterministic)
+// sequence than repeated single calls. Usable with <random> distributions
+// as a UniformRandomBitGenerator.
+class random_engine {
+    constexpr static size_t lanes = 4;
+
+    using state = std::array<uint64_t, 4>;
+
+    state m_state{};
+    // Lane states for the bulk fills, word-major: m_lanes[word][lane].
+    std::array<std::array<uint64_t, lanes>, 4> m_lanes{};
+
+    double m_spare{};
+    bool   m_has_spare{false};
+
+    template <typename F> void generate(size_t blocks, F &&consume);
+
+    template <typename T>
+    void fill_uniform(T *out, size_t n, std::array<T, 2> lo,
+                      std::array<T, 2> scale);
+    template <typename T>
+    void fill_normal(T *out, size_t n, std::array<T, 2> mean, T stddev);
+
+    constexpr static auto rotl(uint64_t x, int k) -> uint64_t {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    constexpr static auto next(state &s) -> uint64_t {
+        auto result = rotl(s[0] + s[3], 23) + s[0];
+        auto t      = s[1] << 17U;
+        s[2]        ^= s[0];
+        s[3]        ^= s[1];
+        s[1]        ^= s[2];
+        s[0]        ^= s[3];
+        s[2]        ^= t;
+        s[3]        = rotl(s[3], 45);
+        return result;
+    }
+
+  public:
+    using result_type = uint64_t;
+
+    constexpr static uint64_t default_seed = 0x9E3779B97F4A7C15ULL;
+
+    explicit random_engine(uint64_t seed = default_seed);
+
+    // A seed from std::random_device, for runs that needn't be repeatable.
+    [[nodiscard]] static auto random_seed() -> uint64_t;
+
+    [[nodiscard]] constexpr static auto min() -> result_type { return 0; }
+    [[nodiscard]] constexpr static auto max() -> result_type {
+        return ~result_type{0};
+    }
+
+    auto operator()() -> result_type { return next(m_state); }
+
+    // In [0, 1), with 53 random bits.
+    auto uniform() -> double {
+        return static_cast<double>((*this)() >> 11U) * 0x1.0p-53;
+    }
+    auto uniform(double lo, double hi) -> double {
+        return lo + (hi - lo) * uniform();
+    }
+    auto normal(double mean, double stddev) -> double;
+
+    // Advances by 2^128 values, as if that many had been drawn.
+    void jump();
+
+    // Returns an engine for another thread and jumps this one past it, so
+    // the two streams can't overlap for 2^128 values.
+    [[nodiscard]] auto split() -> random_engine;
+
+    void fill_uniform(std::span<double> out, double lo, double hi);
+    void fill_uniform(std::span<float> out, float lo, float hi);
+    void fill_uniform(std::span<vec2d_t<double>> out, vec2d_t<double> lo,
+                      vec2d_t<double> hi);
+    void fill_uniform(std::span<vec2d_t<float>> out, vec2d_t<float> lo,
+                      vec2d_t<float> hi);
+
+    void fill_normal(std::span<double> out, double mean, double stddev);
+    void fill_normal(std::span<float> out, float mean, float stddev);
+    void fill_normal(std::span<vec2d_t<double>> out, vec2d_t<double> mean,
+                     double stddev);
+    void fill_normal(std::span<vec2d_t<float>> out, vec2d_t<float> mean,
+                     float stddev);
+};
+
+} // namespace gfx
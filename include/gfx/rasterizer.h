@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include <SDL.h>
+
+#include "color.h"
+#include "font.h"
+#include "surface.h"
+#include "thread_pool.h"
+#include "vec2d.h"
+
+namespace gfx {
+
+// CPU rasterizer drawing straight into the pixels of an RGBA32 surface.
+// Draw calls are only recorded; flush() bins them into square tiles and
+// rasterizes the tiles in parallel, each tile applying its calls in
+// recording order, so the result doesn't depend on the thread count. The
+// pool is borrowed, so it can be shared with other work, and must outlive
+// the rasterizer; without one the tiles run on the calling thread.
+// Everything except clear() is alpha blended like SDL_BLENDMODE_BLEND.
+class software_rasterizer {
+    constexpr static int default_tile_size = 64;
+
+    enum class op_kind : uint8_t {
+        clear,
+        fill_rect,
+        line,
+        fill_circle,
+        circle,
+        blit
+    };
+
+    struct op {
+        op_kind            kind;
+        color              draw_color;
+        SDL_Rect           bounds;
+        int                x0{};
+        int                y0{};
+        int                x1{};
+        int                y1{};
+        SDL_Surface const *source{};
+    };
+
+    surface             *m_target;
+    int                  m_tile_size;
+    int                  m_tiles_x{};
+    int                  m_tiles_y{};
+    std::vector<op>      m_ops;
+    std::vector<surface> m_scratch;
+
+    std::vector<std::vector<uint32_t>> m_bins;
+    thread_pool                       *m_pool;
+
+    void layout_tiles();
+    void record(op const &o);
+    void rasterize(size_t tile);
+
+  public:
+    explicit software_rasterizer(surface &target, thread_pool *pool = nullptr,
+                                 int tile_size = default_tile_size);
+
+    // Subsequent calls draw into target, which must be RGBA32 as well.
+    // Anything recorded for the previous target is flushed first.
+    void set_target(surface &target);
+    [[nodiscard]] auto get_target() const -> surface & { return *m_target; }
+
+    // Overwrites every pixel, alpha included.
+    void clear(color c);
+    void fill_rect(SDL_Rect const &rect, color c);
+    void draw_line(vec2d_t<int> from, vec2d_t<int> to, color c);
+    void fill_circle(vec2d_t<int> center, int radius, color c);
+    void draw_circle(vec2d_t<int> center, int radius, color c);
+
+    // RGBA32 sources are read in place during flush() and must outlive it;
+    // other formats are converted and copied when recorded.
+    void blit(surface const &source, vec2d_t<int> position);
+
+    void draw_text(font &f, std::string_view text, vec2d_t<int> position,
+                   color c, uint32_t wrap_width = 0);
+
+    void flush();
+
+    [[nodiscard]] auto pending() const -> size_t { return m_ops.size(); }
+    [[nodiscard]] auto thread_count() const -> size_t {
+        return m_pool != nullptr ? m_pool->size() + 1 : 1;
+    }
+};
+
+} // namespace gfx
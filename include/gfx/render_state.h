@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+
+#include <SDL.h>
+
+#include "color.h"
+
+namespace gfx {
+
+struct state_stats {
+    size_t applied{};
+    size_t skipped{};
+};
+
+// Mirror of an SDL renderer's draw color, blend mode, target and clip rect.
+// Setters only call into SDL when the value actually changes and return
+// whether they did; getters never call into SDL, except that a texture
+// target is re-read, since SDL goes back to the window when the target
+// texture is destroyed. Anything else that changes the renderer's state
+// behind its back has to call sync() afterwards.
+class render_state {
+    SDL_Renderer           *m_renderer{};
+    color                   m_color;
+    SDL_BlendMode           m_blend{SDL_BLENDMODE_NONE};
+    mutable SDL_Texture    *m_target{};
+    std::optional<SDL_Rect> m_clip;
+    state_stats             m_stats;
+
+    void read_clip();
+    void read_target() const;
+    void skipped();
+    void applied();
+
+  public:
+    render_state() = default;
+    explicit render_state(SDL_Renderer *renderer);
+
+    // Re-reads everything from the renderer.
+    void sync();
+
+    auto set_color(color const &c) -> bool;
+    auto set_blend_mode(SDL_BlendMode blend) -> bool;
+    // SDL resets the clip rect when the target changes, so this re-reads it.
+    auto set_target(SDL_Texture *target) -> bool;
+    // std::nullopt turns clipping off.
+    auto set_clip(std::optional<SDL_Rect> const &clip) -> bool;
+
+    [[nodiscard]] auto get_color() const -> color { return m_color; }
+    [[nodiscard]] auto get_blend_mode() const -> SDL_BlendMode {
+        return m_blend;
+    }
+    [[nodiscard]] auto get_target() const -> SDL_Texture * {
+        read_target();
+        return m_target;
+    }
+    [[nodiscard]] auto get_clip() const -> std::optional<SDL_Rect> const & {
+        return m_clip;
+    }
+
+    [[nodiscard]] auto get_sdl_renderer() const -> SDL_Renderer * {
+        return m_renderer;
+    }
+
+    [[nodiscard]] auto get_stats() const -> state_stats const & {
+        return m_stats;
+    }
+    void reset_stats() { m_stats = {}; }
+};
+
+} // namespace gfx
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "color.h"
+#include "command_buffer.h"
+
+namespace gfx {
+
+class renderer;
+
+// Drawing for one frame, recorded without touching SDL.
+class render_frame {
+    friend class render_thread;
+
+    uint64_t                    m_index{};
+    std::optional<color>        m_clear;
+    command_buffer              m_commands;
+    std::vector<command_buffer> m_lists;
+
+  public:
+    [[nodiscard]] auto index() const -> uint64_t { return m_index; }
+
+    // Clears the target to c before anything else is drawn.
+    void set_clear(color c) { m_clear = c; }
+
+    [[nodiscard]] auto commands() -> command_buffer & { return m_commands; }
+
+    // Sub-lists that can be recorded in parallel, one thread per list. They
+    // are appended to commands() in index order when the frame ends, no
+    // matter which finished first. Changing the count invalidates
+    // references to the lists.
+    void set_list_count(size_t n) { m_lists.resize(n); }
+    [[nodiscard]] auto list(size_t i) -> command_buffer & {
+        return m_lists.at(i);
+    }
+};
+
+struct render_thread_stats {
+    uint64_t frames_recorded{};
+    uint64_t frames_presented{};
+    // Times begin_frame() had to wait for the renderer to free a frame.
+    uint64_t recorder_stalls{};
+};
+
+// Replays recorded frames to a renderer while other threads record the
+// next ones, so recording frame N+1 overlaps with SDL drawing frame N.
+// There are three frames in flight: one being recorded, one queued, one
+// being replayed.
+//
+// SDL's OpenGL, Direct3D and Metal renderers may only be used from the
+// thread that created them, so by default frames are replayed by run() on
+// the calling thread, which should be the one that created the renderer,
+// with recording done elsewhere. own_thread replays on a new thread
+// instead, which is only safe for renderers without that restriction,
+// like the software renderer behind headless. While frames are replayed,
+// nothing else may use the renderer.
+class render_thread {
+    constexpr static size_t frame_count = 3;
+
+    enum class slot_state : uint8_t { free, recording, queued, replaying };
+
+    renderer                             &m_renderer;
+    std::array<render_frame, frame_count> m_frames;
+    std::array<slot_state, frame_count>   m_states{};
+    std::deque<size_t>                    m_queue;
+    uint64_t                              m_next_index{};
+    bool                                  m_stopping{false};
+    std::exception_ptr                    m_error;
+    render_thread_stats                   m_stats;
+
+    mutable std::mutex      m_mutex;
+    std::condition_variable m_queued;
+    std::condition_variable m_freed;
+    std::thread             m_thread;
+
+    void replay(render_frame &frame);
+    void rethrow_error();
+
+  public:
+    explicit render_thread(renderer &r, bool own_thread = false);
+
+    render_thread(render_thread const &)                     = delete;
+    render_thread(render_thread &&)                          = delete;
+    auto operator=(render_thread const &) -> render_thread & = delete;
+    auto operator=(render_thread &&) -> render_thread      & = delete;
+
+    // Presents the frames already queued, then stops.
+    ~render_thread();
+
+    // Waits until a frame is free and returns it, empty. Exceptions thrown
+    // while replaying earlier frames are rethrown here.
+    auto begin_frame() -> render_frame &;
+    // Merges the frame's sub-lists and queues it to be presented.
+    void end_frame(render_frame &frame);
+
+    // Replays queued frames on the calling thread until stop().
+    void run();
+    void stop();
+
+    // Waits until every queued frame has been presented.
+    void wait_idle();
+
+    [[nodiscard]] auto get_stats() const -> render_thread_stats;
+};
+
+} // namespace gfx
@@ -1,11 +1,28 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <optional>
 #include <span>
+#include <unordered_map>
+#include <utility>
 
 #include <SDL.h>
 
+#include "camera.h"
+#include "circle.h"
 #include "color.h"
+#include "command_buffer.h"
+#include "font.h"
+#include "glyph_atlas.h"
+#include "handle_pool.h"
+#include "profiler.h"
 #include "rect.h"
+#include "render_state.h"
+#include "spatial_grid.h"
+#include "text_cache.h"
 #include "texture.h"
 #include "vec2d.h"
 
@@ -27,9 +44,116 @@ template <typename T> auto point_to_vec(SDL_Point *point) -> vec2d_t<T> {
                                    rect_t<double> view, double window_width)
     -> vec2d_t<double>;
 
+// Whole-array versions of the above; see camera for repeated use of one view.
+void world_to_window(std::span<vec2d_t<double> const> world_positions,
+                     std::span<vec2d_t<double>>       window_positions,
+                     rect_t<double> view, double window_width);
+void world_to_window(std::span<vec2d_t<float> const> world_positions,
+                     std::span<vec2d_t<float>>       window_positions,
+                     rect_t<double> view, double window_width);
+void world_to_window(std::span<double const> world_x,
+                     std::span<double const> world_y,
+                     std::span<double> window_x, std::span<double> window_y,
+                     rect_t<double> view, double window_width);
+void world_to_window(std::span<float const> world_x,
+                     std::span<float const> world_y, std::span<float> window_x,
+                     std::span<float> window_y, rect_t<double> view,
+                     double window_width);
+
+void window_to_world(std::span<vec2d_t<double> const> window_positions,
+                     std::span<vec2d_t<double>>       world_positions,
+                     rect_t<double> view, double window_width);
+void window_to_world(std::span<vec2d_t<float> const> window_positions,
+                     std::span<vec2d_t<float>>       world_positions,
+                     rect_t<double> view, double window_width);
+void window_to_world(std::span<double const> window_x,
+                     std::span<double const> window_y,
+                     std::span<double> world_x, std::span<double> world_y,
+                     rect_t<double> view, double window_width);
+void window_to_world(std::span<float const> window_x,
+                     std::span<float const> window_y, std::span<float> world_x,
+                     std::span<float> world_y, rect_t<double> view,
+                     double window_width);
+
+using texture_handle = pool_handle<texture>;
+
 class renderer {
-    SDL_Renderer *m_sdl_renderer{nullptr};
-    vec2d_t<int>  m_window_size;
+    SDL_Renderer  *m_sdl_renderer{nullptr};
+    vec2d_t<int>   m_window_size;
+    render_state   m_state;
+    command_buffer m_commands;
+    bool           m_batching{false};
+    text_cache     m_text_cache;
+
+    // Per font id; the pages are textures of this renderer.
+    std::unordered_map<uint64_t, glyph_atlas> m_glyph_atlases;
+
+    handle_pool<texture> m_textures;
+
+    std::vector<SDL_FPoint> m_fpoints;
+    std::vector<SDL_Vertex> m_vertices;
+    std::vector<int>        m_indices;
+
+    void append_circle_fan(SDL_FPoint center, float radius, size_t segments,
+                           SDL_Color c) {
+        auto base = static_cast<int>(m_vertices.size());
+        m_vertices.push_back({center, c, {}});
+        for(auto const &p : unit_circle(segments)) {
+            m_vertices.push_back(
+                {{center.x + radius * p.x, center.y + radius * p.y}, c, {}});
+        }
+        auto rim = static_cast<int>(m_vertices.size()) - base - 1;
+        for(int i = 1; i < rim; ++i) {
+            m_indices.push_back(base);
+            m_indices.push_back(base + i);
+            m_indices.push_back(base + i + 1);
+        }
+    }
+
+    // One quad showing all of tex with its top left corner at position.
+    template <typename T>
+    void draw_text_quad(texture const &tex, vec2d_t<T> position) {
+        auto x = static_cast<float>(position.x);
+        auto y = static_cast<float>(position.y);
+        auto w = static_cast<float>(tex.width());
+        auto h = static_cast<float>(tex.height());
+        auto c = color_white.get_sdl_color();
+        std::array<SDL_Vertex, 4> quad{{{{x, y}, c, {0, 0}},
+                                        {{x + w, y}, c, {1, 0}},
+                                        {{x, y + h}, c, {0, 1}},
+                                        {{x + w, y + h}, c, {1, 1}}}};
+        constexpr std::array<int, 6> indices{0, 1, 2, 2, 1, 3};
+        draw_geometry(quad, indices, tex.get_sdl_texture());
+    }
+
+    // Textures belong to the SDL renderer and have to go first. Cached text
+    // textures still held by the caller outlive it, like any other texture.
+    void release_resources() {
+        m_textures = {};
+        m_glyph_atlases.clear();
+        m_text_cache.clear();
+    }
+
+    // Whether a copy to dest, rotated by angle around pivot, can touch the
+    // window.
+    [[nodiscard]] auto reaches_window(SDL_Rect dest, SDL_Point pivot,
+                                      double angle) const -> bool {
+        if(std::fpclassify(angle) != FP_ZERO) {
+            // However it turns, the copy stays within reach of the pivot.
+            auto dx    = std::max(pivot.x, dest.w - pivot.x);
+            auto dy    = std::max(pivot.y, dest.h - pivot.y);
+            auto reach = static_cast<int>(std::ceil(std::hypot(dx, dy)));
+            dest       = {dest.x + pivot.x - reach, dest.y + pivot.y - reach,
+                          2 * reach, 2 * reach};
+        }
+        return dest.x < m_window_size.x && dest.y < m_window_size.y &&
+               dest.x + dest.w > 0 && dest.y + dest.h > 0;
+    }
+
+    template <typename T>
+    [[nodiscard]] auto zoom_for(rect_t<T> const &view) const -> double {
+        return m_window_size.x / static_cast<double>(view.size.x);
+    }
 
   public:
     explicit renderer(SDL_Window *win, bool vsync = false)
@@ -41,36 +165,156 @@ class renderer {
             throw std::runtime_error{
                 fmt::format("couldn't create renderer: {}", SDL_GetError())};
         }
-        if(SDL_SetRenderDrawBlendMode(m_sdl_renderer, SDL_BLENDMODE_BLEND) <
-           0) {
+        m_state = render_state{m_sdl_renderer};
+        m_state.set_blend_mode(SDL_BLENDMODE_BLEND);
+        SDL_GetWindowSize(win, &m_window_size.x, &m_window_size.y);
+    }
+
+    // Software renderer drawing straight into the surface's pixels, for
+    // rendering without a window; the surface must outlive the renderer.
+    explicit renderer(surface &target)
+        : m_sdl_renderer{SDL_CreateSoftwareRenderer(target.get_sdl_surface())},
+          m_window_size{target.get_sdl_surface()->w,
+                        target.get_sdl_surface()->h} {
+        if(m_sdl_renderer == nullptr) {
             throw std::runtime_error{
-                fmt::format("couldn't set blend mode: {}", SDL_GetError())};
+                fmt::format("couldn't create renderer: {}", SDL_GetError())};
         }
-        SDL_GetWindowSize(win, &m_window_size.x, &m_window_size.y);
+        m_state = render_state{m_sdl_renderer};
+        m_state.set_blend_mode(SDL_BLENDMODE_BLEND);
     }
 
-    renderer(renderer const &)                     = delete;
-    renderer(renderer &&)                          = default;
+    renderer(renderer const &) = delete;
+    renderer(renderer &&rhs) noexcept
+        : m_sdl_renderer{std::exchange(rhs.m_sdl_renderer, nullptr)},
+          m_window_size{rhs.m_window_size}, m_state{rhs.m_state},
+          m_commands{std::move(rhs.m_commands)}, m_batching{rhs.m_batching},
+          m_text_cache{std::move(rhs.m_text_cache)},
+          m_glyph_atlases{std::move(rhs.m_glyph_atlases)},
+          m_textures{std::move(rhs.m_textures)} {}
     auto operator=(renderer const &) -> renderer & = delete;
-    auto operator=(renderer &&) -> renderer      & = default;
-    ~renderer() { SDL_DestroyRenderer(m_sdl_renderer); }
+    auto operator=(renderer &&rhs) noexcept -> renderer & {
+        if(this != &rhs) {
+            release_resources();
+            SDL_DestroyRenderer(m_sdl_renderer);
+            m_sdl_renderer  = std::exchange(rhs.m_sdl_renderer, nullptr);
+            m_window_size   = rhs.m_window_size;
+            m_state         = rhs.m_state;
+            m_commands      = std::move(rhs.m_commands);
+            m_batching      = rhs.m_batching;
+            m_text_cache    = std::move(rhs.m_text_cache);
+            m_glyph_atlases = std::move(rhs.m_glyph_atlases);
+            m_textures      = std::move(rhs.m_textures);
+        }
+        return *this;
+    }
+    ~renderer() {
+        if(m_sdl_renderer != nullptr) {
+            release_resources();
+            SDL_DestroyRenderer(m_sdl_renderer);
+        }
+    }
 
     void clear() { clear(color_clear); }
 
     void clear(color c) {
+        GFX_PROFILE_TIME(renderer);
         set_draw_color(c);
+        flush();
         SDL_RenderClear(m_sdl_renderer);
+        GFX_PROFILE_COUNT(draw_calls, 1);
     }
 
-    void present() { SDL_RenderPresent(m_sdl_renderer); }
+    // Ends the frame: destroys released textures, and ends the profiler
+    // frame when built with GFX_ENABLE_PROFILING.
+    void present() {
+        {
+            GFX_PROFILE_SCOPE("present");
+            GFX_PROFILE_TIME(present);
+            flush();
+            SDL_RenderPresent(m_sdl_renderer);
+        }
+        end_frame();
+        GFX_PROFILE_END_FRAME();
+    }
 
-    [[nodiscard]] auto get_draw_color() const -> color {
-        color c;
-        if(SDL_GetRenderDrawColor(m_sdl_renderer, &c.r, &c.g, &c.b, &c.a) < 0) {
-            throw std::runtime_error{
-                fmt::format("couldn't get color: {}", SDL_GetError())};
+    // What present() does after presenting, for frames rendered into a
+    // target that is never presented, e.g. by a headless renderer. Without
+    // it, textures released from the pool are never destroyed.
+    void end_frame() {
+        m_textures.collect();
+    }
+
+    // Pool-backed textures named by 32-bit handles, as a cheaper
+    // alternative to create_texture()'s shared_ptr. A released texture
+    // stays alive until the end of the frame, so draws recorded before the
+    // release still find it. gfx::create_texture() and text_to_texture()
+    // don't use the pool: pooled textures move when others are collected
+    // and go with the renderer, neither of which a shared_ptr can follow.
+    auto create_texture(int width, int height,
+                        SDL_TextureAccess access = SDL_TEXTUREACCESS_TARGET)
+        -> texture_handle {
+        return m_textures.create(m_sdl_renderer, width, height, access);
+    }
+    auto create_texture(surface const &pixels) -> texture_handle {
+        return m_textures.create(m_sdl_renderer, pixels);
+    }
+    [[nodiscard]] auto get(texture_handle h) -> texture * {
+        return m_textures.get(h);
+    }
+    void release(texture_handle h) { m_textures.release(h); }
+
+    [[nodiscard]] auto get_textures() -> handle_pool<texture> & {
+        return m_textures;
+    }
+
+    // In batching mode points, lines and geometry are recorded instead of
+    // drawn, and submitted on flush() or present(), with consecutive draws
+    // in the same state merged into one call.
+    void set_batching(bool enabled) {
+        if(m_batching && !enabled) {
+            flush();
+        }
+        if(!m_batching && enabled) {
+            m_commands.set_target(m_state.get_target());
+            m_commands.set_blend_mode(m_state.get_blend_mode());
+            m_commands.set_color(m_state.get_color());
+        }
+        m_batching = enabled;
+    }
+
+    [[nodiscard]] auto is_batching() const -> bool { return m_batching; }
+
+    void flush() {
+        if(m_batching) {
+            GFX_PROFILE_TIME(renderer);
+            m_commands.submit(m_state);
         }
-        return c;
+    }
+
+    // Submits commands recorded elsewhere, after anything batched here.
+    void submit(command_buffer &commands) {
+        GFX_PROFILE_TIME(renderer);
+        flush();
+        commands.submit(m_state);
+    }
+
+    [[nodiscard]] auto get_batch_stats() const -> batch_stats const & {
+        return m_commands.get_stats();
+    }
+
+    void reset_batch_stats() { m_commands.reset_stats(); }
+
+    // State changes that reached SDL, and ones skipped because the renderer
+    // was already in that state.
+    [[nodiscard]] auto get_state_stats() const -> state_stats const & {
+        return m_state.get_stats();
+    }
+
+    void reset_state_stats() { m_state.reset_stats(); }
+
+    [[nodiscard]] auto get_draw_color() const -> color {
+        return m_batching ? m_commands.get_color() : m_state.get_color();
     }
 
     void set_draw_color(SDL_Color const &c) {
@@ -80,63 +324,267 @@ class renderer {
     void set_draw_color(color const &c) { set_draw_color(c.r, c.g, c.b, c.a); }
 
     void set_draw_color(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
-        if(SDL_SetRenderDrawColor(m_sdl_renderer, r, g, b, a) < 0) {
-            throw std::runtime_error{
-                fmt::format("couldn't set color: {}", SDL_GetError())};
+        if(m_batching) {
+            m_commands.set_color({r, g, b, a});
+            return;
+        }
+        m_state.set_color({r, g, b, a});
+    }
+
+    [[nodiscard]] auto get_blend_mode() const -> SDL_BlendMode {
+        return m_batching ? m_commands.get_blend_mode()
+                          : m_state.get_blend_mode();
+    }
+
+    void set_blend_mode(SDL_BlendMode blend) {
+        if(m_batching) {
+            m_commands.set_blend_mode(blend);
+            return;
+        }
+        m_state.set_blend_mode(blend);
+    }
+
+    // nullptr is the window.
+    [[nodiscard]] auto get_target() const -> SDL_Texture * {
+        return m_batching ? m_commands.get_target() : m_state.get_target();
+    }
+
+    void set_target(texture &t) { set_target(t.get_sdl_texture()); }
+
+    void reset_target() { set_target(nullptr); }
+
+    void set_target(SDL_Texture *t) {
+        if(m_batching) {
+            m_commands.set_target(t);
+            return;
         }
+        m_state.set_target(t);
+    }
+
+    // Changing the target resets the clip rect, as in SDL.
+    [[nodiscard]] auto get_clip_rect() -> std::optional<SDL_Rect> {
+        flush();
+        return m_state.get_clip();
     }
 
-    void set_target(texture &t) {
-        SDL_SetRenderTarget(m_sdl_renderer, t.get_sdl_texture());
+    // std::nullopt turns clipping off. Recorded batches are submitted first,
+    // since the clip rect isn't part of their state.
+    void set_clip_rect(std::optional<SDL_Rect> const &clip) {
+        flush();
+        m_state.set_clip(clip);
     }
 
-    void reset_target() { SDL_SetRenderTarget(m_sdl_renderer, nullptr); }
+    // Call after using get_sdl_renderer() to change its state directly.
+    void sync_state() {
+        flush();
+        m_state.sync();
+    }
 
     template <typename T> void draw_point(vec2d_t<T> point) {
+        GFX_PROFILE_TIME(renderer);
+        if(m_batching) {
+            m_commands.record_point(
+                {static_cast<float>(point.x), static_cast<float>(point.y)});
+            return;
+        }
         if(SDL_RenderDrawPoint(m_sdl_renderer, point.x, point.y) < 0) {
             throw std::runtime_error{
                 fmt::format("couldn't draw point: {}", SDL_GetError())};
         }
+        GFX_PROFILE_COUNT(draw_calls, 1);
+        GFX_PROFILE_COUNT(primitives, 1);
     }
 
     template <typename T> void draw_line(vec2d_t<T> from, vec2d_t<T> to) {
+        GFX_PROFILE_TIME(renderer);
+        if(m_batching) {
+            m_commands.record_line(
+                {static_cast<float>(from.x), static_cast<float>(from.y)},
+                {static_cast<float>(to.x), static_cast<float>(to.y)});
+            return;
+        }
         if(SDL_RenderDrawLine(m_sdl_renderer, from.x, from.y, to.x, to.y) < 0) {
             throw std::runtime_error{
                 fmt::format("couldn't draw line: {}", SDL_GetError())};
         }
+        GFX_PROFILE_COUNT(draw_calls, 1);
+        GFX_PROFILE_COUNT(primitives, 1);
     }
 
     void draw_lines(std::span<SDL_Point> points) {
+        GFX_PROFILE_TIME(renderer);
+        if(m_batching) {
+            m_fpoints.clear();
+            for(auto const &p : points) {
+                m_fpoints.push_back(
+                    {static_cast<float>(p.x), static_cast<float>(p.y)});
+            }
+            m_commands.record_lines(m_fpoints);
+            return;
+        }
         SDL_RenderDrawLines(m_sdl_renderer, points.data(),
                             static_cast<int>(points.size()));
+        GFX_PROFILE_COUNT(draw_calls, 1);
+        GFX_PROFILE_COUNT(primitives, points.empty() ? 0 : points.size() - 1);
+    }
+
+    void draw_lines(std::span<SDL_FPoint const> points) {
+        GFX_PROFILE_TIME(renderer);
+        if(m_batching) {
+            m_commands.record_lines(points);
+            return;
+        }
+        if(SDL_RenderDrawLinesF(m_sdl_renderer, points.data(),
+                                static_cast<int>(points.size())) < 0) {
+            throw std::runtime_error{
+                fmt::format("couldn't draw lines: {}", SDL_GetError())};
+        }
+        GFX_PROFILE_COUNT(draw_calls, 1);
+        GFX_PROFILE_COUNT(primitives, points.empty() ? 0 : points.size() - 1);
+    }
+
+    void draw_geometry(std::span<SDL_Vertex const> vertices,
+                       std::span<int const>        indices = {},
+                       SDL_Texture                 *texture = nullptr) {
+        GFX_PROFILE_TIME(renderer);
+        if(m_batching) {
+            m_commands.record_geometry(texture, vertices, indices);
+            return;
+        }
+        if(SDL_RenderGeometry(m_sdl_renderer, texture, vertices.data(),
+                              static_cast<int>(vertices.size()),
+                              indices.empty() ? nullptr : indices.data(),
+                              static_cast<int>(indices.size())) < 0) {
+            throw std::runtime_error{
+                fmt::format("couldn't render geometry: {}", SDL_GetError())};
+        }
+        GFX_PROFILE_COUNT(draw_calls, 1);
+        GFX_PROFILE_COUNT(primitives, (indices.empty() ? vertices.size()
+                                                       : indices.size()) /
+                                          3);
+    }
+
+    // In the current draw color and blend mode.
+    template <typename T> void fill_rect(rect_t<T> const &rect) {
+        GFX_PROFILE_TIME(renderer);
+        SDL_FRect r{static_cast<float>(rect.position.x),
+                    static_cast<float>(rect.position.y),
+                    static_cast<float>(rect.size.x),
+                    static_cast<float>(rect.size.y)};
+        if(m_batching) {
+            auto c = m_commands.get_color().get_sdl_color();
+            std::array<SDL_Vertex, 4> quad{
+                {{{r.x, r.y}, c, {}},
+                 {{r.x + r.w, r.y}, c, {}},
+                 {{r.x, r.y + r.h}, c, {}},
+                 {{r.x + r.w, r.y + r.h}, c, {}}}};
+            constexpr std::array<int, 6> indices{0, 1, 2, 2, 1, 3};
+            m_commands.record_geometry(nullptr, quad, indices);
+            return;
+        }
+        if(SDL_RenderFillRectF(m_sdl_renderer, &r) < 0) {
+            throw std::runtime_error{
+                fmt::format("couldn't fill rect: {}", SDL_GetError())};
+        }
+        GFX_PROFILE_COUNT(draw_calls, 1);
+        GFX_PROFILE_COUNT(primitives, 1);
     }
 
     template <typename T>
     void draw_circle(vec2d_t<T> center, T radius, size_t num_points) {
-        std::vector<SDL_Point> points;
-        points.reserve(num_points + 1);
-        for(size_t i = 0; i < num_points + 1; ++i) {
-            double angle = static_cast<double>(i) * 2 * M_PI /
-                           static_cast<double>(num_points);
-            points.push_back(vec_to_point(
-                center + vec2d_t<T>{radius * cos(angle), radius * sin(angle)}));
+        GFX_PROFILE_TIME(renderer);
+        auto cx = static_cast<float>(center.x);
+        auto cy = static_cast<float>(center.y);
+        auto r  = static_cast<float>(radius);
+        m_fpoints.clear();
+        for(auto const &p : unit_circle(num_points)) {
+            m_fpoints.push_back({cx + r * p.x, cy + r * p.y});
         }
-        draw_lines(points);
+        draw_lines(std::span<SDL_FPoint const>{m_fpoints});
+    }
+
+    template <typename T> void draw_circle(vec2d_t<T> center, T radius) {
+        draw_circle(center, radius,
+                    circle_segments(static_cast<double>(radius)));
+    }
+
+    template <typename T>
+    void draw_circle(vec2d_t<T> center, T radius, rect_t<T> view) {
+        auto zoom = zoom_for(view);
+        auto p    = world_to_window(static_cast<vec2d_t<double>>(center),
+                                    static_cast<rect_t<double>>(view),
+                                    m_window_size.x);
+        draw_circle(p, radius * zoom, circle_segments(radius * zoom));
+    }
+
+    // Filled circles are triangle fans in the current draw color; a
+    // num_points of 0 picks the segment count from the radius.
+    template <typename T>
+    void fill_circle(vec2d_t<T> center, T radius, size_t num_points = 0) {
+        GFX_PROFILE_TIME(renderer);
+        auto r = static_cast<float>(radius);
+        m_vertices.clear();
+        m_indices.clear();
+        append_circle_fan(
+            {static_cast<float>(center.x), static_cast<float>(center.y)}, r,
+            num_points == 0 ? circle_segments(r) : num_points,
+            get_draw_color().get_sdl_color());
+        draw_geometry(m_vertices, m_indices);
+    }
+
+    template <typename T>
+    void fill_circle(vec2d_t<T> center, T radius, rect_t<T> view) {
+        auto zoom = zoom_for(view);
+        auto p    = world_to_window(static_cast<vec2d_t<double>>(center),
+                                    static_cast<rect_t<double>>(view),
+                                    m_window_size.x);
+        fill_circle(p, radius * zoom);
+    }
+
+    // Draws all circles, in world coordinates, with a single geometry call.
+    void fill_circles(std::span<circle_instance const> circles,
+                      rect_t<double>                    view) {
+        GFX_PROFILE_TIME(renderer);
+        auto zoom = zoom_for(view);
+        m_vertices.clear();
+        m_indices.clear();
+        for(auto const &c : circles) {
+            auto p = (c.center - view.position) * zoom;
+            auto r = c.radius * zoom;
+            append_circle_fan({static_cast<float>(p.x), static_cast<float>(p.y)},
+                              static_cast<float>(r), circle_segments(r),
+                              c.fill.get_sdl_color());
+        }
+        draw_geometry(m_vertices, m_indices);
     }
 
     template <typename T>
     void draw_texture(texture const &texture, vec2d_t<T> position, rect_t<T> view,
                       bool resize = true) {
-        draw_texture(texture, position, 0, {0, 0}, view, resize);
+        draw_texture(texture.region(), position, 0, {0, 0}, view, resize);
     }
 
     template <typename T>
     void draw_texture(texture const &texture, vec2d_t<T> position, double angle,
                       vec2d_t<T> center, rect_t<T> view, bool resize = true) {
+        draw_texture(texture.region(), position, angle, center, view, resize);
+    }
+
+    template <typename T>
+    void draw_texture(texture_region const &region, vec2d_t<T> position,
+                      rect_t<T> view, bool resize = true) {
+        draw_texture(region, position, 0, {0, 0}, view, resize);
+    }
+
+    template <typename T>
+    void draw_texture(texture_region const &region, vec2d_t<T> position,
+                      double angle, vec2d_t<T> center, rect_t<T> view,
+                      bool resize = true) {
+        GFX_PROFILE_TIME(renderer);
         SDL_Rect rect;
         auto     zoom = m_window_size.x / view.size.x;
-        SDL_QueryTexture(texture.get_sdl_texture(), nullptr, nullptr, &rect.w,
-                         &rect.h);
+        rect.w        = region.bounds.w;
+        rect.h        = region.bounds.h;
         if(resize) {
             rect.w *= zoom;
             rect.h *= zoom;
@@ -149,39 +597,114 @@ class renderer {
         rect.y = p.y;
 
         SDL_Point point = vec_to_point(center);
-        SDL_RenderCopyEx(m_sdl_renderer, texture.get_sdl_texture(), nullptr,
-                         &rect, angle, &point, SDL_FLIP_NONE);
+        if(get_target() == nullptr && !reaches_window(rect, point, angle)) {
+            GFX_PROFILE_COUNT(draws_culled, 1);
+            return;
+        }
+        flush();
+        SDL_RenderCopyEx(m_sdl_renderer, region.source->get_sdl_texture(),
+                         &region.bounds, &rect, angle, &point, SDL_FLIP_NONE);
+        GFX_PROFILE_COUNT(draw_calls, 1);
+        GFX_PROFILE_COUNT(primitives, 1);
     }
 
+    // The texture is only needed for this draw. When batching it comes from
+    // the pool and is released at once, so the recorded draw still finds it
+    // until present() or end_frame(); otherwise it is destroyed right away.
     template <typename T>
     void draw_wrapped_text(font &font, char const *text, vec2d_t<T> position,
                            uint32_t width, color color) {
-        surface  sur{TTF_RenderUTF8_Blended_Wrapped(
+        GFX_PROFILE_TIME(renderer);
+        surface sur{TTF_RenderUTF8_Blended_Wrapped(
             font.get_ttf_font(), text, color.get_sdl_color(), width)};
-        texture  texture{m_sdl_renderer, sur};
-        SDL_Rect rect;
-        SDL_QueryTexture(texture.get_sdl_texture(), nullptr, nullptr, &rect.w,
-                         &rect.h);
-        rect.x = position.x;
-        rect.y = position.y;
-        SDL_RenderCopy(m_sdl_renderer, texture.get_sdl_texture(), nullptr,
-                       &rect);
+        GFX_PROFILE_COUNT(text_rasterizations, 1);
+        if(!m_batching) {
+            texture tex{m_sdl_renderer, sur};
+            draw_text_quad(tex, position);
+            return;
+        }
+        auto handle = m_textures.create(m_sdl_renderer, sur);
+        draw_text_quad(*m_textures.get(handle), position);
+        m_textures.release(handle);
+    }
+
+    // Calls draw(id, bounds) only for the objects in the index that overlap
+    // the view, so the cost follows what is on screen rather than the world.
+    // draw_texture() with a view skips the draws into the window that still
+    // end up outside it, e.g. for objects whose bounds miss their sprite.
+    template <typename T, typename Id, typename F>
+    void draw_visible(spatial_grid<T, Id> const &index, rect_t<T> const &view,
+                      F &&draw) {
+        index.query(view, std::forward<F>(draw));
+    }
+
+    // Draws text from the font's glyph atlas as one mesh per atlas page, so
+    // changing strings only cost an upload the first time a glyph is seen.
+    template <typename T>
+    void draw_text(font &font, std::string_view text, vec2d_t<T> position,
+                   color color, uint32_t wrap_width = 0) {
+        GFX_PROFILE_TIME(renderer);
+        auto &atlas = get_glyph_atlas(font);
+        atlas.build_text(text,
+                         {static_cast<float>(position.x),
+                          static_cast<float>(position.y)},
+                         color, wrap_width);
+        for(uint32_t page = 0; page < atlas.page_count(); ++page) {
+            auto const &mesh = atlas.get_mesh(page);
+            if(!mesh.indices.empty()) {
+                draw_geometry(mesh.vertices, mesh.indices,
+                              atlas.get_page(page).get_sdl_texture());
+            }
+        }
     }
 
     template <typename T>
     auto text_to_texture(font &font, char const *text, color color)
         -> std::shared_ptr<texture> {
+        GFX_PROFILE_TIME(renderer);
+        text_cache::key key{font.get_id(), text, color.packed()};
+        if(auto cached = m_text_cache.find(key)) {
+            return cached;
+        }
         surface sur{TTF_RenderUTF8_Blended(font.get_ttf_font(), text,
                                            color.get_sdl_color())};
-        return std::make_shared<texture>(m_sdl_renderer, sur);
+        GFX_PROFILE_COUNT(text_rasterizations, 1);
+        return m_text_cache.insert(
+            key, std::make_shared<texture>(m_sdl_renderer, sur));
     }
 
     template <typename T>
     auto wrapped_text_to_texture(font &font, char const *text, color color,
                                  size_t width) {
+        GFX_PROFILE_TIME(renderer);
+        text_cache::key key{font.get_id(), text, color.packed(),
+                            static_cast<uint32_t>(width)};
+        if(auto cached = m_text_cache.find(key)) {
+            return cached;
+        }
         surface sur{TTF_RenderUTF8_Blended_Wrapped(
             font.get_ttf_font(), text, color.get_sdl_color(), width)};
-        return std::make_shared<texture>(m_sdl_renderer, sur);
+        GFX_PROFILE_COUNT(text_rasterizations, 1);
+        return m_text_cache.insert(
+            key, std::make_shared<texture>(m_sdl_renderer, sur));
+    }
+
+    [[nodiscard]] auto get_text_cache() -> text_cache & { return m_text_cache; }
+
+    // The font's glyph atlas on this renderer, created on first use. It
+    // lives as long as the renderer unless released, e.g. when the font is
+    // closed for good.
+    [[nodiscard]] auto get_glyph_atlas(font &font) -> glyph_atlas & {
+        return m_glyph_atlases
+            .try_emplace(font.get_id(), m_sdl_renderer, font.get_ttf_font())
+            .first->second;
+    }
+    void release_glyph_atlas(font const &font) {
+        m_glyph_atlases.erase(font.get_id());
+    }
+
+    [[nodiscard]] auto get_window_size() const -> vec2d_t<int> {
+        return m_window_size;
     }
 
     auto get_sdl_renderer() -> SDL_Renderer * { return m_sdl_renderer; }
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+
+#include <SDL2/SDL_ttf.h>
+
+namespace gfx {
+
+class font;
+class surface;
+
+// A whole file mapped read-only into memory. Pages are read on first touch
+// and shared with every other mapping of the file.
+class mapped_file {
+    std::byte const *m_data{};
+    size_t           m_size{};
+
+  public:
+    explicit mapped_file(std::string const &path);
+
+    mapped_file(mapped_file const &)                     = delete;
+    mapped_file(mapped_file &&)                          = delete;
+    auto operator=(mapped_file const &) -> mapped_file & = delete;
+    auto operator=(mapped_file &&) -> mapped_file      & = delete;
+    ~mapped_file();
+
+    [[nodiscard]] auto data() const -> std::span<std::byte const> {
+        return {m_data, m_size};
+    }
+    [[nodiscard]] auto size() const -> size_t { return m_size; }
+};
+
+// Totals since the registry was created.
+struct resource_stats {
+    size_t files_mapped{};
+    size_t bytes_mapped{};
+    size_t fonts_opened{};
+    size_t font_hits{};
+};
+
+// Maps every asset file once and opens fonts and images from that memory.
+// Fonts are shared between everyone asking for the same (path, size,
+// style) while any of them holds on to it. Images are decoded once, so
+// their files stay mapped only if something else mapped them too. Safe to
+// use from any thread.
+class resource_registry {
+    struct font_key {
+        std::string path;
+        int         size{};
+        int         style{};
+
+        auto operator==(font_key const &) const -> bool = default;
+    };
+
+    struct font_key_hasher {
+        auto operator()(font_key const &k) const -> size_t;
+    };
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, std::shared_ptr<mapped_file const>>
+        m_files;
+    std::unordered_map<font_key, std::weak_ptr<font>, font_key_hasher>
+                   m_fonts;
+    resource_stats m_stats;
+
+    auto map_locked(std::string const &path)
+        -> std::shared_ptr<mapped_file const>;
+
+  public:
+    auto map(std::string const &path) -> std::shared_ptr<mapped_file const>;
+
+    auto get_font(std::string const &path, int size,
+                  int style = TTF_STYLE_NORMAL) -> std::shared_ptr<font>;
+
+    // Decoded images aren't shared, since surfaces are mutable.
+    auto load_surface(std::string const &path) -> std::shared_ptr<surface>;
+
+    // Unmaps the files nothing but the registry uses any more, e.g. those of
+    // released fonts, and forgets those fonts.
+    void trim();
+
+    [[nodiscard]] auto get_stats() const -> resource_stats;
+
+    // The registry behind open_font() and create_surface_from_file().
+    [[nodiscard]] static auto shared() -> resource_registry &;
+};
+
+} // namespace gfx
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include "atlas.h"
+#include "color.h"
+#include "constants.h"
+#include "glyph_atlas.h"
+#include "rect.h"
+#include "texture.h"
+#include "vec2d.h"
+
+namespace gfx {
+
+class font;
+class renderer;
+
+// Signed distance of every pixel of an alpha mask to the shape's edge, in
+// pixels, positive inside, via an exact Euclidean distance transform. The
+// result maps [-spread, spread] onto [0, 255] with the edge at 128.
+[[nodiscard]] auto signed_distance_field(std::span<uint8_t const> alpha,
+                                         int width, int height, int spread)
+    -> std::vector<uint8_t>;
+
+struct text_style {
+    color fill{color_white};
+    // Widths in output pixels; both are capped at the font's spread.
+    float outline_width{};
+    color outline{color_black};
+    float glow_radius{};
+    color glow{color_white};
+};
+
+// Text drawn at any size from distance fields computed once per glyph.
+//
+// SDL_Renderer has no shaders to threshold a distance field per pixel, so
+// glyph images are instead resampled from the fields on the CPU, once per
+// size bucket (steps of a quarter octave) and style, and drawn from atlas
+// pages scaled to the exact size. Sizes whose glyphs wouldn't fit a page
+// are stretched from the largest bucket that does. Each bucket packs its
+// own pages, which are small so that a bucket with a few glyphs costs
+// little, and past max_pages the least recently drawn bucket gives its
+// pages up. SDL_ttf doesn't expose outlines, so the fields come from glyphs
+// rasterized once at the source font's size, which should be large (48 or
+// more) for clean edges. The source font must outlive this, and the pages
+// belong to the renderer last drawn to: destroy this or call
+// release_textures() before that renderer.
+class sdf_font {
+    constexpr static int    default_spread    = 8;
+    constexpr static int    default_page_size = 256;
+    constexpr static size_t default_max_pages = 64;
+
+    struct field_glyph {
+        std::vector<uint8_t> field;
+        int                  width{};
+        int                  height{};
+        int                  offset_x{};
+        int                  advance{};
+    };
+
+    struct placed_glyph {
+        uint32_t page{};
+        SDL_Rect source{};
+    };
+
+    struct bucket {
+        int                                        step{};
+        text_style                                 style;
+        std::unordered_map<uint32_t, placed_glyph> glyphs;
+        std::vector<uint32_t>                      pages;
+        uint64_t                                   last_used{};
+    };
+
+    struct placement {
+        uint32_t codepoint;
+        int      x;
+        int      y;
+    };
+
+    TTF_Font                                 *m_font;
+    int                                       m_spread;
+    int                                       m_page_size;
+    size_t                                    m_max_pages;
+    int                                       m_height;
+    int                                       m_line_skip;
+    std::unordered_map<uint32_t, field_glyph> m_fields;
+    std::list<bucket>                         m_buckets;
+    std::vector<texture>                      m_pages;
+    std::vector<skyline_packer>               m_packers;
+    std::vector<uint32_t>                     m_free_pages;
+    uint64_t                                  m_draws{};
+    SDL_Renderer                             *m_sdl_renderer{};
+
+    std::vector<uint32_t>  m_codepoints;
+    std::vector<placement> m_placements;
+    std::vector<text_mesh> m_meshes;
+
+    auto get_field(uint32_t codepoint) -> field_glyph const &;
+    auto get_bucket(int step, text_style const &style) -> bucket &;
+    [[nodiscard]] auto fitting_step(int step) const -> int;
+    auto place(renderer &r, bucket &b, uint32_t codepoint)
+        -> placed_glyph const &;
+    auto add_page(renderer &r, bucket const &owner) -> uint32_t;
+    auto allocate(renderer &r, bucket &b, int width, int height)
+        -> std::pair<uint32_t, SDL_Point>;
+    // In pixels of the source font.
+    auto layout(std::string_view text, int wrap_width) -> vec2d_t<int>;
+
+  public:
+    explicit sdf_font(font &source, int spread = default_spread,
+                      int    page_size = default_page_size,
+                      size_t max_pages = default_max_pages);
+
+    // size is the font height in pixels, i.e. TTF_FontHeight() of the font
+    // opened at the wanted size. Wrapping is in pixels too, 0 disabling it.
+    void draw(renderer &r, std::string_view text, vec2d_t<double> position,
+              double size, text_style const &style = {},
+              uint32_t wrap_width = 0);
+
+    // The same in world coordinates, so the text zooms with the view.
+    void draw(renderer &r, std::string_view text, vec2d_t<double> position,
+              double size, rect_t<double> view, text_style const &style = {},
+              uint32_t wrap_width = 0);
+
+    [[nodiscard]] auto measure(std::string_view text, double size,
+                               uint32_t wrap_width = 0) -> vec2d_t<double>;
+
+    // The font height the distance fields were made at.
+    [[nodiscard]] auto reference_height() const -> int { return m_height; }
+    [[nodiscard]] auto bucket_count() const -> size_t {
+        return m_buckets.size();
+    }
+    [[nodiscard]] auto page_count() const -> size_t { return m_pages.size(); }
+
+    // Drops the resampled glyphs, keeping the distance fields.
+    void clear_cache();
+    // Also destroys the atlas pages.
+    void release_textures();
+};
+
+} // namespace gfx
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "vec2d.h"
+
+namespace gfx {
+
+// Cells over the whole int plane, for worlds too large or too empty for a
+// dense tilemap. Cells are stored in square chunks of 2^ChunkBits cells a
+// side, each one block of memory, found through an open-addressed table
+// keyed on the chunk position, so neighbouring cells are usually in the same
+// chunk and a lookup is one probe. A chunk is freed with its last cell.
+// Values stay put until their chunk is freed.
+template <typename T, int ChunkBits = 4> class sparse_grid {
+  public:
+    using position = vec2d_t<int>;
+
+    constexpr static int    chunk_side = 1 << ChunkBits;
+    constexpr static size_t chunk_area = size_t{chunk_side} * chunk_side;
+
+  private:
+    struct chunk {
+        position                                     key;
+        std::array<T, chunk_area>                    cells{};
+        std::array<uint64_t, (chunk_area + 63) / 64> occupied{};
+        uint32_t                                     count{};
+
+        [[nodiscard]] auto has(size_t i) const -> bool {
+            return ((occupied[i / 64] >> (i % 64)) & 1U) != 0;
+        }
+    };
+
+    // Chunk index + 1 per slot, 0 for empty. Kept at most half full.
+    std::vector<uint32_t>               m_index;
+    std::vector<std::unique_ptr<chunk>> m_chunks;
+    size_t                              m_size{};
+
+    [[nodiscard]] static auto chunk_of(position p) -> position {
+        // Arithmetic shifts round towards negative infinity.
+        return {p.x >> ChunkBits, p.y >> ChunkBits};
+    }
+
+    [[nodiscard]] static auto cell_of(position p) -> size_t {
+        constexpr int mask = chunk_side - 1;
+        return static_cast<size_t>((p.y & mask) * chunk_side + (p.x & mask));
+    }
+
+    [[nodiscard]] auto home(position key) const -> size_t {
+        return vec2d_hasher<int>{}(key) & (m_index.size() - 1);
+    }
+
+    [[nodiscard]] auto slot_of(position key) const -> size_t {
+        if(m_index.empty()) {
+            return 0;
+        }
+        auto mask = m_index.size() - 1;
+        for(auto s = home(key);; s = (s + 1) & mask) {
+            if(m_index[s] == 0 || m_chunks[m_index[s] - 1]->key == key) {
+                return s;
+            }
+        }
+    }
+
+    [[nodiscard]] auto find_chunk(position key) const -> chunk * {
+        if(m_index.empty()) {
+            return nullptr;
+        }
+        auto entry = m_index[slot_of(key)];
+        return entry != 0 ? m_chunks[entry - 1].get() : nullptr;
+    }
+
+    void rehash(size_t capacity) {
+        m_index.assign(capacity, 0);
+        for(size_t i = 0; i < m_chunks.size(); ++i) {
+            m_index[slot_of(m_chunks[i]->key)] = static_cast<uint32_t>(i + 1);
+        }
+    }
+
+    auto get_or_add_chunk(position key) -> chunk & {
+        if(auto *c = find_chunk(key)) {
+            return *c;
+        }
+        if((m_chunks.size() + 1) * 2 > m_index.size()) {
+            rehash(std::max<size_t>(16, m_index.size() * 2));
+        }
+        m_chunks.push_back(std::make_unique<chunk>());
+        m_chunks.back()->key  = key;
+        m_index[slot_of(key)] = static_cast<uint32_t>(m_chunks.size());
+        return *m_chunks.back();
+    }
+
+    void remove_chunk(position key) {
+        auto mask  = m_index.size() - 1;
+        auto slot  = slot_of(key);
+        auto index = m_index[slot] - 1;
+
+        // Backward-shift deletion: pull later entries of the probe run into
+        // the hole unless that would move them before their home slot.
+        for(auto next = (slot + 1) & mask; m_index[next] != 0;
+            next      = (next + 1) & mask) {
+            auto h = home(m_chunks[m_index[next] - 1]->key);
+            if(((next - h) & mask) >= ((next - slot) & mask)) {
+                m_index[slot] = m_index[next];
+                slot          = next;
+            }
+        }
+        m_index[slot] = 0;
+
+        if(index + 1 != m_chunks.size()) {
+            m_index[slot_of(m_chunks.back()->key)] = index + 1;
+            m_chunks[index] = std::move(m_chunks.back());
+        }
+        m_chunks.pop_back();
+    }
+
+  public:
+    [[nodiscard]] auto find(position p) -> T * {
+        auto *c = find_chunk(chunk_of(p));
+        auto  i = cell_of(p);
+        return c != nullptr && c->has(i) ? &c->cells[i] : nullptr;
+    }
+    [[nodiscard]] auto find(position p) const -> T const * {
+        auto *c = find_chunk(chunk_of(p));
+        auto  i = cell_of(p);
+        return c != nullptr && c->has(i) ? &c->cells[i] : nullptr;
+    }
+    [[nodiscard]] auto contains(position p) const -> bool {
+        return find(p) != nullptr;
+    }
+
+    // Adds a default value if the cell is empty.
+    auto operator[](position p) -> T & {
+        auto &c = get_or_add_chunk(chunk_of(p));
+        auto  i = cell_of(p);
+        if(!c.has(i)) {
+            c.occupied[i / 64] |= uint64_t{1} << (i % 64);
+            ++c.count;
+            ++m_size;
+        }
+        return c.cells[i];
+    }
+
+    auto set(position p, T value) -> T & {
+        auto &cell = (*this)[p];
+        cell       = std::move(value);
+        return cell;
+    }
+
+    auto erase(position p) -> bool {
+        auto key = chunk_of(p);
+        auto *c  = find_chunk(key);
+        auto  i  = cell_of(p);
+        if(c == nullptr || !c->has(i)) {
+            return false;
+        }
+        c->occupied[i / 64] &= ~(uint64_t{1} << (i % 64));
+        c->cells[i] = T{};
+        --m_size;
+        if(--c->count == 0) {
+            remove_chunk(key);
+        }
+        return true;
+    }
+
+    void clear() {
+        m_index.clear();
+        m_chunks.clear();
+        m_size = 0;
+    }
+
+    [[nodiscard]] auto size() const -> size_t { return m_size; }
+    [[nodiscard]] auto empty() const -> bool { return m_size == 0; }
+    [[nodiscard]] auto chunk_count() const -> size_t { return m_chunks.size(); }
+
+    // Calls fn(position, T &) for the occupied cells around p: the four
+    // sharing an edge, plus the four corners if diagonal is set.
+    template <typename F>
+    void for_each_neighbor(position p, F &&fn, bool diagonal = true) {
+        constexpr std::array<position, 8> offsets{
+            {{0, -1}, {-1, 0}, {1, 0}, {0, 1},
+             {-1, -1}, {1, -1}, {-1, 1}, {1, 1}}};
+        auto   count = diagonal ? offsets.size() : 4;
+        auto   key   = chunk_of(p);
+        chunk *c     = find_chunk(key);
+        for(size_t k = 0; k < count; ++k) {
+            position n{p.x + offsets[k].x, p.y + offsets[k].y};
+            auto     nkey  = chunk_of(n);
+            chunk   *owner = nkey == key ? c : find_chunk(nkey);
+            auto     i     = cell_of(n);
+            if(owner != nullptr && owner->has(i)) {
+                fn(n, owner->cells[i]);
+            }
+        }
+    }
+
+    // Calls fn(position, T &) for every occupied cell in row-major order,
+    // the order vec2d_to_index gives within any rectangle.
+    template <typename F> void for_each(F &&fn) {
+        std::vector<chunk *> order;
+        order.reserve(m_chunks.size());
+        for(auto &c : m_chunks) {
+            order.push_back(c.get());
+        }
+        std::sort(order.begin(), order.end(),
+                  [](chunk const *a, chunk const *b) {
+                      return a->key < b->key;
+                  });
+
+        for(size_t first = 0; first < order.size();) {
+            auto last = first;
+            while(last < order.size() &&
+                  order[last]->key.y == order[first]->key.y) {
+                ++last;
+            }
+            // One row of chunks, walked a row of cells at a time.
+            for(int y = 0; y < chunk_side; ++y) {
+                for(auto k = first; k < last; ++k) {
+                    auto &c = *order[k];
+                    for(int x = 0; x < chunk_side; ++x) {
+                        auto i = static_cast<size_t>(y * chunk_side + x);
+                        if(c.has(i)) {
+                            fn(position{c.key.x * chunk_side + x,
+                                        c.key.y * chunk_side + y},
+                               c.cells[i]);
+                        }
+                    }
+                }
+            }
+            first = last;
+        }
+    }
+};
+
+} // namespace gfx
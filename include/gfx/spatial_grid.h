@@ -0,0 +1,227 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "rect.h"
+#include "vec2d.h"
+
+namespace gfx {
+
+// A loose uniform grid over a fixed world rectangle. Every object no larger
+// than a cell lives in the cell holding the center of its bounds, so queries
+// only widen the searched area by half a cell. Larger objects are kept in a
+// list that every query checks, so pick a cell size above the size of most
+// objects. Objects outside the world rectangle are kept in the border cells.
+template <typename T, typename Id> class spatial_grid {
+  public:
+    using handle = uint32_t;
+
+    constexpr static handle invalid_handle = std::numeric_limits<handle>::max();
+
+  private:
+    struct entry {
+        rect_t<T> bounds;
+        Id        id{};
+        uint32_t  cell{};
+        uint32_t  slot{};
+        bool      live{};
+    };
+
+    rect_t<T>                        m_bounds;
+    T                                m_cell_size;
+    int                              m_columns;
+    int                              m_rows;
+    std::vector<std::vector<handle>> m_cells;
+    std::vector<handle>              m_large;
+    std::vector<entry>               m_entries;
+    std::vector<handle>              m_free;
+    size_t                           m_size{};
+
+    // The index one past the cells stands for m_large.
+    [[nodiscard]] auto large_cell() const -> uint32_t {
+        return static_cast<uint32_t>(m_cells.size());
+    }
+
+    [[nodiscard]] auto bucket(uint32_t cell) -> std::vector<handle> & {
+        return cell == large_cell() ? m_large : m_cells[cell];
+    }
+
+    [[nodiscard]] auto column_of(T x) const -> int {
+        auto c = static_cast<int>(std::floor(
+            static_cast<double>(x - m_bounds.position.x) / m_cell_size));
+        return std::clamp(c, 0, m_columns - 1);
+    }
+
+    [[nodiscard]] auto row_of(T y) const -> int {
+        auto r = static_cast<int>(std::floor(
+            static_cast<double>(y - m_bounds.position.y) / m_cell_size));
+        return std::clamp(r, 0, m_rows - 1);
+    }
+
+    [[nodiscard]] auto cell_of(rect_t<T> const &bounds) const -> uint32_t {
+        if(bounds.size.x > m_cell_size || bounds.size.y > m_cell_size) {
+            return large_cell();
+        }
+        auto center = bounds.position + bounds.size / T{2};
+        return static_cast<uint32_t>(row_of(center.y) * m_columns +
+                                     column_of(center.x));
+    }
+
+    void link(handle h) {
+        auto &e = m_entries[h];
+        auto &c = bucket(e.cell);
+        e.slot  = static_cast<uint32_t>(c.size());
+        c.push_back(h);
+    }
+
+    void unlink(handle h) {
+        auto &e              = m_entries[h];
+        auto &c              = bucket(e.cell);
+        auto  last           = c.back();
+        c[e.slot]            = last;
+        m_entries[last].slot = e.slot;
+        c.pop_back();
+    }
+
+    [[nodiscard]] auto cell_at(int row, int column) const
+        -> std::vector<handle> const & {
+        return m_cells[static_cast<size_t>(row * m_columns + column)];
+    }
+
+    void validate(handle h) const {
+        if(h >= m_entries.size() || !m_entries[h].live) {
+            throw std::runtime_error{"invalid spatial grid handle"};
+        }
+    }
+
+  public:
+    spatial_grid(rect_t<T> bounds, T cell_size)
+        : m_bounds{bounds}, m_cell_size{cell_size},
+          m_columns{std::max(1, static_cast<int>(std::ceil(
+                                    static_cast<double>(bounds.size.x) /
+                                    static_cast<double>(cell_size))))},
+          m_rows{std::max(1, static_cast<int>(std::ceil(
+                                 static_cast<double>(bounds.size.y) /
+                                 static_cast<double>(cell_size))))},
+          m_cells(static_cast<size_t>(m_columns) *
+                  static_cast<size_t>(m_rows)) {}
+
+    auto insert(Id id, rect_t<T> const &bounds) -> handle {
+        handle h{};
+        if(m_free.empty()) {
+            h = static_cast<handle>(m_entries.size());
+            m_entries.emplace_back();
+        } else {
+            h = m_free.back();
+            m_free.pop_back();
+        }
+        m_entries[h] = {bounds, std::move(id), cell_of(bounds), 0, true};
+        link(h);
+        ++m_size;
+        return h;
+    }
+
+    void move(handle h, rect_t<T> const &bounds) {
+        validate(h);
+        auto cell = cell_of(bounds);
+        if(cell != m_entries[h].cell) {
+            unlink(h);
+            m_entries[h].cell   = cell;
+            m_entries[h].bounds = bounds;
+            link(h);
+        } else {
+            m_entries[h].bounds = bounds;
+        }
+    }
+
+    void remove(handle h) {
+        validate(h);
+        unlink(h);
+        m_entries[h].live = false;
+        m_free.push_back(h);
+        --m_size;
+    }
+
+    void clear() {
+        for(auto &c : m_cells) {
+            c.clear();
+        }
+        m_large.clear();
+        m_entries.clear();
+        m_free.clear();
+        m_size = 0;
+    }
+
+    // Calls visit(id, bounds) for every object overlapping area.
+    template <typename F> void query(rect_t<T> const &area, F &&visit) const {
+        vec2d_t<T> widen{m_cell_size / T{2}, m_cell_size / T{2}};
+        auto       lo = area.position - widen;
+        auto       hi = area.position + area.size + widen;
+        int        c0 = column_of(lo.x);
+        int  c1 = column_of(hi.x);
+        int  r0 = row_of(lo.y);
+        int  r1 = row_of(hi.y);
+        for(int r = r0; r <= r1; ++r) {
+            for(int c = c0; c <= c1; ++c) {
+                for(auto h : cell_at(r, c)) {
+                    auto const &e = m_entries[h];
+                    if(e.bounds.overlaps(area)) {
+                        visit(e.id, e.bounds);
+                    }
+                }
+            }
+        }
+        for(auto h : m_large) {
+            auto const &e = m_entries[h];
+            if(e.bounds.overlaps(area)) {
+                visit(e.id, e.bounds);
+            }
+        }
+    }
+
+    // Calls visit(id, bounds) for every object whose bounds contain point.
+    template <typename F> void query(vec2d_t<T> point, F &&visit) const {
+        auto contains = [&point](rect_t<T> const &b) {
+            return point.x >= b.position.x &&
+                   point.x < b.position.x + b.size.x &&
+                   point.y >= b.position.y && point.y < b.position.y + b.size.y;
+        };
+        vec2d_t<T> widen{m_cell_size / T{2}, m_cell_size / T{2}};
+        auto       lo = point - widen;
+        auto       hi = point + widen;
+        for(int r = row_of(lo.y); r <= row_of(hi.y); ++r) {
+            for(int c = column_of(lo.x); c <= column_of(hi.x); ++c) {
+                for(auto h : cell_at(r, c)) {
+                    if(contains(m_entries[h].bounds)) {
+                        visit(m_entries[h].id, m_entries[h].bounds);
+                    }
+                }
+            }
+        }
+        for(auto h : m_large) {
+            if(contains(m_entries[h].bounds)) {
+                visit(m_entries[h].id, m_entries[h].bounds);
+            }
+        }
+    }
+
+    [[nodiscard]] auto get(handle h) const -> Id const & {
+        validate(h);
+        return m_entries[h].id;
+    }
+    [[nodiscard]] auto bounds(handle h) const -> rect_t<T> const & {
+        validate(h);
+        return m_entries[h].bounds;
+    }
+    [[nodiscard]] auto size() const -> size_t { return m_size; }
+    [[nodiscard]] auto empty() const -> bool { return m_size == 0; }
+    // Objects larger than a cell, which every query checks.
+    [[nodiscard]] auto large_count() const -> size_t { return m_large.size(); }
+};
+
+} // namespace gfx
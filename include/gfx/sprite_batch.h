@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <SDL.h>
+
+#include "color.h"
+#include "constants.h"
+#include "rect.h"
+#include "texture.h"
+#include "vec2d.h"
+
+namespace gfx {
+
+class renderer;
+
+struct sprite {
+    texture_region  region;
+    vec2d_t<double> position;
+    double          angle{};
+    vec2d_t<double> center;
+    color           tint{color_white};
+    int             layer{};
+};
+
+// Collects sprites drawn under one view and submits them with one
+// SDL_RenderGeometry call per run of sprites sharing a texture. Sprites are
+// drawn by layer, lowest first, and in the order they were added within a
+// layer, so sprites from one atlas page batch best when added together.
+// Position, angle and center mean the same as for renderer::draw_texture.
+class sprite_batch {
+    rect_t<double> m_view;
+    bool           m_resize{true};
+
+    std::vector<sprite>     m_sprites;
+    std::vector<uint32_t>   m_order;
+    std::vector<SDL_Vertex> m_vertices;
+    std::vector<int>        m_indices;
+
+  public:
+    void begin(rect_t<double> view, bool resize = true) {
+        m_view   = view;
+        m_resize = resize;
+        m_sprites.clear();
+    }
+
+    void add(texture_region const &region, vec2d_t<double> position,
+             double angle = 0, vec2d_t<double> center = {},
+             color tint = color_white, int layer = 0) {
+        m_sprites.push_back({region, position, angle, center, tint, layer});
+    }
+
+    void add(texture const &texture, vec2d_t<double> position,
+             double angle = 0, vec2d_t<double> center = {},
+             color tint = color_white, int layer = 0) {
+        add(texture.region(), position, angle, center, tint, layer);
+    }
+
+    void submit(renderer &r);
+
+    [[nodiscard]] auto size() const -> size_t { return m_sprites.size(); }
+    [[nodiscard]] auto empty() const -> bool { return m_sprites.empty(); }
+};
+
+} // namespace gfx
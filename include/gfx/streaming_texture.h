@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <SDL.h>
+
+#include "texture.h"
+
+namespace gfx {
+
+struct locked_pixels {
+    std::byte *pixels{};
+    int        pitch{};
+    int        width{};
+    int        height{};
+
+    // One row of RGBA32 pixels.
+    [[nodiscard]] auto row(int y) const -> std::span<uint32_t> {
+        return {reinterpret_cast<uint32_t *>( // NOLINT
+                    pixels + static_cast<ptrdiff_t>(y) * pitch),
+                static_cast<size_t>(width)};
+    }
+};
+
+// A ring of SDL_TEXTUREACCESS_STREAMING textures for frames generated on the
+// CPU. Frames are written into the back buffer while the front buffer is
+// drawn, and swap() moves the ring on. Nothing is allocated per frame.
+//
+// lock() is write-only: SDL doesn't keep the old contents of the locked
+// area, so partial updates that must preserve the rest of the frame should
+// use update() instead.
+class streaming_texture {
+    std::vector<texture> m_buffers;
+    size_t               m_front{0};
+    bool                 m_locked{false};
+
+    [[nodiscard]] auto back_index() const -> size_t {
+        return (m_front + 1) % m_buffers.size();
+    }
+
+  public:
+    constexpr static size_t double_buffered = 2;
+    constexpr static size_t triple_buffered = 3;
+
+    streaming_texture(SDL_Renderer *renderer, int width, int height,
+                      size_t buffers = double_buffered);
+
+    streaming_texture(streaming_texture const &) = delete;
+    streaming_texture(streaming_texture &&)      = default;
+    auto operator=(streaming_texture const &) -> streaming_texture & = delete;
+    auto operator=(streaming_texture &&) -> streaming_texture      & = default;
+    ~streaming_texture() = default;
+
+    [[nodiscard]] auto lock() -> locked_pixels;
+    [[nodiscard]] auto lock(SDL_Rect const &area) -> locked_pixels;
+    void               unlock();
+
+    // Copies RGBA32 pixels into an area of the back buffer, or all of it.
+    void update(void const *pixels, int pitch, SDL_Rect const *area = nullptr);
+
+    // Makes the back buffer the one that is drawn and moves on to the next.
+    void swap();
+
+    [[nodiscard]] auto front() const -> texture const & {
+        return m_buffers[m_front];
+    }
+    [[nodiscard]] auto back() const -> texture const & {
+        return m_buffers[back_index()];
+    }
+    [[nodiscard]] auto buffer_count() const -> size_t {
+        return m_buffers.size();
+    }
+    [[nodiscard]] auto size() const -> vec2d_t<int> {
+        return m_buffers.front().size();
+    }
+};
+
+} // namespace gfx
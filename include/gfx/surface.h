@@ -1,7 +1,12 @@
 #pragma once
 
+#include <cstddef>
+#include <span>
+
 #include "gfx.h"
 
+#include "constants.h"
+
 namespace gfx {
 
 class surface {
@@ -30,10 +35,37 @@ class surface {
         }
     }
 
-    surface(surface const &)                     = delete;
-    surface(surface &&)                          = default;
+    // Decodes an image file already in memory. type is its extension, e.g.
+    // "TGA", which formats without a signature can only be told by.
+    explicit surface(std::span<std::byte const> file,
+                     char const                *type = nullptr)
+        : m_sdl_surface{IMG_LoadTyped_RW(
+              SDL_RWFromConstMem(file.data(), static_cast<int>(file.size())),
+              1, type)},
+          m_owned{true} {
+        if(m_sdl_surface == nullptr) {
+            throw std::runtime_error{
+                fmt::format("error loading image: {}", SDL_GetError())};
+        }
+    }
+
+    surface(surface const &) = delete;
+    surface(surface &&rhs) noexcept
+        : m_sdl_surface{rhs.m_sdl_surface}, m_owned{rhs.m_owned} {
+        rhs.m_sdl_surface = nullptr;
+    }
     auto operator=(surface const &) -> surface & = delete;
-    auto operator=(surface &&) -> surface      & = default;
+    auto operator=(surface &&rhs) noexcept -> surface & {
+        if(this != &rhs) {
+            if(m_owned) {
+                SDL_FreeSurface(m_sdl_surface);
+            }
+            m_sdl_surface     = rhs.m_sdl_surface;
+            m_owned           = rhs.m_owned;
+            rhs.m_sdl_surface = nullptr;
+        }
+        return *this;
+    }
 
     ~surface() {
         if(m_owned) {
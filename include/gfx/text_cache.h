@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace gfx {
+
+class texture;
+
+struct text_cache_stats {
+    size_t hits{};
+    size_t misses{};
+    size_t evictions{};
+    size_t bytes{};
+    size_t entries{};
+
+    [[nodiscard]] auto hit_rate() const -> double {
+        auto lookups = hits + misses;
+        return lookups == 0 ? 0.0
+                            : static_cast<double>(hits) /
+                                  static_cast<double>(lookups);
+    }
+};
+
+// Rendered text textures keyed on (font, text, color, wrap width), evicted
+// least recently used first once the texture memory exceeds the budget.
+class text_cache {
+  public:
+    constexpr static size_t   default_budget = size_t{32} << 20U;
+    constexpr static uint32_t unwrapped = std::numeric_limits<uint32_t>::max();
+
+    struct key {
+        uint64_t         font_id{};
+        std::string_view text;
+        uint32_t         color{};
+        uint32_t         wrap_width{unwrapped};
+
+        auto operator==(key const &) const -> bool = default;
+    };
+
+  private:
+    struct entry {
+        uint64_t                 font_id;
+        std::string              text;
+        uint32_t                 color;
+        uint32_t                 wrap_width;
+        std::shared_ptr<texture> tex;
+        size_t                   bytes;
+    };
+
+    struct key_hasher {
+        auto operator()(key const &k) const -> size_t;
+    };
+
+    using lru_list = std::list<entry>;
+
+    // Keys point into the text of their list entry, which never moves.
+    lru_list                                                m_entries;
+    std::unordered_map<key, lru_list::iterator, key_hasher> m_index;
+    size_t                                                  m_budget;
+    text_cache_stats                                        m_stats;
+
+    void evict_to(size_t budget);
+
+  public:
+    explicit text_cache(size_t budget = default_budget) : m_budget{budget} {}
+
+    // Returns the cached texture and marks it most recently used, or nullptr.
+    [[nodiscard]] auto find(key const &k) -> std::shared_ptr<texture>;
+    auto insert(key const &k, std::shared_ptr<texture> tex)
+        -> std::shared_ptr<texture>;
+
+    void set_budget(size_t budget);
+    [[nodiscard]] auto get_budget() const -> size_t { return m_budget; }
+    void clear();
+
+    [[nodiscard]] auto get_stats() const -> text_cache_stats const & {
+        return m_stats;
+    }
+};
+
+} // namespace gfx
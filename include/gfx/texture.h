@@ -1,24 +1,131 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+
 #include "gfx.h"
 
+#include "profiler.h"
 #include "surface.h"
+#include "vec2d.h"
 
 namespace gfx {
 
+class texture;
+
+// The arguments of SDL_ComposeCustomBlendMode().
+struct blend_factors {
+    SDL_BlendFactor    src_color;
+    SDL_BlendFactor    dst_color;
+    SDL_BlendOperation color_operation;
+    SDL_BlendFactor    src_alpha;
+    SDL_BlendFactor    dst_alpha;
+    SDL_BlendOperation alpha_operation;
+};
+
+// SDL_BLENDMODE_BLEND.
+constexpr blend_factors straight_over{
+    SDL_BLENDFACTOR_SRC_ALPHA, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+    SDL_BLENDOPERATION_ADD, SDL_BLENDFACTOR_ONE,
+    SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD};
+
+// Source-over for premultiplied colors: everything drawn with
+// SDL_BLENDMODE_BLEND into a target cleared to transparent black ends up
+// premultiplied, and copying such a target with SDL_BLENDMODE_BLEND would
+// multiply by alpha a second time.
+constexpr blend_factors premultiplied_over{
+    SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+    SDL_BLENDOPERATION_ADD, SDL_BLENDFACTOR_ONE,
+    SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD};
+
+[[nodiscard]] inline auto to_blend_mode(blend_factors const &f)
+    -> SDL_BlendMode {
+    return SDL_ComposeCustomBlendMode(f.src_color, f.dst_color,
+                                      f.color_operation, f.src_alpha,
+                                      f.dst_alpha, f.alpha_operation);
+}
+
+[[nodiscard]] inline auto premultiplied_blend_mode() -> SDL_BlendMode {
+    return to_blend_mode(premultiplied_over);
+}
+
+// What a renderer makes of src drawn over dst with the given factors,
+// computed on the CPU. SDL's software renderer has no custom blend modes,
+// so this is how their math can be checked without a GPU.
+[[nodiscard]] inline auto blend_pixel(blend_factors const &f, color src,
+                                      color dst) -> color {
+    auto const s = std::array<float, 4>{src.r / 255.0F, src.g / 255.0F,
+                                        src.b / 255.0F, src.a / 255.0F};
+    auto const d = std::array<float, 4>{dst.r / 255.0F, dst.g / 255.0F,
+                                        dst.b / 255.0F, dst.a / 255.0F};
+
+    auto factor = [&](SDL_BlendFactor which, size_t channel) {
+        switch(which) {
+        case SDL_BLENDFACTOR_ZERO: return 0.0F;
+        case SDL_BLENDFACTOR_ONE: return 1.0F;
+        case SDL_BLENDFACTOR_SRC_COLOR: return s[channel];
+        case SDL_BLENDFACTOR_ONE_MINUS_SRC_COLOR: return 1 - s[channel];
+        case SDL_BLENDFACTOR_SRC_ALPHA: return s[3];
+        case SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA: return 1 - s[3];
+        case SDL_BLENDFACTOR_DST_COLOR: return d[channel];
+        case SDL_BLENDFACTOR_ONE_MINUS_DST_COLOR: return 1 - d[channel];
+        case SDL_BLENDFACTOR_DST_ALPHA: return d[3];
+        case SDL_BLENDFACTOR_ONE_MINUS_DST_ALPHA: return 1 - d[3];
+        }
+        return 0.0F;
+    };
+    auto channel = [&](size_t c, SDL_BlendFactor sf, SDL_BlendFactor df,
+                       SDL_BlendOperation op) {
+        auto a = s[c] * factor(sf, c);
+        auto b = d[c] * factor(df, c);
+        auto v = 0.0F;
+        switch(op) {
+        case SDL_BLENDOPERATION_ADD: v = a + b; break;
+        case SDL_BLENDOPERATION_SUBTRACT: v = a - b; break;
+        case SDL_BLENDOPERATION_REV_SUBTRACT: v = b - a; break;
+        case SDL_BLENDOPERATION_MINIMUM: v = std::min(s[c], d[c]); break;
+        case SDL_BLENDOPERATION_MAXIMUM: v = std::max(s[c], d[c]); break;
+        }
+        return static_cast<uint8_t>(
+            std::lround(std::clamp(v, 0.0F, 1.0F) * 255));
+    };
+    return {channel(0, f.src_color, f.dst_color, f.color_operation),
+            channel(1, f.src_color, f.dst_color, f.color_operation),
+            channel(2, f.src_color, f.dst_color, f.color_operation),
+            channel(3, f.src_alpha, f.dst_alpha, f.alpha_operation)};
+}
+
+// A rectangular part of a texture, in texture pixels.
+struct texture_region {
+    texture const *source{};
+    SDL_Rect       bounds{};
+};
+
 class texture {
     SDL_Texture *m_sdl_texture{};
+    int          m_width{};
+    int          m_height{};
+    uint32_t     m_format{};
+    int          m_access{};
+
+    void query() {
+        SDL_QueryTexture(m_sdl_texture, &m_format, &m_access, &m_width,
+                         &m_height);
+    }
 
   public:
-    texture(SDL_Renderer *renderer, int width, int height)
+    texture(SDL_Renderer *renderer, int width, int height,
+            SDL_TextureAccess access = SDL_TEXTUREACCESS_TARGET)
         : m_sdl_texture(SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32,
-                                          SDL_TEXTUREACCESS_TARGET, width,
-                                          height)) {
+                                          access, width, height)) {
         if(m_sdl_texture == nullptr) {
             throw std::runtime_error{
                 fmt::format("couldn't create texture: {}", SDL_GetError())};
         }
         SDL_SetTextureBlendMode(m_sdl_texture, SDL_BLENDMODE_BLEND);
+        query();
+        GFX_PROFILE_COUNT(texture_creations, 1);
     }
 
     texture(SDL_Renderer *renderer, surface const &surface)
@@ -28,27 +135,53 @@ class texture {
             throw std::runtime_error{
                 fmt::format("couldn't create texture: {}", SDL_GetError())};
         }
+        query();
+        GFX_PROFILE_COUNT(texture_creations, 1);
+        GFX_PROFILE_COUNT(texture_uploads, 1);
+        GFX_PROFILE_COUNT(bytes_uploaded, surface.get_sdl_surface()->pitch *
+                                              surface.get_sdl_surface()->h);
     }
 
     texture()                = default;
     texture(texture const &) = delete;
-    texture(texture &&rhs) noexcept {
-        m_sdl_texture     = rhs.m_sdl_texture; // NOLINT
+    texture(texture &&rhs) noexcept
+        : m_sdl_texture{rhs.m_sdl_texture}, m_width{rhs.m_width},
+          m_height{rhs.m_height}, m_format{rhs.m_format},
+          m_access{rhs.m_access} {
         rhs.m_sdl_texture = nullptr;
     }
     auto operator=(texture const &) -> texture & = delete;
     auto operator=(texture &&rhs) noexcept -> texture & {
-        m_sdl_texture     = rhs.m_sdl_texture;
-        rhs.m_sdl_texture = nullptr;
+        if(this != &rhs) {
+            SDL_DestroyTexture(m_sdl_texture);
+            m_sdl_texture     = rhs.m_sdl_texture;
+            m_width           = rhs.m_width;
+            m_height          = rhs.m_height;
+            m_format          = rhs.m_format;
+            m_access          = rhs.m_access;
+            rhs.m_sdl_texture = nullptr;
+        }
         return *this;
     }
     ~texture() { SDL_DestroyTexture(m_sdl_texture); }
 
-    auto size() -> vec2d_t<int> {
-        SDL_Rect sdl_rect;
-        SDL_QueryTexture(m_sdl_texture, nullptr, nullptr, &sdl_rect.w,
-                         &sdl_rect.h);
-        return {sdl_rect.w, sdl_rect.h};
+    // Size, format and access are queried once when the texture is created.
+    [[nodiscard]] auto size() const -> vec2d_t<int> {
+        return {m_width, m_height};
+    }
+    [[nodiscard]] auto width() const -> int { return m_width; }
+    [[nodiscard]] auto height() const -> int { return m_height; }
+    [[nodiscard]] auto format() const -> uint32_t { return m_format; }
+    [[nodiscard]] auto access() const -> int { return m_access; }
+
+    [[nodiscard]] auto region() const -> texture_region {
+        return {this, {0, 0, m_width, m_height}};
+    }
+
+    // Returns false if the renderer doesn't support blend, as SDL's software
+    // renderer doesn't support custom blend modes.
+    auto set_blend_mode(SDL_BlendMode blend) -> bool {
+        return SDL_SetTextureBlendMode(m_sdl_texture, blend) == 0;
     }
 
     [[nodiscard]] auto get_sdl_texture() const -> SDL_Texture * {
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gfx {
+
+// Fixed set of worker threads running queued jobs in submission order.
+// Jobs still queued when the pool is destroyed are dropped; running ones
+// are waited for.
+class thread_pool {
+    std::mutex                        m_mutex;
+    std::condition_variable           m_wake;
+    std::deque<std::function<void()>> m_jobs;
+    bool                              m_stopping{false};
+    std::vector<std::thread>          m_threads;
+
+    void run();
+
+  public:
+    explicit thread_pool(size_t threads = default_thread_count());
+
+    thread_pool(thread_pool const &)                     = delete;
+    thread_pool(thread_pool &&)                          = delete;
+    auto operator=(thread_pool const &) -> thread_pool & = delete;
+    auto operator=(thread_pool &&) -> thread_pool      & = delete;
+    ~thread_pool();
+
+    void submit(std::function<void()> job);
+
+    // Runs fn(i) for every i in [0, count) on the workers and the calling
+    // thread, and returns once all are done. fn must not throw, and this
+    // must not be called from a job running on the same pool.
+    void parallel_for(size_t count, std::function<void(size_t)> const &fn);
+
+    [[nodiscard]] auto size() const -> size_t { return m_threads.size(); }
+    [[nodiscard]] auto pending() -> size_t;
+
+    [[nodiscard]] static auto default_thread_count() -> size_t {
+        auto n = std::thread::hardware_concurrency();
+        return n > 1 ? n - 1 : 1;
+    }
+};
+
+} // namespace gfx
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <SDL.h>
+
+#include "rect.h"
+#include "texture.h"
+#include "vec2d.h"
+
+namespace gfx {
+
+class renderer;
+
+struct tilemap_stats {
+    size_t chunks_drawn{};
+    size_t chunks_rebuilt{};
+    size_t chunks_released{};
+};
+
+// A grid of tiles, each an index into a tileset of texture regions, drawn
+// in world coordinates with its top left corner at the origin and tiles
+// tile_size units across. The map is split into square chunks that are
+// rendered into target textures when first seen or after one of their
+// tiles changed, so a frame costs one geometry call per visible chunk no
+// matter how many tiles it shows. Chunks are drawn with premultiplied
+// alpha, so translucent tiles come out as if drawn directly. At most
+// max_chunk_textures chunks keep a texture: past that, the ones drawn
+// least recently give theirs up and are rebuilt when seen again, unless
+// the view itself needs more. Chunk textures are lost when SDL resets
+// render targets; call invalidate() then.
+class tilemap {
+  public:
+    using tile_id = uint16_t;
+
+    constexpr static tile_id no_tile                    = 0xFFFF;
+    constexpr static int     default_chunk_size         = 16;
+    constexpr static size_t  default_max_chunk_textures = 64;
+
+  private:
+    struct chunk {
+        texture  pixels;
+        bool     dirty{true};
+        bool     empty{true};
+        uint64_t last_drawn{};
+    };
+
+    vec2d_t<int>                m_size;
+    int                         m_tile_size;
+    int                         m_chunk_size;
+    vec2d_t<int>                m_chunks;
+    std::vector<tile_id>        m_tiles;
+    std::vector<chunk>          m_chunk_data;
+    std::vector<texture_region> m_tileset;
+    tilemap_stats               m_stats;
+    size_t                      m_max_chunk_textures;
+    uint64_t                    m_draws{};
+    // Chunks that hold a texture.
+    std::vector<uint32_t>       m_resident;
+
+    std::vector<SDL_Vertex> m_vertices;
+    std::vector<int>        m_indices;
+    std::vector<uint32_t>   m_order;
+
+    [[nodiscard]] auto chunk_index(vec2d_t<int> tile) const -> size_t;
+    void rebuild(renderer &r, vec2d_t<int> c);
+    void release_unused(renderer &r);
+
+  public:
+    // size is in tiles; chunk_size is the side of a chunk in tiles.
+    tilemap(vec2d_t<int> size, int tile_size,
+            int    chunk_size         = default_chunk_size,
+            size_t max_chunk_textures = default_max_chunk_textures);
+
+    // Tiles are drawn stretched to tile_size, whatever the region's size.
+    auto add_tile(texture_region const &region) -> tile_id;
+    auto add_tile(texture const &t) -> tile_id { return add_tile(t.region()); }
+
+    [[nodiscard]] auto get(vec2d_t<int> tile) const -> tile_id;
+    // Marks the tile's chunk for re-rendering unless id is already there.
+    void set(vec2d_t<int> tile, tile_id id);
+    void fill(tile_id id);
+
+    // Re-renders every chunk on its next draw.
+    void invalidate();
+
+    // Rebuilds the dirty chunks overlapping view, then draws those chunks.
+    void draw(renderer &r, rect_t<double> view);
+
+    [[nodiscard]] auto get_size() const -> vec2d_t<int> { return m_size; }
+    [[nodiscard]] auto get_tile_size() const -> int { return m_tile_size; }
+    [[nodiscard]] auto chunk_count() const -> size_t {
+        return m_chunk_data.size();
+    }
+    [[nodiscard]] auto dirty_count() const -> size_t;
+    // Chunks currently holding a texture.
+    [[nodiscard]] auto texture_count() const -> size_t {
+        return m_resident.size();
+    }
+
+    // Counts for the last draw().
+    [[nodiscard]] auto get_stats() const -> tilemap_stats const & {
+        return m_stats;
+    }
+};
+
+} // namespace gfx
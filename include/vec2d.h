@@ -1,7 +1,10 @@
 #pragma once
 
+#include <bit>
 #include <cmath>
+#include <cstdint>
 #include <fmt/format.h>
+#include <type_traits>
 #include <utility>
 
 template <typename T>
@@ -217,10 +220,37 @@ constexpr auto deg_to_rad(T deg) noexcept -> T {
     return deg / 180 * M_PI;
 }
 
+// Every input bit affects every output bit, so neighbouring, negative and
+// far apart positions all spread over the table. -0.0 hashes like 0.0,
+// since the two compare equal.
 template <typename T> struct vec2d_hasher {
+    // The splitmix64 finalizer, a bijection.
+    static constexpr auto mix(uint64_t h) -> uint64_t {
+        h = (h ^ (h >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+        h = (h ^ (h >> 27U)) * 0x94D049BB133111EBULL;
+        return h ^ (h >> 31U);
+    }
+
+    static constexpr auto bits(T v) -> uint64_t {
+        if constexpr(std::is_floating_point_v<T>) {
+            v += T{0}; // turns -0.0 into 0.0
+            if constexpr(sizeof(T) == sizeof(uint32_t)) {
+                return std::bit_cast<uint32_t>(v);
+            } else {
+                return std::bit_cast<uint64_t>(v);
+            }
+        } else {
+            return static_cast<std::make_unsigned_t<T>>(v);
+        }
+    }
+
     auto operator()(vec2d_t<T> const &pos) const -> size_t {
-        const T arbitrary_value = 2048;
-        return pos.x * arbitrary_value + pos.y;
+        if constexpr(sizeof(T) <= sizeof(uint32_t)) {
+            // Both fit in one word, so nothing collides before mixing.
+            return static_cast<size_t>(mix(bits(pos.x) << 32U | bits(pos.y)));
+        } else {
+            return static_cast<size_t>(mix(mix(bits(pos.x)) + bits(pos.y)));
+        }
     }
 };
 
@@ -0,0 +1,385 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#if defined(GFX_HAVE_LZ4)
+#include <lz4.h>
+#endif
+
+#include "gfx/gfx.h"
+
+namespace gfx {
+
+namespace {
+
+// Little endian throughout, with the entries sorted by name:
+//
+//   header | entry * count | names | padding | blob, padding, ...
+//
+// Blobs start on a cache line, so the rows of uncompressed images can be
+// handed to SDL as they are.
+static_assert(std::endian::native == std::endian::little);
+
+constexpr std::array<char, 4> archive_magic{'G', 'F', 'X', 'A'};
+constexpr uint32_t            archive_version = 1;
+constexpr size_t              blob_alignment  = 64;
+
+// Sizes, pitches and LZ4 buffer lengths are ints.
+constexpr uint64_t max_image_size = std::numeric_limits<int>::max();
+constexpr uint64_t max_image_side = max_image_size / bytes_per_pixel;
+// No LZ4 block decompresses to more than this many times its size.
+constexpr uint64_t lz4_max_ratio = 255;
+
+enum class compression : uint32_t { none, lz4 };
+
+struct header {
+    std::array<char, 4> magic{};
+    uint32_t            version{};
+    uint64_t            count{};
+    uint64_t            names_offset{};
+    uint64_t            names_size{};
+};
+
+struct stored_entry {
+    uint64_t    offset{};
+    uint64_t    stored_size{};
+    uint32_t    name_offset{};
+    uint32_t    name_size{};
+    uint32_t    width{};
+    uint32_t    height{};
+    compression method{};
+    uint32_t    reserved{};
+};
+
+auto image_size(uint64_t width, uint64_t height) -> uint64_t {
+    return width * height * bytes_per_pixel;
+}
+
+// Whether an image of this size can be stored in stored_size bytes.
+auto valid_size(stored_entry const &e) -> bool {
+    if(e.width > max_image_side || e.height > max_image_side) {
+        return false;
+    }
+    auto const size = image_size(e.width, e.height);
+    if(size > max_image_size) {
+        return false;
+    }
+    switch(e.method) {
+    case compression::none: return e.stored_size == size;
+    case compression::lz4: return size <= e.stored_size * lz4_max_ratio;
+    }
+    return false;
+}
+
+auto align_up(size_t n) -> size_t {
+    return (n + blob_alignment - 1) / blob_alignment * blob_alignment;
+}
+
+} // namespace
+
+struct asset_archive::entry {
+    stored_entry     stored;
+    std::string_view name;
+};
+
+asset_archive::asset_archive(std::string const &path)
+    : m_file{resource_registry::shared().map(path)} {
+    auto   data = m_file->data();
+    header h;
+    auto   fail = [&path](std::string_view why) {
+        return std::runtime_error{
+            fmt::format("couldn't open archive {}: {}", path, why)};
+    };
+    if(data.size() < sizeof h) {
+        throw fail("too short");
+    }
+    std::memcpy(&h, data.data(), sizeof h);
+    if(h.magic != archive_magic || h.version != archive_version) {
+        throw fail("not an archive of this version");
+    }
+    auto index_end = sizeof h + h.count * sizeof(stored_entry);
+    if(h.count > data.size() / sizeof(stored_entry) ||
+       index_end > h.names_offset || h.names_offset > data.size() ||
+       h.names_size > data.size() - h.names_offset) {
+        throw fail("index out of bounds");
+    }
+    m_count = h.count;
+    m_names = {reinterpret_cast<char const *>(data.data()) + h.names_offset,
+               h.names_size};
+
+    // Checked once here, so lookups can trust the index.
+    for(size_t i = 0; i < m_count; ++i) {
+        auto e = get_entry(i).stored;
+        if(e.name_offset + uint64_t{e.name_size} > m_names.size() ||
+           e.offset > data.size() || e.stored_size > data.size() - e.offset ||
+           !valid_size(e)) {
+            throw fail(fmt::format("entry {} is corrupt", i));
+        }
+    }
+}
+
+auto asset_archive::get_entry(size_t i) const -> entry {
+    // Copied out, since nothing guarantees the mapping is aligned for it.
+    entry e;
+    std::memcpy(&e.stored,
+                m_file->data().data() + sizeof(header) +
+                    i * sizeof(stored_entry),
+                sizeof(stored_entry));
+    e.name = m_names.substr(e.stored.name_offset, e.stored.name_size);
+    return e;
+}
+
+auto asset_archive::find(std::string_view name) const -> std::optional<entry> {
+    size_t first = 0;
+    size_t last  = m_count;
+    while(first < last) {
+        auto mid = first + (last - first) / 2;
+        auto e   = get_entry(mid);
+        if(e.name == name) {
+            return e;
+        }
+        if(e.name < name) {
+            first = mid + 1;
+        } else {
+            last = mid;
+        }
+    }
+    return std::nullopt;
+}
+
+auto asset_archive::at(std::string_view name) const -> entry {
+    if(auto e = find(name)) {
+        return *e;
+    }
+    throw std::runtime_error{fmt::format("no such image in archive: {}", name)};
+}
+
+auto asset_archive::name(size_t i) const -> std::string_view {
+    return get_entry(i).name;
+}
+
+auto asset_archive::contains(std::string_view name) const -> bool {
+    return find(name).has_value();
+}
+
+auto asset_archive::is_compressed(std::string_view name) const -> bool {
+    return at(name).stored.method != compression::none;
+}
+
+auto asset_archive::read(std::string_view name,
+                         std::vector<std::byte> &scratch) const
+    -> archive_image {
+    auto const e      = at(name);
+    auto const stored = m_file->data().subspan(e.stored.offset,
+                                               e.stored.stored_size);
+    archive_image image{static_cast<int>(e.stored.width),
+                        static_cast<int>(e.stored.height), stored};
+    if(e.stored.method == compression::none) {
+        return image;
+    }
+
+#if defined(GFX_HAVE_LZ4)
+    // At most INT_MAX bytes and 255 times the stored size, as checked when
+    // the archive was opened.
+    scratch.resize(image_size(e.stored.width, e.stored.height));
+    auto n = LZ4_decompress_safe(reinterpret_cast<char const *>(stored.data()),
+                                 reinterpret_cast<char *>(scratch.data()),
+                                 static_cast<int>(stored.size()),
+                                 static_cast<int>(scratch.size()));
+    if(n < 0 || static_cast<size_t>(n) != scratch.size()) {
+        throw std::runtime_error{
+            fmt::format("couldn't decompress {} from archive", name)};
+    }
+    image.pixels = scratch;
+    return image;
+#else
+    static_cast<void>(scratch);
+    throw std::runtime_error{fmt::format(
+        "{} is LZ4-compressed, but gfx was built without LZ4", name)};
+#endif
+}
+
+auto asset_archive::load_surface(std::string_view name) const
+    -> std::shared_ptr<surface> {
+    std::vector<std::byte> scratch;
+    auto                   image = read(name, scratch);
+    if(image.pixels.data() == scratch.data()) {
+        auto pixels = std::make_shared<surface>(image.width, image.height);
+        auto *s     = pixels->get_sdl_surface();
+        for(int y = 0; y < image.height; ++y) {
+            auto row = image.pixels.subspan(
+                static_cast<size_t>(y * image.width) * bytes_per_pixel,
+                static_cast<size_t>(image.width) * bytes_per_pixel);
+            std::memcpy(static_cast<std::byte *>(s->pixels) + y * s->pitch,
+                        row.data(), row.size());
+        }
+        return pixels;
+    }
+
+    auto *s = SDL_CreateRGBSurfaceWithFormatFrom(
+        const_cast<std::byte *>(image.pixels.data()), image.width,
+        image.height, bits_per_pixel, image.width * bytes_per_pixel,
+        SDL_PIXELFORMAT_RGBA32);
+    if(s == nullptr) {
+        throw std::runtime_error{
+            fmt::format("couldn't create surface: {}", SDL_GetError())};
+    }
+    // The surface only borrows the pixels, so it keeps the mapping alive.
+    return {new surface{s}, [file = m_file](surface *p) { delete p; }};
+}
+
+auto asset_archive::load_texture(renderer &r, std::string_view name) const
+    -> std::shared_ptr<texture> {
+    std::vector<std::byte> scratch;
+    auto                   image = read(name, scratch);
+    auto pixels = std::make_shared<texture>(r.get_sdl_renderer(), image.width,
+                                            image.height,
+                                            SDL_TEXTUREACCESS_STATIC);
+    if(SDL_UpdateTexture(pixels->get_sdl_texture(), nullptr,
+                         image.pixels.data(),
+                         image.width * bytes_per_pixel) < 0) {
+        throw std::runtime_error{
+            fmt::format("couldn't upload texture: {}", SDL_GetError())};
+    }
+    GFX_PROFILE_COUNT(texture_uploads, 1);
+    GFX_PROFILE_COUNT(bytes_uploaded, image.pixels.size());
+    return pixels;
+}
+
+void archive_writer::add(std::string name, int width, int height,
+                         std::span<std::byte const> pixels) {
+    if(width < 0 || height < 0 ||
+       pixels.size() != image_size(static_cast<uint64_t>(width),
+                                   static_cast<uint64_t>(height))) {
+        throw std::runtime_error{
+            fmt::format("pixels of {} don't match its size", name)};
+    }
+    if(pixels.size() > max_image_size) {
+        throw std::runtime_error{fmt::format("{} is too large", name)};
+    }
+    m_images.push_back({std::move(name), width, height,
+                        std::vector<std::byte>(pixels.begin(), pixels.end())});
+}
+
+void archive_writer::add(std::string name, surface const &image) {
+    auto *source = image.get_sdl_surface();
+    surface converted{SDL_ConvertSurfaceFormat(source, SDL_PIXELFORMAT_RGBA32,
+                                               0)};
+    auto   *s = converted.get_sdl_surface();
+    if(s == nullptr) {
+        throw std::runtime_error{
+            fmt::format("couldn't convert {}: {}", name, SDL_GetError())};
+    }
+    auto const             row = static_cast<size_t>(s->w) * bytes_per_pixel;
+    std::vector<std::byte> pixels(row * static_cast<size_t>(s->h));
+    for(int y = 0; y < s->h; ++y) {
+        std::memcpy(pixels.data() + static_cast<size_t>(y) * row,
+                    static_cast<std::byte const *>(s->pixels) + y * s->pitch,
+                    row);
+    }
+    add(std::move(name), s->w, s->h, pixels);
+}
+
+void archive_writer::save(std::string const &path, bool compress) const {
+    if(compress && !can_compress()) {
+        throw std::runtime_error{"gfx was built without LZ4"};
+    }
+    std::vector<pending_image const *> sorted;
+    for(auto const &i : m_images) {
+        sorted.push_back(&i);
+    }
+    std::sort(sorted.begin(), sorted.end(),
+              [](auto const *a, auto const *b) { return a->name < b->name; });
+    for(size_t i = 1; i < sorted.size(); ++i) {
+        if(sorted[i - 1]->name == sorted[i]->name) {
+            throw std::runtime_error{
+                fmt::format("{} was added twice", sorted[i]->name)};
+        }
+    }
+
+    header h{archive_magic, archive_version, sorted.size(), 0, 0};
+    std::vector<stored_entry> entries(sorted.size());
+    std::string               names;
+    for(size_t i = 0; i < sorted.size(); ++i) {
+        auto &e       = entries[i];
+        e.name_offset = static_cast<uint32_t>(names.size());
+        e.name_size   = static_cast<uint32_t>(sorted[i]->name.size());
+        e.width       = static_cast<uint32_t>(sorted[i]->width);
+        e.height      = static_cast<uint32_t>(sorted[i]->height);
+        names         += sorted[i]->name;
+    }
+    h.names_offset = sizeof h + entries.size() * sizeof(stored_entry);
+    h.names_size   = names.size();
+
+    std::vector<std::vector<std::byte>> blobs(sorted.size());
+    auto offset = align_up(h.names_offset + h.names_size);
+    for(size_t i = 0; i < sorted.size(); ++i) {
+        auto const &pixels = sorted[i]->pixels;
+        auto       &e      = entries[i];
+#if defined(GFX_HAVE_LZ4)
+        if(compress && !pixels.empty()) {
+            auto &blob = blobs[i];
+            blob.resize(static_cast<size_t>(
+                LZ4_compressBound(static_cast<int>(pixels.size()))));
+            auto n = LZ4_compress_default(
+                reinterpret_cast<char const *>(pixels.data()),
+                reinterpret_cast<char *>(blob.data()),
+                static_cast<int>(pixels.size()),
+                static_cast<int>(blob.size()));
+            if(n > 0 && static_cast<size_t>(n) < pixels.size()) {
+                blob.resize(static_cast<size_t>(n));
+                e.method = compression::lz4;
+            } else {
+                blob.clear();
+            }
+        }
+#endif
+        e.offset      = offset;
+        e.stored_size = e.method == compression::none ? pixels.size()
+                                                      : blobs[i].size();
+        offset        = align_up(offset + e.stored_size);
+    }
+
+    std::ofstream out{path, std::ios::binary};
+    if(!out) {
+        throw std::runtime_error{
+            fmt::format("couldn't write archive: {}", path)};
+    }
+    auto write = [&out](void const *data, size_t size) {
+        out.write(static_cast<char const *>(data),
+                  static_cast<std::streamsize>(size));
+    };
+    auto pad = [&out, &write](uint64_t to) {
+        constexpr std::array<char, blob_alignment> zeros{};
+        auto at = static_cast<uint64_t>(out.tellp());
+        write(zeros.data(), to - at);
+    };
+    write(&h, sizeof h);
+    write(entries.data(), entries.size() * sizeof(stored_entry));
+    write(names.data(), names.size());
+    for(size_t i = 0; i < sorted.size(); ++i) {
+        pad(entries[i].offset);
+        auto const &blob = entries[i].method == compression::none
+                               ? sorted[i]->pixels
+                               : blobs[i];
+        write(blob.data(), blob.size());
+    }
+    if(!out.flush()) {
+        throw std::runtime_error{
+            fmt::format("couldn't write archive: {}", path)};
+    }
+}
+
+auto archive_writer::can_compress() -> bool {
+#if defined(GFX_HAVE_LZ4)
+    return true;
+#else
+    return false;
+#endif
+}
+
+} // namespace gfx
@@ -0,0 +1,114 @@
+#include "gfx/gfx.h"
+
+namespace gfx {
+
+auto asset_loader::load_surface(std::string file_name)
+    -> std::shared_future<std::shared_ptr<surface>> {
+    auto promise = std::make_shared<std::promise<std::shared_ptr<surface>>>();
+    auto future  = promise->get_future().share();
+    ++m_total;
+    ++m_decoding;
+    m_pool.submit([this, promise, file_name = std::move(file_name)] {
+        try {
+            promise->set_value(create_surface_from_file(file_name));
+            ++m_completed;
+        } catch(...) {
+            promise->set_exception(std::current_exception());
+            ++m_failed;
+        }
+        --m_decoding;
+    });
+    return future;
+}
+
+auto asset_loader::load_texture(std::string file_name)
+    -> std::shared_future<std::shared_ptr<texture>> {
+    auto promise = std::make_shared<std::promise<std::shared_ptr<texture>>>();
+    auto future  = promise->get_future().share();
+    ++m_total;
+    ++m_decoding;
+    m_pool.submit([this, promise, file_name = std::move(file_name)] {
+        try {
+            // Converting here leaves the render thread a plain copy.
+            auto decoded = create_surface_from_file(file_name);
+            auto rgba    = std::make_shared<surface>(SDL_ConvertSurfaceFormat(
+                decoded->get_sdl_surface(), SDL_PIXELFORMAT_RGBA32, 0));
+            if(rgba->get_sdl_surface() == nullptr) {
+                throw std::runtime_error{fmt::format(
+                    "couldn't convert {}: {}", file_name, SDL_GetError())};
+            }
+            std::scoped_lock lock{m_upload_mutex};
+            m_uploads.push_back({std::move(rgba), promise});
+        } catch(...) {
+            promise->set_exception(std::current_exception());
+            ++m_failed;
+        }
+        --m_decoding;
+    });
+    return future;
+}
+
+auto asset_loader::load_font(std::string file_name, int size)
+    -> std::shared_future<std::shared_ptr<font>> {
+    auto promise = std::make_shared<std::promise<std::shared_ptr<font>>>();
+    auto future  = promise->get_future().share();
+    ++m_total;
+    ++m_decoding;
+    m_pool.submit([this, promise, file_name = std::move(file_name), size] {
+        try {
+            promise->set_value(open_font(file_name, size));
+            ++m_completed;
+        } catch(...) {
+            promise->set_exception(std::current_exception());
+            ++m_failed;
+        }
+        --m_decoding;
+    });
+    return future;
+}
+
+auto asset_loader::upload_pending(renderer &r, std::chrono::microseconds budget)
+    -> size_t {
+    auto   start    = std::chrono::steady_clock::now();
+    size_t uploaded = 0;
+    for(;;) {
+        upload next;
+        {
+            std::scoped_lock lock{m_upload_mutex};
+            if(m_uploads.empty()) {
+                break;
+            }
+            next = std::move(m_uploads.front());
+            m_uploads.pop_front();
+        }
+        try {
+            next.promise->set_value(
+                std::make_shared<texture>(r.get_sdl_renderer(), *next.pixels));
+            ++m_completed;
+        } catch(...) {
+            next.promise->set_exception(std::current_exception());
+            ++m_failed;
+        }
+        ++uploaded;
+        if(std::chrono::steady_clock::now() - start >= budget) {
+            break;
+        }
+    }
+    return uploaded;
+}
+
+auto asset_loader::get_stats() -> loader_stats {
+    size_t awaiting{};
+    {
+        std::scoped_lock lock{m_upload_mutex};
+        awaiting = m_uploads.size();
+    }
+    return {m_total, m_decoding, awaiting, m_completed, m_failed};
+}
+
+auto asset_loader::idle() -> bool {
+    auto stats = get_stats();
+    return stats.completed + stats.failed == stats.total;
+}
+
+} // namespace gfx
@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+#include "gfx/gfx.h"
+
+namespace gfx {
+
+namespace {
+
+constexpr std::string_view layout_magic   = "gfx-atlas";
+constexpr int              layout_version = 1;
+
+} // namespace
+
+skyline_packer::skyline_packer(int width, int height)
+    : m_width{width}, m_height{height} {
+    reset();
+}
+
+void skyline_packer::reset() {
+    m_skyline.clear();
+    m_skyline.push_back({0, 0, m_width});
+}
+
+auto skyline_packer::insert(int width, int height) -> std::optional<SDL_Point> {
+    size_t best       = m_skyline.size();
+    int    best_top   = std::numeric_limits<int>::max();
+    int    best_width = std::numeric_limits<int>::max();
+    int    best_y     = 0;
+
+    for(size_t i = 0; i < m_skyline.size(); ++i) {
+        int x = m_skyline[i].x;
+        if(x + width > m_width) {
+            break;
+        }
+        int y         = 0;
+        int remaining = width;
+        for(size_t j = i; remaining > 0; ++j) {
+            y         = std::max(y, m_skyline[j].y);
+            remaining -= m_skyline[j].width;
+        }
+        if(y + height > m_height) {
+            continue;
+        }
+        if(y + height < best_top ||
+           (y + height == best_top && m_skyline[i].width < best_width)) {
+            best       = i;
+            best_top   = y + height;
+            best_width = m_skyline[i].width;
+            best_y     = y;
+        }
+    }
+    if(best == m_skyline.size()) {
+        return std::nullopt;
+    }
+
+    SDL_Point position{m_skyline[best].x, best_y};
+    m_skyline.insert(m_skyline.begin() + static_cast<std::ptrdiff_t>(best),
+                     {position.x, best_y + height, width});
+
+    // Cut away whatever the new segment now covers.
+    for(size_t i = best + 1; i < m_skyline.size();) {
+        auto &prev   = m_skyline[i - 1];
+        auto &seg    = m_skyline[i];
+        int   shrink = prev.x + prev.width - seg.x;
+        if(shrink <= 0) {
+            break;
+        }
+        seg.x     += shrink;
+        seg.width -= shrink;
+        if(seg.width <= 0) {
+            m_skyline.erase(m_skyline.begin() + static_cast<std::ptrdiff_t>(i));
+        } else {
+            break;
+        }
+    }
+    for(size_t i = 1; i < m_skyline.size();) {
+        if(m_skyline[i - 1].y == m_skyline[i].y) {
+            m_skyline[i - 1].width += m_skyline[i].width;
+            m_skyline.erase(m_skyline.begin() + static_cast<std::ptrdiff_t>(i));
+        } else {
+            ++i;
+        }
+    }
+    return position;
+}
+
+void atlas_layout::save(std::string const &file_name) const {
+    std::ofstream out{file_name};
+    if(!out) {
+        throw std::runtime_error{
+            fmt::format("couldn't write atlas layout: {}", file_name)};
+    }
+    out << layout_magic << ' ' << layout_version << '\n'
+        << page_size << ' ' << page_count << '\n';
+    for(auto const &e : entries) {
+        out << e.page << ' ' << e.bounds.x << ' ' << e.bounds.y << ' '
+            << e.bounds.w << ' ' << e.bounds.h << ' ' << e.name << '\n';
+    }
+}
+
+auto atlas_layout::load(std::string const &file_name) -> atlas_layout {
+    std::ifstream in{file_name};
+    std::string   magic;
+    int           version{};
+    atlas_layout  layout;
+    if(!(in >> magic >> version >> layout.page_size >> layout.page_count) ||
+       magic != layout_magic || version != layout_version) {
+        throw std::runtime_error{
+            fmt::format("couldn't read atlas layout: {}", file_name)};
+    }
+    atlas_entry e;
+    while(in >> e.page >> e.bounds.x >> e.bounds.y >> e.bounds.w >>
+          e.bounds.h) {
+        in >> std::ws;
+        std::getline(in, e.name);
+        layout.entries.push_back(e);
+    }
+    return layout;
+}
+
+auto texture_atlas::region(std::string const &name) const -> texture_region {
+    auto it = m_regions.find(name);
+    if(it == m_regions.end()) {
+        throw std::runtime_error{
+            fmt::format("no such region in atlas: {}", name)};
+    }
+    return it->second;
+}
+
+void atlas_builder::add_file(std::string const &file_name) {
+    add(file_name, create_surface_from_file(file_name));
+}
+
+auto atlas_builder::pack() const -> atlas_layout {
+    // Tallest first packs noticeably tighter on a skyline.
+    std::vector<size_t> order(m_images.size());
+    std::iota(order.begin(), order.end(), size_t{0});
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        auto *sa = m_images[a].pixels->get_sdl_surface();
+        auto *sb = m_images[b].pixels->get_sdl_surface();
+        return sa->h != sb->h ? sa->h > sb->h : sa->w > sb->w;
+    });
+
+    atlas_layout                layout{m_page_size, 0, {}};
+    std::vector<skyline_packer> pages;
+    for(auto index : order) {
+        auto const &img = m_images[index];
+        auto       *sdl = img.pixels->get_sdl_surface();
+        int         w   = sdl->w + m_padding;
+        int         h   = sdl->h + m_padding;
+        if(w > m_page_size || h > m_page_size) {
+            throw std::runtime_error{fmt::format(
+                "image doesn't fit in an atlas page: {}", img.name)};
+        }
+
+        std::optional<SDL_Point> position;
+        size_t                   page = 0;
+        for(; page < pages.size() && !position; ++page) {
+            position = pages[page].insert(w, h);
+        }
+        if(!position) {
+            pages.emplace_back(m_page_size, m_page_size);
+            position = pages.back().insert(w, h);
+            page     = pages.size();
+        }
+        layout.entries.push_back({img.name, static_cast<uint32_t>(page - 1),
+                                  {position->x, position->y, sdl->w, sdl->h}});
+    }
+    layout.page_count = static_cast<uint32_t>(pages.size());
+    return layout;
+}
+
+auto atlas_builder::build(renderer &r) const -> texture_atlas {
+    return build(r, pack());
+}
+
+auto atlas_builder::build(renderer &r, atlas_layout const &layout) const
+    -> texture_atlas {
+    std::unordered_map<std::string_view, surface const *> by_name;
+    for(auto const &img : m_images) {
+        by_name.emplace(img.name, img.pixels.get());
+    }
+
+    std::vector<surface> pages;
+    pages.reserve(layout.page_count);
+    for(uint32_t i = 0; i < layout.page_count; ++i) {
+        pages.emplace_back(layout.page_size, layout.page_size);
+    }
+    for(auto const &e : layout.entries) {
+        auto it = by_name.find(e.name);
+        if(it == by_name.end() || e.page >= pages.size()) {
+            throw std::runtime_error{
+                fmt::format("atlas layout doesn't match images: {}", e.name)};
+        }
+        auto *src = it->second->get_sdl_surface();
+        if(src->w != e.bounds.w || src->h != e.bounds.h) {
+            throw std::runtime_error{
+                fmt::format("atlas layout doesn't match images: {}", e.name)};
+        }
+        // Copy alpha as is instead of blending onto the empty page.
+        SDL_BlendMode blend{};
+        SDL_GetSurfaceBlendMode(src, &blend);
+        SDL_SetSurfaceBlendMode(src, SDL_BLENDMODE_NONE);
+        SDL_Rect dest = e.bounds;
+        SDL_BlitSurface(src, nullptr, pages[e.page].get_sdl_surface(), &dest);
+        SDL_SetSurfaceBlendMode(src, blend);
+    }
+
+    texture_atlas atlas;
+    atlas.m_pages.reserve(pages.size());
+    for(auto const &page : pages) {
+        atlas.m_pages.emplace_back(r.get_sdl_renderer(), page);
+        SDL_SetTextureBlendMode(atlas.m_pages.back().get_sdl_texture(),
+                                SDL_BLENDMODE_BLEND);
+    }
+    for(auto const &e : layout.entries) {
+        atlas.m_regions[e.name] = {&atlas.m_pages[e.page], e.bounds};
+    }
+    return atlas;
+}
+
+} // namespace gfx
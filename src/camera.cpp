@@ -0,0 +1,172 @@
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+#include "gfx/camera.h"
+
+namespace gfx {
+
+namespace {
+
+static_assert(sizeof(vec2d_t<double>) == 2 * sizeof(double));
+static_assert(sizeof(vec2d_t<float>) == 2 * sizeof(float));
+
+void check_sizes(size_t in, size_t out) {
+    if(out < in) {
+        throw std::runtime_error{"output span is smaller than input span"};
+    }
+}
+
+// x86 builds that don't target AVX still get the AVX loops on CPUs that
+// have it, through a function compiled for AVX and picked at run time.
+#if !defined(__AVX__) && (defined(__GNUC__) || defined(__clang__)) &&         \
+    (defined(__x86_64__) || defined(__i386__))
+#define GFX_CAMERA_AVX_DISPATCH 1
+#define GFX_CAMERA_AVX __attribute__((target("avx")))
+#elif defined(__AVX__)
+#define GFX_CAMERA_AVX
+#endif
+
+#if defined(GFX_CAMERA_AVX_DISPATCH)
+auto has_avx() -> bool {
+    static bool const avx = __builtin_cpu_supports("avx") != 0;
+    return avx;
+}
+#endif
+
+// The kernels compute out[i] = (in[i] - origin[i % 2]) * scale +
+// offset[i % 2] over n values, with the x values in the even and the y
+// values in the odd lanes. Subtracting first keeps the precision of nearby
+// positions far from the world origin, which in * scale - origin * scale
+// would cancel away. The AVX ones return how many values they did.
+#if defined(GFX_CAMERA_AVX)
+GFX_CAMERA_AVX auto kernel_avx(double const *in, double *out, size_t n,
+                               vec2d_t<double> origin, double scale,
+                               vec2d_t<double> offset) -> size_t {
+    size_t  i = 0;
+    __m256d s = _mm256_set1_pd(scale);
+    __m256d c = _mm256_setr_pd(origin.x, origin.y, origin.x, origin.y);
+    __m256d o = _mm256_setr_pd(offset.x, offset.y, offset.x, offset.y);
+    for(; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_sub_pd(_mm256_loadu_pd(in + i), c);
+        _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_mul_pd(v, s), o));
+    }
+    return i;
+}
+
+GFX_CAMERA_AVX auto kernel_avx(float const *in, float *out, size_t n,
+                               vec2d_t<float> origin, float scale,
+                               vec2d_t<float> offset) -> size_t {
+    size_t i = 0;
+    __m256 s = _mm256_set1_ps(scale);
+    __m256 c = _mm256_setr_ps(origin.x, origin.y, origin.x, origin.y, origin.x,
+                              origin.y, origin.x, origin.y);
+    __m256 o = _mm256_setr_ps(offset.x, offset.y, offset.x, offset.y, offset.x,
+                              offset.y, offset.x, offset.y);
+    for(; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_sub_ps(_mm256_loadu_ps(in + i), c);
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_mul_ps(v, s), o));
+    }
+    return i;
+}
+#endif
+
+template <typename T>
+auto kernel_avx_if_available(T const *in, T *out, size_t n, vec2d_t<T> origin,
+                             T scale, vec2d_t<T> offset) -> size_t {
+#if defined(GFX_CAMERA_AVX_DISPATCH)
+    if(!has_avx()) {
+        return 0;
+    }
+#endif
+#if defined(GFX_CAMERA_AVX)
+    return kernel_avx(in, out, n, origin, scale, offset);
+#else
+    return 0;
+#endif
+}
+
+template <typename T>
+void kernel_tail(T const *in, T *out, size_t i, size_t n, vec2d_t<T> origin,
+                 T scale, vec2d_t<T> offset) {
+    for(; i + 2 <= n; i += 2) {
+        out[i]     = (in[i] - origin.x) * scale + offset.x;
+        out[i + 1] = (in[i + 1] - origin.y) * scale + offset.y;
+    }
+    if(i < n) {
+        out[i] = (in[i] - origin.x) * scale + offset.x;
+    }
+}
+
+void kernel(double const *in, double *out, size_t n, vec2d_t<double> origin,
+            double scale, vec2d_t<double> offset) {
+    size_t i = kernel_avx_if_available(in, out, n, origin, scale, offset);
+#if defined(__SSE2__) || defined(_M_X64)
+    __m128d s = _mm_set1_pd(scale);
+    __m128d c = _mm_setr_pd(origin.x, origin.y);
+    __m128d o = _mm_setr_pd(offset.x, offset.y);
+    for(; i + 2 <= n; i += 2) {
+        __m128d v = _mm_sub_pd(_mm_loadu_pd(in + i), c);
+        _mm_storeu_pd(out + i, _mm_add_pd(_mm_mul_pd(v, s), o));
+    }
+#endif
+    kernel_tail(in, out, i, n, origin, scale, offset);
+}
+
+void kernel(float const *in, float *out, size_t n, vec2d_t<float> origin,
+            float scale, vec2d_t<float> offset) {
+    size_t i = kernel_avx_if_available(in, out, n, origin, scale, offset);
+#if defined(__SSE2__) || defined(_M_X64)
+    __m128 s = _mm_set1_ps(scale);
+    __m128 c = _mm_setr_ps(origin.x, origin.y, origin.x, origin.y);
+    __m128 o = _mm_setr_ps(offset.x, offset.y, offset.x, offset.y);
+    for(; i + 4 <= n; i += 4) {
+        __m128 v = _mm_sub_ps(_mm_loadu_ps(in + i), c);
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(v, s), o));
+    }
+#endif
+    kernel_tail(in, out, i, n, origin, scale, offset);
+}
+
+template <typename T>
+auto flat(std::span<vec2d_t<T> const> span) -> T const * {
+    return reinterpret_cast<T const *>(span.data()); // NOLINT
+}
+
+template <typename T> auto flat(std::span<vec2d_t<T>> span) -> T * {
+    return reinterpret_cast<T *>(span.data()); // NOLINT
+}
+
+} // namespace
+
+void scale_offset(std::span<vec2d_t<double> const> in,
+                  std::span<vec2d_t<double>> out, vec2d_t<double> origin,
+                  double scale, vec2d_t<double> offset) {
+    check_sizes(in.size(), out.size());
+    kernel(flat(in), flat(out), in.size() * 2, origin, scale, offset);
+}
+
+void scale_offset(std::span<vec2d_t<float> const> in,
+                  std::span<vec2d_t<float>> out, vec2d_t<float> origin,
+                  float scale, vec2d_t<float> offset) {
+    check_sizes(in.size(), out.size());
+    kernel(flat(in), flat(out), in.size() * 2, origin, scale, offset);
+}
+
+void scale_offset(std::span<double const> in, std::span<double> out,
+                  double origin, double scale, double offset) {
+    check_sizes(in.size(), out.size());
+    kernel(in.data(), out.data(), in.size(), {origin, origin}, scale,
+           {offset, offset});
+}
+
+void scale_offset(std::span<float const> in, std::span<float> out,
+                  float origin, float scale, float offset) {
+    check_sizes(in.size(), out.size());
+    kernel(in.data(), out.data(), in.size(), {origin, origin}, scale,
+           {offset, offset});
+}
+
+} // namespace gfx
@@ -0,0 +1,53 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+#include "gfx/circle.h"
+
+namespace gfx {
+
+auto circle_segments(double pixel_radius, double tolerance) -> size_t {
+    if(pixel_radius <= tolerance) {
+        return min_circle_segments;
+    }
+    // Maximum distance between a chord and its arc is r * (1 - cos(pi / n)).
+    double n = M_PI / std::acos(1 - tolerance / pixel_radius);
+    return std::clamp(static_cast<size_t>(std::ceil(n)), min_circle_segments,
+                      max_circle_segments);
+}
+
+namespace {
+
+void fill_unit_circle(std::vector<SDL_FPoint> &points, size_t segments) {
+    points.clear();
+    points.reserve(segments + 1);
+    for(size_t i = 0; i < segments; ++i) {
+        double angle =
+            static_cast<double>(i) * 2 * M_PI / static_cast<double>(segments);
+        points.push_back({static_cast<float>(std::cos(angle)),
+                          static_cast<float>(std::sin(angle))});
+    }
+    points.push_back(points.front());
+}
+
+} // namespace
+
+auto unit_circle(size_t segments) -> std::span<SDL_FPoint const> {
+    static std::array<std::vector<SDL_FPoint>, max_circle_segments + 1> tables;
+    static std::array<std::once_flag, max_circle_segments + 1>          once;
+
+    segments = std::max<size_t>(segments, 1);
+    if(segments > max_circle_segments) {
+        thread_local std::vector<SDL_FPoint> points;
+        fill_unit_circle(points, segments);
+        return points;
+    }
+    std::call_once(once[segments], [segments] {
+        fill_unit_circle(tables[segments], segments);
+    });
+    return tables[segments];
+}
+
+} // namespace gfx
@@ -0,0 +1,286 @@
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <tuple>
+
+#include <fmt/core.h>
+
+#include "gfx/command_buffer.h"
+#include "gfx/profiler.h"
+
+namespace gfx {
+
+namespace {
+
+void check(int result, char const *what) {
+    if(result < 0) {
+        throw std::runtime_error{
+            fmt::format("couldn't {}: {}", what, SDL_GetError())};
+    }
+}
+
+auto same_point(SDL_FPoint const &a, SDL_FPoint const &b) -> bool {
+    return std::memcmp(&a, &b, sizeof(SDL_FPoint)) == 0;
+}
+
+template <typename T> auto to_u32(T n) -> uint32_t {
+    return static_cast<uint32_t>(n);
+}
+
+} // namespace
+
+void command_buffer::push(command_kind kind, SDL_Texture *texture,
+                          uint32_t first, uint32_t count, uint32_t first_index,
+                          uint32_t index_count) {
+    m_commands.push_back({m_target, texture, m_blend,
+                          kind == command_kind::geometry ? color{} : m_color,
+                          kind, first, count, first_index, index_count});
+    ++m_stats.recorded_calls;
+}
+
+void command_buffer::record_point(SDL_FPoint point) {
+    auto first = to_u32(m_points.size());
+    m_points.push_back(point);
+    push(command_kind::point, nullptr, first, 1);
+}
+
+void command_buffer::record_line(SDL_FPoint from, SDL_FPoint to) {
+    auto first = to_u32(m_points.size());
+    m_points.push_back(from);
+    m_points.push_back(to);
+    push(command_kind::strip, nullptr, first, 2);
+}
+
+void command_buffer::record_lines(std::span<SDL_FPoint const> points) {
+    if(points.size() < 2) {
+        return;
+    }
+    auto first = to_u32(m_points.size());
+    m_points.insert(m_points.end(), points.begin(), points.end());
+    push(command_kind::strip, nullptr, first, to_u32(points.size()));
+}
+
+void command_buffer::record_geometry(SDL_Texture                 *texture,
+                                     std::span<SDL_Vertex const> vertices,
+                                     std::span<int const>        indices) {
+    if(vertices.empty()) {
+        return;
+    }
+    auto first       = to_u32(m_vertices.size());
+    auto first_index = to_u32(m_indices.size());
+    m_vertices.insert(m_vertices.end(), vertices.begin(), vertices.end());
+    if(indices.empty()) {
+        for(size_t i = 0; i < vertices.size(); ++i) {
+            m_indices.push_back(static_cast<int>(i));
+        }
+    } else {
+        m_indices.insert(m_indices.end(), indices.begin(), indices.end());
+    }
+    push(command_kind::geometry, texture, first, to_u32(vertices.size()),
+         first_index, to_u32(m_indices.size()) - first_index);
+}
+
+void command_buffer::append(command_buffer const &other) {
+    auto points   = to_u32(m_points.size());
+    auto vertices = to_u32(m_vertices.size());
+    auto indices  = to_u32(m_indices.size());
+    m_points.insert(m_points.end(), other.m_points.begin(),
+                    other.m_points.end());
+    m_vertices.insert(m_vertices.end(), other.m_vertices.begin(),
+                      other.m_vertices.end());
+    m_indices.insert(m_indices.end(), other.m_indices.begin(),
+                     other.m_indices.end());
+    for(auto cmd : other.m_commands) {
+        if(cmd.kind == command_kind::geometry) {
+            cmd.first       += vertices;
+            cmd.first_index += indices;
+        } else {
+            cmd.first += points;
+        }
+        m_commands.push_back(cmd);
+    }
+    m_stats.recorded_calls += other.m_stats.recorded_calls;
+}
+
+// A one pixel wide quad covering the pixels a line from a to b covers, like
+// SDL_HINT_RENDER_LINE_METHOD "3" draws lines. Only the ends of a polyline
+// reach half a pixel past their points: quads meeting at a joint just touch,
+// so translucent polylines aren't blended twice there.
+void command_buffer::append_line_quad(SDL_FPoint a, SDL_FPoint b, SDL_Color c,
+                                      bool cap_start, bool cap_end) {
+    auto dx  = b.x - a.x;
+    auto dy  = b.y - a.y;
+    auto len = std::sqrt(dx * dx + dy * dy);
+    // Along the line and across it, each half a pixel long.
+    SDL_FPoint u{0.5F, 0};
+    if(len > 1e-6F) {
+        u = {dx / len * 0.5F, dy / len * 0.5F};
+    }
+    SDL_FPoint n{-u.y, u.x};
+    auto       start = cap_start ? 1.0F : 0.0F;
+    auto       end   = cap_end ? 1.0F : 0.0F;
+    // Pixel centers are at +0.5.
+    SDL_FPoint from{a.x + 0.5F - u.x * start, a.y + 0.5F - u.y * start};
+    SDL_FPoint to{b.x + 0.5F + u.x * end, b.y + 0.5F + u.y * end};
+
+    auto base = static_cast<int>(m_vertex_scratch.size());
+    m_vertex_scratch.push_back({{from.x + n.x, from.y + n.y}, c, {}});
+    m_vertex_scratch.push_back({{from.x - n.x, from.y - n.y}, c, {}});
+    m_vertex_scratch.push_back({{to.x + n.x, to.y + n.y}, c, {}});
+    m_vertex_scratch.push_back({{to.x - n.x, to.y - n.y}, c, {}});
+    for(int i : {0, 1, 2, 2, 1, 3}) {
+        m_index_scratch.push_back(base + i);
+    }
+}
+
+void command_buffer::submit(SDL_Renderer *renderer) {
+    render_state state{renderer};
+    submit(state);
+}
+
+void command_buffer::submit(render_state &state) {
+    if(m_commands.empty() && m_synced) {
+        return;
+    }
+    ++m_stats.flushes;
+    GFX_PROFILE_SCOPE("submit");
+    auto *renderer = state.get_sdl_renderer();
+
+    // Only runs of consecutive commands in the same state are merged, so
+    // overlapping draws, and textures rendered before they are sampled, keep
+    // the order they were recorded in.
+    auto key = [this](size_t i) {
+        auto const &cmd = m_commands[i];
+        return std::make_tuple(cmd.target, cmd.blend, cmd.kind, cmd.texture,
+                               cmd.draw_color.packed());
+    };
+
+    auto apply = [&](SDL_Texture *t, SDL_BlendMode b, color const *c) {
+        if(state.set_target(t)) {
+            ++m_stats.submitted_calls;
+        }
+        if(state.set_blend_mode(b)) {
+            ++m_stats.submitted_calls;
+        }
+        if(c != nullptr && state.set_color(*c)) {
+            ++m_stats.submitted_calls;
+        }
+    };
+
+    for(size_t begin = 0; begin < m_commands.size();) {
+        auto   group_key = key(begin);
+        size_t end       = begin + 1;
+        while(end < m_commands.size() && key(end) == group_key) {
+            ++end;
+        }
+
+        auto const &head = m_commands[begin];
+        apply(head.target, head.blend,
+              head.kind == command_kind::geometry ? nullptr : &head.draw_color);
+
+        switch(head.kind) {
+        case command_kind::point:
+            m_point_scratch.clear();
+            for(size_t i = begin; i < end; ++i) {
+                m_point_scratch.push_back(m_points[m_commands[i].first]);
+            }
+            check(SDL_RenderDrawPointsF(
+                      renderer, m_point_scratch.data(),
+                      static_cast<int>(m_point_scratch.size())),
+                  "draw points");
+            ++m_stats.submitted_calls;
+            GFX_PROFILE_COUNT(draw_calls, 1);
+            GFX_PROFILE_COUNT(primitives, m_point_scratch.size());
+            break;
+        case command_kind::strip: {
+            // Segments that continue where the previous one ended are joined
+            // into a single polyline, and every polyline becomes quads, all
+            // in one geometry call.
+            m_point_scratch.clear();
+            m_strip_ends.clear();
+            for(size_t i = begin; i < end; ++i) {
+                auto const &cmd = m_commands[i];
+                auto points = std::span{m_points}.subspan(cmd.first, cmd.count);
+                if(!m_point_scratch.empty() &&
+                   same_point(m_point_scratch.back(), points.front())) {
+                    points = points.subspan(1);
+                } else if(!m_point_scratch.empty()) {
+                    m_strip_ends.push_back(to_u32(m_point_scratch.size()));
+                }
+                m_point_scratch.insert(m_point_scratch.end(), points.begin(),
+                                       points.end());
+            }
+            m_strip_ends.push_back(to_u32(m_point_scratch.size()));
+
+            m_vertex_scratch.clear();
+            m_index_scratch.clear();
+            auto     c     = head.draw_color.get_sdl_color();
+            uint32_t first = 0;
+            for(auto last : m_strip_ends) {
+                for(auto j = first; j + 1 < last; ++j) {
+                    append_line_quad(m_point_scratch[j], m_point_scratch[j + 1],
+                                     c, j == first, j + 2 == last);
+                }
+                first = last;
+            }
+            check(SDL_RenderGeometry(renderer, nullptr,
+                                     m_vertex_scratch.data(),
+                                     static_cast<int>(m_vertex_scratch.size()),
+                                     m_index_scratch.data(),
+                                     static_cast<int>(m_index_scratch.size())),
+                  "render geometry");
+            ++m_stats.submitted_calls;
+            GFX_PROFILE_COUNT(draw_calls, 1);
+            GFX_PROFILE_COUNT(primitives, m_index_scratch.size() / 6);
+            break;
+        }
+        case command_kind::geometry:
+            m_vertex_scratch.clear();
+            m_index_scratch.clear();
+            for(size_t i = begin; i < end; ++i) {
+                auto const &cmd  = m_commands[i];
+                auto        base = static_cast<int>(m_vertex_scratch.size());
+                m_vertex_scratch.insert(
+                    m_vertex_scratch.end(),
+                    m_vertices.begin() + cmd.first,
+                    m_vertices.begin() + cmd.first + cmd.count);
+                for(uint32_t j = 0; j < cmd.index_count; ++j) {
+                    m_index_scratch.push_back(base +
+                                              m_indices[cmd.first_index + j]);
+                }
+            }
+            check(SDL_RenderGeometry(
+                      renderer, head.texture, m_vertex_scratch.data(),
+                      static_cast<int>(m_vertex_scratch.size()),
+                      m_index_scratch.data(),
+                      static_cast<int>(m_index_scratch.size())),
+                  "render geometry");
+            ++m_stats.submitted_calls;
+            GFX_PROFILE_COUNT(draw_calls, 1);
+            GFX_PROFILE_COUNT(primitives, m_index_scratch.size() / 3);
+            break;
+        }
+        begin = end;
+    }
+
+    apply(m_target, m_blend, &m_color);
+    m_synced = true;
+    clear();
+}
+
+void command_buffer::reset() {
+    clear();
+    m_target = nullptr;
+    m_blend  = SDL_BLENDMODE_BLEND;
+    m_color  = {};
+    m_synced = false;
+}
+
+void command_buffer::clear() {
+    m_commands.clear();
+    m_points.clear();
+    m_vertices.clear();
+    m_indices.clear();
+}
+
+} // namespace gfx
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <array>
+
+#include "gfx/gfx.h"
+
+namespace gfx {
+
+namespace {
+
+auto touches(rect_t<int> const &a, rect_t<int> const &b) -> bool {
+    return a.position.x <= b.position.x + b.size.x &&
+           b.position.x <= a.position.x + a.size.x &&
+           a.position.y <= b.position.y + b.size.y &&
+           b.position.y <= a.position.y + a.size.y;
+}
+
+auto bounding(rect_t<int> const &a, rect_t<int> const &b) -> rect_t<int> {
+    auto         a_end = a.position + a.size;
+    auto         b_end = b.position + b.size;
+    vec2d_t<int> first{std::min(a.position.x, b.position.x),
+                       std::min(a.position.y, b.position.y)};
+    vec2d_t<int> last{std::max(a_end.x, b_end.x), std::max(a_end.y, b_end.y)};
+    return {first, last - first};
+}
+
+auto intersection(rect_t<int> const &a, rect_t<int> const &b) -> rect_t<int> {
+    auto         a_end = a.position + a.size;
+    auto         b_end = b.position + b.size;
+    vec2d_t<int> first{std::max(a.position.x, b.position.x),
+                       std::max(a.position.y, b.position.y)};
+    vec2d_t<int> last{std::min(a_end.x, b_end.x), std::min(a_end.y, b_end.y)};
+    return {first, last - first};
+}
+
+auto to_sdl(rect_t<int> const &r) -> SDL_Rect {
+    return {r.position.x, r.position.y, r.size.x, r.size.y};
+}
+
+// Draws the part of source under region at the same place.
+void copy_region(renderer &r, texture const &source,
+                 rect_t<int> const &region) {
+    auto w  = static_cast<float>(source.width());
+    auto h  = static_cast<float>(source.height());
+    auto x0 = static_cast<float>(region.position.x);
+    auto y0 = static_cast<float>(region.position.y);
+    auto x1 = static_cast<float>(region.position.x + region.size.x);
+    auto y1 = static_cast<float>(region.position.y + region.size.y);
+    auto c  = color_white.get_sdl_color();
+    std::array<SDL_Vertex, 4> quad{{{{x0, y0}, c, {x0 / w, y0 / h}},
+                                    {{x1, y0}, c, {x1 / w, y0 / h}},
+                                    {{x0, y1}, c, {x0 / w, y1 / h}},
+                                    {{x1, y1}, c, {x1 / w, y1 / h}}}};
+    constexpr std::array<int, 6> indices{0, 1, 2, 2, 1, 3};
+    r.draw_geometry(quad, indices, source.get_sdl_texture());
+}
+
+} // namespace
+
+void damage_region::add(rect_t<int> r) {
+    r = intersection(r, m_bounds);
+    if(r.size.x <= 0 || r.size.y <= 0) {
+        return;
+    }
+    // Growing r can make it reach rects already passed, so start over
+    // after every merge.
+    for(auto it = m_rects.begin(); it != m_rects.end();) {
+        if(touches(*it, r)) {
+            r = bounding(*it, r);
+            m_rects.erase(it);
+            it = m_rects.begin();
+        } else {
+            ++it;
+        }
+    }
+    m_rects.push_back(r);
+    if(m_rects.size() > m_max_rects) {
+        auto all = m_rects.front();
+        for(auto const &other : m_rects) {
+            all = bounding(all, other);
+        }
+        m_rects.assign(1, all);
+    }
+}
+
+auto damage_region::area() const -> int64_t {
+    int64_t total = 0;
+    for(auto const &r : m_rects) {
+        total += static_cast<int64_t>(r.size.x) * r.size.y;
+    }
+    return total;
+}
+
+auto compositor::add_layer(layer::draw_function draw) -> layer & {
+    m_layers.push_back(std::make_unique<layer>(m_size, std::move(draw)));
+    return *m_layers.back();
+}
+
+void compositor::invalidate() {
+    for(auto &l : m_layers) {
+        l->invalidate();
+    }
+    m_damage.add_all();
+}
+
+auto compositor::make_texture(renderer &r) -> texture {
+    texture t{r.get_sdl_renderer(), m_size.x, m_size.y};
+    m_premultiplied = t.set_blend_mode(premultiplied_blend_mode());
+    return t;
+}
+
+// SDL_RenderClear ignores the clip rect, so regions are cleared by
+// overwriting them with transparent pixels.
+void compositor::clear_region(renderer &r, rect_t<int> const &region) {
+    r.set_clip_rect(to_sdl(region));
+    r.set_blend_mode(SDL_BLENDMODE_NONE);
+    r.set_draw_color(color_clear);
+    r.fill_rect(region);
+    r.set_blend_mode(SDL_BLENDMODE_BLEND);
+}
+
+void compositor::redraw(renderer &r, layer &l) {
+    if(l.m_pixels.get_sdl_texture() == nullptr) {
+        l.m_pixels = make_texture(r);
+        l.m_damage.add_all();
+    }
+    if(l.m_visibility_changed) {
+        l.m_visibility_changed = false;
+        m_damage.add_all();
+    }
+    // Hidden layers keep their damage until they are shown again.
+    if(!l.m_visible || l.m_damage.empty()) {
+        return;
+    }
+
+    r.set_target(l.m_pixels);
+    for(auto const &region : l.m_damage.rects()) {
+        clear_region(r, region);
+        l.m_draw(r, region);
+        m_damage.add(region);
+        ++m_stats.regions_redrawn;
+        m_stats.pixels_redrawn +=
+            static_cast<int64_t>(region.size.x) * region.size.y;
+    }
+    l.m_damage.clear();
+    ++m_stats.layers_redrawn;
+}
+
+void compositor::composite(renderer &r, rect_t<int> const &region) {
+    clear_region(r, region);
+    for(auto const &l : m_layers) {
+        if(l->m_visible && l->m_pixels.get_sdl_texture() != nullptr) {
+            copy_region(r, l->m_pixels, region);
+        }
+    }
+    ++m_stats.regions_composited;
+}
+
+void compositor::compose(renderer &r) {
+    GFX_PROFILE_SCOPE("compose");
+    m_stats = {};
+
+    auto *previous_target = r.get_target();
+    auto  previous_clip   = r.get_clip_rect();
+    auto  previous_blend  = r.get_blend_mode();
+    auto  previous_color  = r.get_draw_color();
+
+    for(auto &l : m_layers) {
+        redraw(r, *l);
+    }
+
+    if(m_output.get_sdl_texture() == nullptr) {
+        m_output = make_texture(r);
+        m_damage.add_all();
+    }
+    if(!m_damage.empty()) {
+        r.set_target(m_output);
+        for(auto const &region : m_damage.rects()) {
+            composite(r, region);
+        }
+        m_damage.clear();
+    }
+
+    r.set_target(previous_target);
+    r.set_clip_rect(previous_clip);
+    r.set_blend_mode(previous_blend);
+    r.set_draw_color(previous_color);
+    copy_region(r, m_output, {{0, 0}, m_size});
+}
+
+} // namespace gfx
@@ -23,9 +23,14 @@ auto gfx::get_mouse_state(double &x, double &y) -> uint32_t {
     return std::make_shared<window>(title, width, height, vsync, flags);
 }
 
+[[nodiscard]] auto gfx::create_headless(int width, int height)
+    -> std::shared_ptr<headless> {
+    return std::make_shared<headless>(width, height);
+}
+
 [[nodiscard]] auto gfx::create_surface_from_file(std::string const &file_name)
     -> std::shared_ptr<surface> {
-    return std::make_shared<surface>(file_name);
+    return resource_registry::shared().load_surface(file_name);
 }
 
 [[nodiscard]] auto gfx::create_texture(renderer &r, int w, int h)
@@ -35,7 +40,7 @@ auto gfx::get_mouse_state(double &x, double &y) -> uint32_t {
 
 [[nodiscard]] auto gfx::open_font(std::string const &file_name, int size)
     -> std::shared_ptr<font> {
-    return std::make_shared<font>(file_name, size);
+    return resource_registry::shared().get_font(file_name, size);
 }
 
 [[nodiscard]] auto gfx::modifier_key_pressed(uint32_t key) -> bool {
@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "gfx/gfx.h"
+
+namespace gfx {
+
+namespace {
+
+constexpr uint32_t replacement_character = 0xFFFD;
+constexpr int      glyph_padding         = 1;
+
+} // namespace
+
+auto decode_utf8(std::string_view text, size_t &pos) -> uint32_t {
+    auto lead = static_cast<uint8_t>(text[pos++]);
+    if(lead < 0x80U) {
+        return lead;
+    }
+    size_t   extra{};
+    uint32_t cp{};
+    if((lead & 0xE0U) == 0xC0U) {
+        extra = 1;
+        cp    = lead & 0x1FU;
+    } else if((lead & 0xF0U) == 0xE0U) {
+        extra = 2;
+        cp    = lead & 0x0FU;
+    } else if((lead & 0xF8U) == 0xF0U) {
+        extra = 3;
+        cp    = lead & 0x07U;
+    } else {
+        return replacement_character;
+    }
+    for(size_t i = 0; i < extra; ++i) {
+        if(pos >= text.size()) {
+            return replacement_character;
+        }
+        auto next = static_cast<uint8_t>(text[pos]);
+        if((next & 0xC0U) != 0x80U) {
+            return replacement_character;
+        }
+        cp = (cp << 6U) | (next & 0x3FU);
+        ++pos;
+    }
+    return cp;
+}
+
+glyph_atlas::glyph_atlas(SDL_Renderer *renderer, TTF_Font *font,
+                         int page_size)
+    : m_sdl_renderer{renderer}, m_font{font}, m_page_size{page_size},
+      m_line_skip{TTF_FontLineSkip(font)} {
+    m_ascii.fill(no_glyph);
+}
+
+// Static textures start out undefined, and linear filtering samples the
+// padding between glyphs.
+void glyph_atlas::clear_page(texture const &page) const {
+    std::vector<uint32_t> blank(static_cast<size_t>(m_page_size) *
+                                static_cast<size_t>(m_page_size));
+    if(SDL_UpdateTexture(page.get_sdl_texture(), nullptr, blank.data(),
+                         m_page_size * bytes_per_pixel) < 0) {
+        throw std::runtime_error{
+            fmt::format("couldn't clear atlas page: {}", SDL_GetError())};
+    }
+}
+
+auto glyph_atlas::index_of(uint32_t codepoint) -> int32_t {
+    if(codepoint < ascii_count) {
+        auto &slot = m_ascii[codepoint];
+        if(slot == no_glyph) {
+            slot = rasterize(codepoint);
+        }
+        return slot;
+    }
+    if(auto it = m_other.find(codepoint); it != m_other.end()) {
+        return it->second;
+    }
+    auto index = rasterize(codepoint);
+    m_other.emplace(codepoint, index);
+    return index;
+}
+
+auto glyph_atlas::rasterize(uint32_t codepoint) -> int32_t {
+    int minx{};
+    int maxx{};
+    int miny{};
+    int maxy{};
+    int advance{};
+    if(TTF_GlyphMetrics32(m_font, codepoint, &minx, &maxx, &miny, &maxy,
+                          &advance) < 0) {
+        throw std::runtime_error{
+            fmt::format("couldn't get glyph metrics: {}", TTF_GetError())};
+    }
+
+    glyph g{0, {}, glyph_surface_offset(minx), advance};
+    if(maxx > minx) {
+        surface rendered{TTF_RenderGlyph32_Blended(m_font, codepoint,
+                                                   color_white.get_sdl_color())};
+        if(rendered.get_sdl_surface() == nullptr) {
+            throw std::runtime_error{
+                fmt::format("couldn't render glyph: {}", TTF_GetError())};
+        }
+        GFX_PROFILE_COUNT(text_rasterizations, 1);
+        surface rgba{SDL_ConvertSurfaceFormat(rendered.get_sdl_surface(),
+                                              SDL_PIXELFORMAT_RGBA32, 0)};
+        auto   *pixels = rgba.get_sdl_surface();
+        if(pixels == nullptr) {
+            throw std::runtime_error{
+                fmt::format("couldn't convert glyph: {}", SDL_GetError())};
+        }
+        if(pixels->w > m_page_size || pixels->h > m_page_size) {
+            throw std::runtime_error{"glyph doesn't fit in atlas page"};
+        }
+
+        if(m_cursor_x + pixels->w > m_page_size) {
+            m_cursor_x     = 0;
+            m_cursor_y     += m_shelf_height + glyph_padding;
+            m_shelf_height = 0;
+        }
+        if(m_pages.empty() || m_cursor_y + pixels->h > m_page_size) {
+            m_pages.emplace_back(m_sdl_renderer, m_page_size, m_page_size,
+                                 SDL_TEXTUREACCESS_STATIC);
+            clear_page(m_pages.back());
+            m_cursor_x     = 0;
+            m_cursor_y     = 0;
+            m_shelf_height = 0;
+        }
+
+        g.page   = static_cast<uint32_t>(m_pages.size() - 1);
+        g.source = {m_cursor_x, m_cursor_y, pixels->w, pixels->h};
+        if(SDL_UpdateTexture(m_pages.back().get_sdl_texture(), &g.source,
+                             pixels->pixels, pixels->pitch) < 0) {
+            throw std::runtime_error{
+                fmt::format("couldn't upload glyph: {}", SDL_GetError())};
+        }
+        GFX_PROFILE_COUNT(texture_uploads, 1);
+        GFX_PROFILE_COUNT(bytes_uploaded, pixels->w * bits_per_pixel / 8 *
+                                              pixels->h);
+        m_cursor_x     += pixels->w + glyph_padding;
+        m_shelf_height = std::max(m_shelf_height, pixels->h);
+    }
+
+    m_glyphs.push_back(g);
+    return static_cast<int32_t>(m_glyphs.size() - 1);
+}
+
+auto glyph_atlas::get_glyph(uint32_t codepoint) -> glyph const & {
+    return m_glyphs[static_cast<size_t>(index_of(codepoint))];
+}
+
+auto glyph_atlas::layout(std::string_view text, uint32_t wrap_width)
+    -> vec2d_t<int> {
+    m_codepoints.clear();
+    for(size_t pos = 0; pos < text.size();) {
+        m_codepoints.push_back(decode_utf8(text, pos));
+    }
+    m_placements.clear();
+
+    auto kerning = [this](uint32_t prev, uint32_t cp) {
+        return prev == 0 ? 0 : TTF_GetFontKerningSizeGlyphs32(m_font, prev, cp);
+    };
+    auto const limit = static_cast<int>(wrap_width);
+    auto const count = m_codepoints.size();
+    int        y     = 0;
+    int        width = 0;
+
+    for(size_t line_start = 0;;) {
+        size_t   line_end   = count;
+        size_t   next_start = count + 1;
+        size_t   last_space = line_start;
+        int      x          = 0;
+        uint32_t prev       = 0;
+        for(size_t i = line_start; i < count; ++i) {
+            auto cp = m_codepoints[i];
+            if(cp == '\n') {
+                line_end   = i;
+                next_start = i + 1;
+                break;
+            }
+            if(cp == ' ') {
+                last_space = i;
+            }
+            auto const &g    = m_glyphs[static_cast<size_t>(index_of(cp))];
+            int         next = x + kerning(prev, cp) + g.advance;
+            if(limit > 0 && next > limit && i > line_start) {
+                line_end   = last_space > line_start ? last_space : i;
+                next_start = last_space > line_start ? last_space + 1 : i;
+                break;
+            }
+            x    = next;
+            prev = cp;
+        }
+
+        x    = 0;
+        prev = 0;
+        for(size_t i = line_start; i < line_end; ++i) {
+            auto        cp    = m_codepoints[i];
+            auto        index = index_of(cp);
+            auto const &g     = m_glyphs[static_cast<size_t>(index)];
+            x                 += kerning(prev, cp);
+            if(g.source.w > 0) {
+                m_placements.push_back({index, x + g.offset_x, y});
+            }
+            x    += g.advance;
+            prev = cp;
+        }
+        width = std::max(width, x);
+        y     += m_line_skip;
+
+        if(next_start > count) {
+            break;
+        }
+        line_start = next_start;
+    }
+    return {width, y};
+}
+
+void glyph_atlas::build_text(std::string_view text, SDL_FPoint origin,
+                             color color, uint32_t wrap_width) {
+    layout(text, wrap_width);
+
+    m_meshes.resize(m_pages.size());
+    for(auto &mesh : m_meshes) {
+        mesh.vertices.clear();
+        mesh.indices.clear();
+    }
+
+    auto const sdl_color = color.get_sdl_color();
+    auto const scale     = 1.0F / static_cast<float>(m_page_size);
+    for(auto const &p : m_placements) {
+        auto const &g    = m_glyphs[static_cast<size_t>(p.index)];
+        auto       &mesh = m_meshes[g.page];
+        auto        base = static_cast<int>(mesh.vertices.size());
+
+        float x0 = origin.x + static_cast<float>(p.x);
+        float y0 = origin.y + static_cast<float>(p.y);
+        float x1 = x0 + static_cast<float>(g.source.w);
+        float y1 = y0 + static_cast<float>(g.source.h);
+        float u0 = static_cast<float>(g.source.x) * scale;
+        float v0 = static_cast<float>(g.source.y) * scale;
+        float u1 = static_cast<float>(g.source.x + g.source.w) * scale;
+        float v1 = static_cast<float>(g.source.y + g.source.h) * scale;
+
+        mesh.vertices.push_back({{x0, y0}, sdl_color, {u0, v0}});
+        mesh.vertices.push_back({{x1, y0}, sdl_color, {u1, v0}});
+        mesh.vertices.push_back({{x0, y1}, sdl_color, {u0, v1}});
+        mesh.vertices.push_back({{x1, y1}, sdl_color, {u1, v1}});
+        for(int i : {0, 1, 2, 2, 1, 3}) {
+            mesh.indices.push_back(base + i);
+        }
+    }
+}
+
+auto glyph_atlas::measure(std::string_view text, uint32_t wrap_width)
+    -> vec2d_t<int> {
+    return layout(text, wrap_width);
+}
+
+} // namespace gfx
@@ -0,0 +1,95 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "gfx/gfx.h"
+
+namespace gfx {
+
+namespace {
+
+auto packed_pitch(int width, int pitch) -> int {
+    return pitch == 0 ? width * bytes_per_pixel : pitch;
+}
+
+void check_buffer(std::span<std::byte const> buffer, int width, int height,
+                  int pitch) {
+    if(width <= 0 || height <= 0) {
+        return;
+    }
+    if(pitch < width * bytes_per_pixel ||
+       buffer.size() < static_cast<size_t>(pitch) *
+                               static_cast<size_t>(height - 1) +
+                           static_cast<size_t>(width * bytes_per_pixel)) {
+        throw std::runtime_error{
+            fmt::format("pixel buffer too small for {}x{} pixels with pitch {}",
+                        width, height, pitch)};
+    }
+}
+
+auto wrap(std::span<std::byte> pixels, int width, int height, int pitch)
+    -> SDL_Surface * {
+    pitch = packed_pitch(width, pitch);
+    check_buffer(pixels, width, height, pitch);
+    auto *s = SDL_CreateRGBSurfaceWithFormatFrom(pixels.data(), width, height,
+                                                 bits_per_pixel, pitch,
+                                                 SDL_PIXELFORMAT_RGBA32);
+    if(s == nullptr) {
+        throw std::runtime_error{
+            fmt::format("error creating surface: {}", SDL_GetError())};
+    }
+    return s;
+}
+
+} // namespace
+
+headless::headless(int width, int height)
+    : m_target{width, height}, m_renderer{m_target} {}
+
+headless::headless(std::span<std::byte> pixels, int width, int height,
+                   int pitch)
+    : m_target{wrap(pixels, width, height, pitch)}, m_renderer{m_target} {}
+
+auto headless::frame() -> locked_pixels {
+    m_renderer.flush();
+    if(SDL_RenderFlush(m_renderer.get_sdl_renderer()) < 0) {
+        throw std::runtime_error{
+            fmt::format("couldn't flush renderer: {}", SDL_GetError())};
+    }
+    auto *s = m_target.get_sdl_surface();
+    return {static_cast<std::byte *>(s->pixels), s->pitch, s->w, s->h};
+}
+
+void headless::read_frame(std::span<std::byte> out, int pitch) {
+    auto pixels = frame();
+    auto row    = static_cast<size_t>(pixels.width * bytes_per_pixel);
+    pitch       = packed_pitch(pixels.width, pitch);
+    check_buffer(out, pixels.width, pixels.height, pitch);
+    for(int y = 0; y < pixels.height; ++y) {
+        std::memcpy(out.data() + static_cast<ptrdiff_t>(y) * pitch,
+                    pixels.pixels + static_cast<ptrdiff_t>(y) * pixels.pitch,
+                    row);
+    }
+}
+
+void read_pixels(renderer &r, std::span<std::byte> out, int pitch,
+                 SDL_Rect const *area) {
+    r.flush();
+    SDL_Rect whole{};
+    if(area == nullptr) {
+        if(SDL_GetRendererOutputSize(r.get_sdl_renderer(), &whole.w,
+                                     &whole.h) < 0) {
+            throw std::runtime_error{
+                fmt::format("couldn't get output size: {}", SDL_GetError())};
+        }
+        area = &whole;
+    }
+    pitch = packed_pitch(area->w, pitch);
+    check_buffer(out, area->w, area->h, pitch);
+    if(SDL_RenderReadPixels(r.get_sdl_renderer(), area, SDL_PIXELFORMAT_RGBA32,
+                            out.data(), pitch) < 0) {
+        throw std::runtime_error{
+            fmt::format("couldn't read pixels: {}", SDL_GetError())};
+    }
+}
+
+} // namespace gfx
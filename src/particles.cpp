@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <array>
+
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+#include "gfx/gfx.h"
+
+namespace gfx {
+
+namespace {
+
+// v = (v + a_dt) * damping, then p += v * dt, over n particles.
+void integrate(float *p, float *v, size_t n, float a_dt, float damping,
+               float dt) {
+    size_t i = 0;
+#if defined(__AVX__)
+    __m256 a8 = _mm256_set1_ps(a_dt);
+    __m256 d8 = _mm256_set1_ps(damping);
+    __m256 t8 = _mm256_set1_ps(dt);
+    for(; i + 8 <= n; i += 8) {
+        __m256 vel =
+            _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(v + i), a8), d8);
+        _mm256_storeu_ps(v + i, vel);
+        _mm256_storeu_ps(p + i, _mm256_add_ps(_mm256_loadu_ps(p + i),
+                                              _mm256_mul_ps(vel, t8)));
+    }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+    __m128 a4 = _mm_set1_ps(a_dt);
+    __m128 d4 = _mm_set1_ps(damping);
+    __m128 t4 = _mm_set1_ps(dt);
+    for(; i + 4 <= n; i += 4) {
+        __m128 vel = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(v + i), a4), d4);
+        _mm_storeu_ps(v + i, vel);
+        _mm_storeu_ps(p + i,
+                      _mm_add_ps(_mm_loadu_ps(p + i), _mm_mul_ps(vel, t4)));
+    }
+#endif
+    for(; i < n; ++i) {
+        v[i] = (v[i] + a_dt) * damping;
+        p[i] += v[i] * dt;
+    }
+}
+
+void age(float *life, size_t n, float dt) {
+    size_t i = 0;
+#if defined(__AVX__)
+    __m256 t8 = _mm256_set1_ps(dt);
+    for(; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(life + i,
+                         _mm256_sub_ps(_mm256_loadu_ps(life + i), t8));
+    }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+    __m128 t4 = _mm_set1_ps(dt);
+    for(; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(life + i, _mm_sub_ps(_mm_loadu_ps(life + i), t4));
+    }
+#endif
+    for(; i < n; ++i) {
+        life[i] -= dt;
+    }
+}
+
+// Calls fn(begin, end) over [0, n) in pieces of at most chunk, spread over
+// the pool if there is one.
+template <typename F>
+void for_chunks(size_t n, size_t chunk, thread_pool *pool, F &&fn) {
+    auto chunks = (n + chunk - 1) / chunk;
+    if(pool == nullptr || chunks < 2) {
+        if(n > 0) {
+            fn(size_t{0}, n);
+        }
+        return;
+    }
+    pool->parallel_for(chunks, [&fn, n, chunk](size_t c) {
+        auto begin = c * chunk;
+        fn(begin, std::min(n, begin + chunk));
+    });
+}
+
+} // namespace
+
+particle_emitter::particle_emitter(size_t capacity, particle_settings settings,
+                                   uint64_t seed)
+    : m_settings{settings}, m_rng{seed}, m_capacity{capacity},
+      m_x(capacity), m_y(capacity), m_vx(capacity), m_vy(capacity),
+      m_life(capacity), m_inv_lifetime(capacity), m_color(capacity) {}
+
+auto particle_emitter::emit(size_t n, color tint) -> size_t {
+    n           = std::min(n, m_capacity - m_size);
+    auto  first = m_size;
+    auto  part  = [first, n](std::vector<float> &v) {
+        return std::span<float>{v}.subspan(first, n);
+    };
+    auto const &s = m_settings;
+
+    m_rng.fill_uniform(part(m_x), s.position.x - s.spread.x,
+                       s.position.x + s.spread.x);
+    m_rng.fill_uniform(part(m_y), s.position.y - s.spread.y,
+                       s.position.y + s.spread.y);
+    m_rng.fill_normal(part(m_vx), s.velocity.x, s.velocity_stddev);
+    m_rng.fill_normal(part(m_vy), s.velocity.y, s.velocity_stddev);
+    m_rng.fill_uniform(part(m_life), s.lifetime * (1 - s.lifetime_variance),
+                       s.lifetime * (1 + s.lifetime_variance));
+
+    auto sdl_color = tint.get_sdl_color();
+    for(auto i = first; i < first + n; ++i) {
+        m_inv_lifetime[i] = m_life[i] > 0 ? 1 / m_life[i] : 0;
+        m_color[i]        = sdl_color;
+    }
+    m_size += n;
+    return n;
+}
+
+void particle_emitter::move_particle(size_t from, size_t to) {
+    m_x[to]            = m_x[from];
+    m_y[to]            = m_y[from];
+    m_vx[to]           = m_vx[from];
+    m_vy[to]           = m_vy[from];
+    m_life[to]         = m_life[from];
+    m_inv_lifetime[to] = m_inv_lifetime[from];
+    m_color[to]        = m_color[from];
+}
+
+void particle_emitter::compact() {
+    for(size_t i = 0; i < m_size;) {
+        if(m_life[i] > 0) {
+            ++i;
+            continue;
+        }
+        --m_size;
+        move_particle(m_size, i);
+    }
+}
+
+void particle_emitter::update(float dt, thread_pool *pool) {
+    GFX_PROFILE_SCOPE("particles");
+    m_pending += m_settings.rate * dt;
+    if(m_pending >= 1) {
+        auto n    = static_cast<size_t>(m_pending);
+        m_pending -= static_cast<float>(n);
+        emit(n);
+    }
+
+    auto damping = std::max(0.0F, 1 - m_settings.drag * dt);
+    auto ax      = m_settings.acceleration.x * dt;
+    auto ay      = m_settings.acceleration.y * dt;
+    for_chunks(m_size, chunk_size, pool, [&](size_t begin, size_t end) {
+        auto n = end - begin;
+        integrate(m_x.data() + begin, m_vx.data() + begin, n, ax, damping, dt);
+        integrate(m_y.data() + begin, m_vy.data() + begin, n, ay, damping, dt);
+        age(m_life.data() + begin, n, dt);
+    });
+    compact();
+}
+
+void particle_emitter::build_vertices(size_t begin, size_t end,
+                                      vec2d_t<float> offset, float zoom) {
+    auto       half = m_settings.size * zoom * 0.5F;
+    SDL_FPoint uv0{0, 0};
+    SDL_FPoint uv1{1, 1};
+    if(m_region) {
+        auto const &b = m_region->bounds;
+        auto        w = static_cast<float>(m_region->source->width());
+        auto        h = static_cast<float>(m_region->source->height());
+        uv0 = {static_cast<float>(b.x) / w, static_cast<float>(b.y) / h};
+        uv1 = {static_cast<float>(b.x + b.w) / w,
+               static_cast<float>(b.y + b.h) / h};
+    }
+
+    for(auto i = begin; i < end; ++i) {
+        auto x = (m_x[i] - offset.x) * zoom;
+        auto y = (m_y[i] - offset.y) * zoom;
+        auto c = m_color[i];
+        if(m_settings.fade) {
+            auto t = std::clamp(m_life[i] * m_inv_lifetime[i], 0.0F, 1.0F);
+            c.a    = static_cast<uint8_t>(static_cast<float>(c.a) * t);
+        }
+        auto *v = &m_vertices[i * 4];
+        v[0]    = {{x - half, y - half}, c, uv0};
+        v[1]    = {{x + half, y - half}, c, {uv1.x, uv0.y}};
+        v[2]    = {{x - half, y + half}, c, {uv0.x, uv1.y}};
+        v[3]    = {{x + half, y + half}, c, uv1};
+    }
+}
+
+void particle_emitter::draw(renderer &r, rect_t<double> view,
+                            thread_pool *pool) {
+    if(m_size == 0) {
+        return;
+    }
+    GFX_PROFILE_SCOPE("particles");
+
+    // Indices never change for a given quad, so they are only appended.
+    constexpr std::array<int, 6> quad{0, 1, 2, 2, 1, 3};
+    if(m_indices.size() < m_size * quad.size()) {
+        auto built = m_indices.size() / quad.size();
+        m_indices.resize(m_size * quad.size());
+        for(auto q = built; q < m_size; ++q) {
+            auto base = static_cast<int>(q * 4);
+            for(size_t k = 0; k < quad.size(); ++k) {
+                m_indices[q * quad.size() + k] = base + quad[k];
+            }
+        }
+    }
+
+    m_vertices.resize(m_size * 4);
+    auto zoom = static_cast<float>(r.get_window_size().x / view.size.x);
+    vec2d_t<float> offset{static_cast<float>(view.position.x),
+                          static_cast<float>(view.position.y)};
+    for_chunks(m_size, chunk_size, pool, [&](size_t begin, size_t end) {
+        build_vertices(begin, end, offset, zoom);
+    });
+
+    r.draw_geometry(m_vertices,
+                    std::span<int const>{m_indices.data(),
+                                         m_size * quad.size()},
+                    m_region ? m_region->source->get_sdl_texture() : nullptr);
+}
+
+} // namespace gfx
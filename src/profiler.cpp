@@ -0,0 +1,228 @@
+#include <fmt/core.h>
+
+#include "gfx/profiler.h"
+
+namespace gfx {
+
+namespace {
+
+auto thread_index() -> uint32_t {
+    static std::atomic<uint32_t> next{0};
+    thread_local uint32_t        index = next++;
+    return index;
+}
+
+auto to_ms(std::chrono::nanoseconds d) -> double {
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+auto to_us(std::chrono::nanoseconds d) -> double {
+    return std::chrono::duration<double, std::micro>(d).count();
+}
+
+} // namespace
+
+auto counter_name(counter c) -> char const * {
+    switch(c) {
+    case counter::draw_calls:
+        return "draw_calls";
+    case counter::primitives:
+        return "primitives";
+    case counter::state_changes:
+        return "state_changes";
+    case counter::state_changes_skipped:
+        return "state_changes_skipped";
+    case counter::texture_creations:
+        return "texture_creations";
+    case counter::texture_uploads:
+        return "texture_uploads";
+    case counter::bytes_uploaded:
+        return "bytes_uploaded";
+    case counter::text_rasterizations:
+        return "text_rasterizations";
+    case counter::draws_culled:
+        return "draws_culled";
+    case counter::count:
+        break;
+    }
+    return "unknown";
+}
+
+auto timer_name(timer t) -> char const * {
+    switch(t) {
+    case timer::renderer:
+        return "renderer";
+    case timer::present:
+        return "present";
+    case timer::count:
+        break;
+    }
+    return "unknown";
+}
+
+auto profiler::instance() -> profiler & {
+    static profiler p;
+    return p;
+}
+
+void profiler::record(trace_event const &event) {
+    std::lock_guard lock{m_mutex};
+    if(m_event_capacity == 0) {
+        return;
+    }
+    if(m_events.size() == m_event_capacity) {
+        m_events.pop_front();
+    }
+    m_events.push_back(event);
+}
+
+auto profiler::current() const -> frame_profile {
+    std::lock_guard lock{m_mutex};
+    frame_profile   frame;
+    frame.index  = m_frame_index;
+    frame.start  = m_frame_start - m_epoch;
+    frame.length = clock::now() - m_frame_start;
+    for(size_t i = 0; i < counter_count; ++i) {
+        frame.counters[i] = m_counters[i].load(std::memory_order_relaxed);
+    }
+    for(size_t i = 0; i < timer_count; ++i) {
+        frame.timers[i] = std::chrono::nanoseconds{
+            m_timers[i].load(std::memory_order_relaxed)};
+    }
+    return frame;
+}
+
+void profiler::end_frame() {
+    auto          end = clock::now();
+    frame_profile frame;
+    {
+        std::lock_guard lock{m_mutex};
+        frame.index  = m_frame_index++;
+        frame.start  = m_frame_start - m_epoch;
+        frame.length = end - m_frame_start;
+        for(size_t i = 0; i < counter_count; ++i) {
+            frame.counters[i] = m_counters[i].exchange(0);
+        }
+        for(size_t i = 0; i < timer_count; ++i) {
+            frame.timers[i] = std::chrono::nanoseconds{m_timers[i].exchange(0)};
+        }
+        m_frame_start = end;
+
+        if(m_frame_capacity > 0) {
+            if(m_frames.size() == m_frame_capacity) {
+                m_frames.pop_front();
+            }
+            m_frames.push_back(frame);
+        }
+    }
+    record({"frame", frame.start, frame.length, thread_index()});
+}
+
+auto profiler::frames() const -> std::vector<frame_profile> {
+    std::lock_guard lock{m_mutex};
+    return {m_frames.begin(), m_frames.end()};
+}
+
+auto profiler::events() const -> std::vector<trace_event> {
+    std::lock_guard lock{m_mutex};
+    return {m_events.begin(), m_events.end()};
+}
+
+void profiler::set_capacity(size_t frames, size_t events) {
+    std::lock_guard lock{m_mutex};
+    m_frame_capacity = frames;
+    m_event_capacity = events;
+    while(m_frames.size() > frames) {
+        m_frames.pop_front();
+    }
+    while(m_events.size() > events) {
+        m_events.pop_front();
+    }
+}
+
+void profiler::reset() {
+    std::lock_guard lock{m_mutex};
+    m_frames.clear();
+    m_events.clear();
+    for(auto &c : m_counters) {
+        c = 0;
+    }
+    for(auto &t : m_timers) {
+        t = 0;
+    }
+    m_frame_index = 0;
+    m_frame_start = clock::now();
+}
+
+void profiler::write_json(std::ostream &out) const {
+    auto frames = this->frames();
+    out << "{\"frames\": [";
+    for(size_t i = 0; i < frames.size(); ++i) {
+        auto const &f = frames[i];
+        out << (i == 0 ? "\n" : ",\n")
+            << fmt::format("  {{\"index\": {}, \"start_ms\": {:.3f}, "
+                           "\"frame_ms\": {:.3f}",
+                           f.index, to_ms(f.start), to_ms(f.length));
+        for(size_t t = 0; t < timer_count; ++t) {
+            out << fmt::format(", \"{}_ms\": {:.3f}",
+                               timer_name(static_cast<timer>(t)),
+                               to_ms(f.timers[t]));
+        }
+        for(size_t c = 0; c < counter_count; ++c) {
+            out << fmt::format(", \"{}\": {}",
+                               counter_name(static_cast<counter>(c)),
+                               f.counters[c]);
+        }
+        out << "}";
+    }
+    out << "\n]}\n";
+}
+
+void profiler::write_chrome_trace(std::ostream &out) const {
+    auto frames = this->frames();
+    auto events = this->events();
+    bool first  = true;
+    auto next   = [&out, &first] {
+        out << (first ? "\n" : ",\n");
+        first = false;
+    };
+
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    for(auto const &e : events) {
+        next();
+        out << fmt::format("  {{\"name\": \"{}\", \"cat\": \"gfx\", "
+                           "\"ph\": \"X\", \"ts\": {:.3f}, \"dur\": {:.3f}, "
+                           "\"pid\": 0, \"tid\": {}}}",
+                           e.name, to_us(e.start), to_us(e.length), e.thread);
+    }
+    for(auto const &f : frames) {
+        next();
+        out << fmt::format("  {{\"name\": \"frame counters\", \"ph\": \"C\", "
+                           "\"ts\": {:.3f}, \"pid\": 0, \"args\": {{",
+                           to_us(f.start));
+        for(size_t c = 0; c < counter_count; ++c) {
+            out << fmt::format("{}\"{}\": {}", c == 0 ? "" : ", ",
+                               counter_name(static_cast<counter>(c)),
+                               f.counters[c]);
+        }
+        out << "}}";
+        next();
+        out << fmt::format("  {{\"name\": \"frame times\", \"ph\": \"C\", "
+                           "\"ts\": {:.3f}, \"pid\": 0, \"args\": {{",
+                           to_us(f.start));
+        for(size_t t = 0; t < timer_count; ++t) {
+            out << fmt::format("{}\"{}_ms\": {:.3f}", t == 0 ? "" : ", ",
+                               timer_name(static_cast<timer>(t)),
+                               to_ms(f.timers[t]));
+        }
+        out << "}}";
+    }
+    out << "\n]}\n";
+}
+
+profile_scope::~profile_scope() {
+    auto &p = profiler::instance();
+    p.record({m_name, m_start, p.now() - m_start, thread_index()});
+}
+
+} // namespace gfx
@@ -0,0 +1,219 @@
+#include <bit>
+#include <cmath>
+#include <numbers>
+#include <random>
+#include <type_traits>
+
+#include "gfx/random.h"
+
+namespace gfx {
+
+namespace {
+
+static_assert(sizeof(vec2d_t<double>) == 2 * sizeof(double));
+static_assert(sizeof(vec2d_t<float>) == 2 * sizeof(float));
+
+auto splitmix64(uint64_t &x) -> uint64_t {
+    auto z = (x += 0x9E3779B97F4A7C15ULL);
+    z      = (z ^ (z >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+    z      = (z ^ (z >> 27U)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31U);
+}
+
+// Uniform in [0, 1) from the top mantissa bits, without an int to float
+// conversion, so the fill loops stay vectorizable.
+template <typename T> auto unit(std::array<uint64_t, 4> const &block, size_t k)
+    -> T {
+    if constexpr(std::is_same_v<T, double>) {
+        return std::bit_cast<double>((block[k] >> 12U) |
+                                     0x3FF0000000000000ULL) -
+               1.0;
+    } else {
+        auto half = static_cast<uint32_t>(block[k / 2] >> (32U * (k & 1U)));
+        return std::bit_cast<float>((half >> 9U) | 0x3F800000U) - 1.0F;
+    }
+}
+
+template <typename T>
+constexpr size_t per_block = 4 * sizeof(uint64_t) / sizeof(T);
+
+} // namespace
+
+random_engine::random_engine(uint64_t seed) {
+    for(auto &word : m_state) {
+        word = splitmix64(seed);
+    }
+    for(size_t lane = 0; lane < lanes; ++lane) {
+        for(auto &words : m_lanes) {
+            words[lane] = splitmix64(seed);
+        }
+    }
+}
+
+auto random_engine::random_seed() -> uint64_t {
+    std::random_device device;
+    return static_cast<uint64_t>(device()) << 32U | device();
+}
+
+auto random_engine::normal(double mean, double stddev) -> double {
+    if(m_has_spare) {
+        m_has_spare = false;
+        return mean + stddev * m_spare;
+    }
+    auto r     = std::sqrt(-2.0 * std::log(1.0 - uniform()));
+    auto theta = 2.0 * std::numbers::pi * uniform();
+    m_spare     = r * std::sin(theta);
+    m_has_spare = true;
+    return mean + stddev * r * std::cos(theta);
+}
+
+void random_engine::jump() {
+    constexpr state polynomial{0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL,
+                               0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL};
+    auto jump_state = [&polynomial](state &s) {
+        state sum{};
+        for(auto word : polynomial) {
+            for(unsigned bit = 0; bit < 64; ++bit) {
+                if((word >> bit) & 1U) {
+                    for(size_t i = 0; i < sum.size(); ++i) {
+                        sum[i] ^= s[i];
+                    }
+                }
+                next(s);
+            }
+        }
+        s = sum;
+    };
+
+    jump_state(m_state);
+    for(size_t lane = 0; lane < lanes; ++lane) {
+        state s{m_lanes[0][lane], m_lanes[1][lane], m_lanes[2][lane],
+                m_lanes[3][lane]};
+        jump_state(s);
+        for(size_t i = 0; i < s.size(); ++i) {
+            m_lanes[i][lane] = s[i];
+        }
+    }
+    m_has_spare = false;
+}
+
+auto random_engine::split() -> random_engine {
+    auto copy = *this;
+    jump();
+    return copy;
+}
+
+template <typename F> void random_engine::generate(size_t blocks, F &&consume) {
+    auto                        s = m_lanes;
+    std::array<uint64_t, lanes> block{};
+    for(size_t b = 0; b < blocks; ++b) {
+        for(size_t l = 0; l < lanes; ++l) {
+            block[l] = rotl(s[0][l] + s[3][l], 23) + s[0][l];
+            auto t   = s[1][l] << 17U;
+            s[2][l]  ^= s[0][l];
+            s[3][l]  ^= s[1][l];
+            s[1][l]  ^= s[2][l];
+            s[0][l]  ^= s[3][l];
+            s[2][l]  ^= t;
+            s[3][l]  = rotl(s[3][l], 45);
+        }
+        consume(block);
+    }
+    m_lanes = s;
+}
+
+// Even elements use lo[0] and scale[0], odd ones lo[1] and scale[1], which
+// covers both plain arrays and interleaved x/y pairs.
+template <typename T>
+void random_engine::fill_uniform(T *out, size_t n, std::array<T, 2> lo,
+                                 std::array<T, 2> scale) {
+    constexpr auto step = per_block<T>;
+    size_t         i    = 0;
+    generate(n / step, [&](auto const &block) {
+        for(size_t k = 0; k < step; ++k) {
+            out[i + k] = lo[k & 1U] + scale[k & 1U] * unit<T>(block, k);
+        }
+        i += step;
+    });
+    if(i < n) {
+        generate(1, [&](auto const &block) {
+            for(size_t k = 0; i + k < n; ++k) {
+                out[i + k] = lo[k & 1U] + scale[k & 1U] * unit<T>(block, k);
+            }
+        });
+    }
+}
+
+// Box-Muller on consecutive pairs; the cosine half goes to even elements.
+template <typename T>
+void random_engine::fill_normal(T *out, size_t n, std::array<T, 2> mean,
+                                T stddev) {
+    constexpr auto step = per_block<T>;
+    constexpr auto tau  = static_cast<T>(2 * std::numbers::pi);
+    size_t         i    = 0;
+    auto           pair = [&](auto const &block, size_t k, T *dst, bool both) {
+        auto r     = std::sqrt(T{-2} * std::log(T{1} - unit<T>(block, k)));
+        auto theta = tau * unit<T>(block, k + 1);
+        dst[0]     = mean[0] + stddev * r * std::cos(theta);
+        if(both) {
+            dst[1] = mean[1] + stddev * r * std::sin(theta);
+        }
+    };
+    generate(n / step, [&](auto const &block) {
+        for(size_t k = 0; k < step; k += 2) {
+            pair(block, k, out + i + k, true);
+        }
+        i += step;
+    });
+    if(i < n) {
+        generate(1, [&](auto const &block) {
+            for(size_t k = 0; i + k < n; k += 2) {
+                pair(block, k, out + i + k, i + k + 1 < n);
+            }
+        });
+    }
+}
+
+void random_engine::fill_uniform(std::span<double> out, double lo, double hi) {
+    fill_uniform(out.data(), out.size(), {lo, lo}, {hi - lo, hi - lo});
+}
+
+void random_engine::fill_uniform(std::span<float> out, float lo, float hi) {
+    fill_uniform(out.data(), out.size(), {lo, lo}, {hi - lo, hi - lo});
+}
+
+void random_engine::fill_uniform(std::span<vec2d_t<double>> out,
+                                 vec2d_t<double> lo, vec2d_t<double> hi) {
+    fill_uniform(reinterpret_cast<double *>(out.data()), 2 * out.size(),
+                 {lo.x, lo.y}, {hi.x - lo.x, hi.y - lo.y});
+}
+
+void random_engine::fill_uniform(std::span<vec2d_t<float>> out,
+                                 vec2d_t<float> lo, vec2d_t<float> hi) {
+    fill_uniform(reinterpret_cast<float *>(out.data()), 2 * out.size(),
+                 {lo.x, lo.y}, {hi.x - lo.x, hi.y - lo.y});
+}
+
+void random_engine::fill_normal(std::span<double> out, double mean,
+                                double stddev) {
+    fill_normal(out.data(), out.size(), {mean, mean}, stddev);
+}
+
+void random_engine::fill_normal(std::span<float> out, float mean,
+                                float stddev) {
+    fill_normal(out.data(), out.size(), {mean, mean}, stddev);
+}
+
+void random_engine::fill_normal(std::span<vec2d_t<double>> out,
+                                vec2d_t<double> mean, double stddev) {
+    fill_normal(reinterpret_cast<double *>(out.data()), 2 * out.size(),
+                {mean.x, mean.y}, stddev);
+}
+
+void random_engine::fill_normal(std::span<vec2d_t<float>> out,
+                                vec2d_t<float> mean, float stddev) {
+    fill_normal(reinterpret_cast<float *>(out.data()), 2 * out.size(),
+                {mean.x, mean.y}, stddev);
+}
+
+} // namespace gfx
@@ -0,0 +1,482 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#include "gfx/gfx.h"
+
+namespace gfx {
+
+namespace {
+
+constexpr uint32_t max_channel = 255;
+
+// x / 255 rounded to nearest, exact for x <= 255 * 255.
+constexpr auto div255(uint32_t x) -> uint8_t {
+    x += 128;
+    return static_cast<uint8_t>((x + (x >> 8U)) >> 8U);
+}
+
+// Source-over blending of straight (non-premultiplied) alpha, matching
+// SDL_BLENDMODE_BLEND: rgb = s * a + d * (1 - a), alpha = a + d * (1 - a).
+void blend_pixel(uint8_t *dst, uint8_t const *src) {
+    uint32_t a  = src[3];
+    uint32_t ia = max_channel - a;
+    dst[0]      = div255(src[0] * a + dst[0] * ia);
+    dst[1]      = div255(src[1] * a + dst[1] * ia);
+    dst[2]      = div255(src[2] * a + dst[2] * ia);
+    dst[3]      = div255(max_channel * a + dst[3] * ia);
+}
+
+auto to_pixel(color c) -> uint32_t {
+    uint8_t  bytes[bytes_per_pixel]{c.r, c.g, c.b, c.a};
+    uint32_t pixel{};
+    std::memcpy(&pixel, bytes, sizeof(pixel));
+    return pixel;
+}
+
+void store_span(uint8_t *dst, uint32_t pixel, int n) {
+    for(int i = 0; i < n; ++i) {
+        std::memcpy(dst + i * bytes_per_pixel, &pixel, sizeof(pixel));
+    }
+}
+
+#if defined(__SSE2__) || defined(_M_X64)
+// Eight 16-bit lanes, two pixels worth of channels, divided by 255.
+auto div255(__m128i x) -> __m128i {
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+auto broadcast_alpha(__m128i channels) -> __m128i {
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(channels, 0xFF), 0xFF);
+}
+#endif
+
+// Blends a single color over n pixels.
+void blend_fill(uint8_t *dst, color c, int n) {
+    if(c.a == color::transparent) {
+        return;
+    }
+    if(c.a == color::opaque) {
+        store_span(dst, to_pixel(c), n);
+        return;
+    }
+    uint8_t const src[bytes_per_pixel]{c.r, c.g, c.b, c.a};
+    int           i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+    uint32_t a    = c.a;
+    auto     lane = [a](uint32_t v) { return static_cast<short>(v * a); };
+    __m128i  zero = _mm_setzero_si128();
+    __m128i  sa   = _mm_setr_epi16(lane(c.r), lane(c.g), lane(c.b),
+                                   lane(max_channel), lane(c.r), lane(c.g),
+                                   lane(c.b), lane(max_channel));
+    __m128i  ia   = _mm_set1_epi16(static_cast<short>(max_channel - a));
+    for(; i + 4 <= n; i += 4) {
+        auto   *p  = dst + i * bytes_per_pixel;
+        __m128i d  = _mm_loadu_si128(reinterpret_cast<__m128i const *>(p));
+        __m128i lo = _mm_add_epi16(
+            sa, _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), ia));
+        __m128i hi = _mm_add_epi16(
+            sa, _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), ia));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p),
+                         _mm_packus_epi16(div255(lo), div255(hi)));
+    }
+#endif
+    for(; i < n; ++i) {
+        blend_pixel(dst + i * bytes_per_pixel, src);
+    }
+}
+
+// Blends n RGBA32 source pixels over n destination pixels.
+void blend_span(uint8_t *dst, uint8_t const *src, int n) {
+    int i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+    __m128i zero   = _mm_setzero_si128();
+    __m128i amask  = _mm_set1_epi32(static_cast<int>(0xFF000000U));
+    __m128i full   = _mm_set1_epi16(static_cast<short>(max_channel));
+    __m128i aforce = _mm_setr_epi16(0, 0, 0, 0xFF, 0, 0, 0, 0xFF);
+    for(; i + 4 <= n; i += 4) {
+        auto   *p = dst + i * bytes_per_pixel;
+        __m128i s = _mm_loadu_si128(
+            reinterpret_cast<__m128i const *>(src + i * bytes_per_pixel));
+        __m128i alpha = _mm_and_si128(s, amask);
+        if(_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, zero)) == 0xFFFF) {
+            continue;
+        }
+        if(_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, amask)) == 0xFFFF) {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(p), s);
+            continue;
+        }
+        __m128i d   = _mm_loadu_si128(reinterpret_cast<__m128i const *>(p));
+        __m128i slo = _mm_unpacklo_epi8(s, zero);
+        __m128i shi = _mm_unpackhi_epi8(s, zero);
+        __m128i alo = broadcast_alpha(slo);
+        __m128i ahi = broadcast_alpha(shi);
+        __m128i lo  = _mm_add_epi16(
+            _mm_mullo_epi16(_mm_or_si128(slo, aforce), alo),
+            _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero),
+                            _mm_sub_epi16(full, alo)));
+        __m128i hi = _mm_add_epi16(
+            _mm_mullo_epi16(_mm_or_si128(shi, aforce), ahi),
+            _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero),
+                            _mm_sub_epi16(full, ahi)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p),
+                         _mm_packus_epi16(div255(lo), div255(hi)));
+    }
+#endif
+    for(; i < n; ++i) {
+        blend_pixel(dst + i * bytes_per_pixel, src + i * bytes_per_pixel);
+    }
+}
+
+auto intersect(SDL_Rect const &a, SDL_Rect const &b) -> SDL_Rect {
+    int x0 = std::max(a.x, b.x);
+    int y0 = std::max(a.y, b.y);
+    int x1 = std::min(a.x + a.w, b.x + b.w);
+    int y1 = std::min(a.y + a.h, b.y + b.h);
+    return {x0, y0, std::max(0, x1 - x0), std::max(0, y1 - y0)};
+}
+
+auto empty(SDL_Rect const &r) -> bool { return r.w <= 0 || r.h <= 0; }
+
+// Whether any pixel of a circle (filled or just its outline) can fall
+// inside the tile; only used to keep large circles out of tiles they miss.
+auto circle_touches(int cx, int cy, int radius, bool filled,
+                    SDL_Rect const &tile) -> bool {
+    auto nearest = [](int c, int lo, int len) {
+        return static_cast<int64_t>(std::clamp(c, lo, lo + len - 1) - c);
+    };
+    auto farthest = [](int c, int lo, int len) {
+        return static_cast<int64_t>(std::max(std::abs(c - lo),
+                                             std::abs(lo + len - 1 - c)));
+    };
+    auto    r2     = static_cast<int64_t>(radius) * radius;
+    int64_t near_x = nearest(cx, tile.x, tile.w);
+    int64_t near_y = nearest(cy, tile.y, tile.h);
+    if(near_x * near_x + near_y * near_y > r2) {
+        return false;
+    }
+    if(filled) {
+        return true;
+    }
+    int64_t far_x = farthest(cx, tile.x, tile.w) + 1;
+    int64_t far_y = farthest(cy, tile.y, tile.h) + 1;
+    return far_x * far_x + far_y * far_y >= r2;
+}
+
+} // namespace
+
+software_rasterizer::software_rasterizer(surface &target, thread_pool *pool,
+                                         int tile_size)
+    : m_target{&target}, m_tile_size{std::max(tile_size, 8)}, m_pool{pool} {
+    layout_tiles();
+}
+
+void software_rasterizer::layout_tiles() {
+    auto *s = m_target->get_sdl_surface();
+    if(s == nullptr || s->format->format != SDL_PIXELFORMAT_RGBA32) {
+        throw std::runtime_error{"rasterizer target must be an RGBA32 surface"};
+    }
+    m_tiles_x = (s->w + m_tile_size - 1) / m_tile_size;
+    m_tiles_y = (s->h + m_tile_size - 1) / m_tile_size;
+    m_bins.resize(static_cast<size_t>(m_tiles_x) *
+                  static_cast<size_t>(m_tiles_y));
+}
+
+void software_rasterizer::set_target(surface &target) {
+    flush();
+    m_target = &target;
+    layout_tiles();
+}
+
+void software_rasterizer::record(op const &o) {
+    auto *s      = m_target->get_sdl_surface();
+    auto  bounds = intersect(o.bounds, {0, 0, s->w, s->h});
+    if(empty(bounds)) {
+        return;
+    }
+    auto index = static_cast<uint32_t>(m_ops.size());
+    m_ops.push_back(o);
+
+    int tx0 = bounds.x / m_tile_size;
+    int ty0 = bounds.y / m_tile_size;
+    int tx1 = (bounds.x + bounds.w - 1) / m_tile_size;
+    int ty1 = (bounds.y + bounds.h - 1) / m_tile_size;
+    for(int ty = ty0; ty <= ty1; ++ty) {
+        for(int tx = tx0; tx <= tx1; ++tx) {
+            SDL_Rect tile{tx * m_tile_size, ty * m_tile_size, m_tile_size,
+                          m_tile_size};
+            if((o.kind == op_kind::circle || o.kind == op_kind::fill_circle) &&
+               !circle_touches(o.x0, o.y0, o.x1,
+                               o.kind == op_kind::fill_circle, tile)) {
+                continue;
+            }
+            m_bins[static_cast<size_t>(ty * m_tiles_x + tx)].push_back(index);
+        }
+    }
+}
+
+void software_rasterizer::clear(color c) {
+    auto *s = m_target->get_sdl_surface();
+    record({op_kind::clear, c, {0, 0, s->w, s->h}});
+}
+
+void software_rasterizer::fill_rect(SDL_Rect const &rect, color c) {
+    if(c.a != color::transparent) {
+        record({op_kind::fill_rect, c, rect});
+    }
+}
+
+void software_rasterizer::draw_line(vec2d_t<int> from, vec2d_t<int> to,
+                                    color c) {
+    if(c.a == color::transparent) {
+        return;
+    }
+    SDL_Rect bounds{std::min(from.x, to.x), std::min(from.y, to.y),
+                    std::abs(to.x - from.x) + 1, std::abs(to.y - from.y) + 1};
+    record({op_kind::line, c, bounds, from.x, from.y, to.x, to.y});
+}
+
+void software_rasterizer::fill_circle(vec2d_t<int> center, int radius,
+                                      color c) {
+    if(radius < 0 || c.a == color::transparent) {
+        return;
+    }
+    SDL_Rect bounds{center.x - radius, center.y - radius, 2 * radius + 1,
+                    2 * radius + 1};
+    record({op_kind::fill_circle, c, bounds, center.x, center.y, radius});
+}
+
+void software_rasterizer::draw_circle(vec2d_t<int> center, int radius,
+                                      color c) {
+    if(radius < 0 || c.a == color::transparent) {
+        return;
+    }
+    SDL_Rect bounds{center.x - radius, center.y - radius, 2 * radius + 1,
+                    2 * radius + 1};
+    record({op_kind::circle, c, bounds, center.x, center.y, radius});
+}
+
+void software_rasterizer::blit(surface const &source, vec2d_t<int> position) {
+    auto *s = source.get_sdl_surface();
+    if(s == nullptr) {
+        return;
+    }
+    if(s->format->format != SDL_PIXELFORMAT_RGBA32) {
+        surface converted{
+            SDL_ConvertSurfaceFormat(s, SDL_PIXELFORMAT_RGBA32, 0)};
+        if(converted.get_sdl_surface() == nullptr) {
+            throw std::runtime_error{
+                fmt::format("couldn't convert surface: {}", SDL_GetError())};
+        }
+        s = converted.get_sdl_surface();
+        m_scratch.push_back(std::move(converted));
+    }
+    record({op_kind::blit, color{}, {position.x, position.y, s->w, s->h},
+            position.x, position.y, 0, 0, s});
+}
+
+void software_rasterizer::draw_text(font &f, std::string_view text,
+                                    vec2d_t<int> position, color c,
+                                    uint32_t wrap_width) {
+    if(text.empty()) {
+        return;
+    }
+    std::string str{text};
+    surface     rendered{
+        wrap_width == 0
+                ? TTF_RenderUTF8_Blended(f.get_ttf_font(), str.c_str(),
+                                         c.get_sdl_color())
+                : TTF_RenderUTF8_Blended_Wrapped(f.get_ttf_font(), str.c_str(),
+                                                 c.get_sdl_color(), wrap_width)};
+    if(rendered.get_sdl_surface() == nullptr) {
+        throw std::runtime_error{
+            fmt::format("couldn't render text: {}", TTF_GetError())};
+    }
+    GFX_PROFILE_COUNT(text_rasterizations, 1);
+    blit(rendered, position);
+}
+
+void software_rasterizer::rasterize(size_t tile) {
+    auto &bin = m_bins[tile];
+    if(bin.empty()) {
+        return;
+    }
+    auto *s     = m_target->get_sdl_surface();
+    auto *base  = static_cast<uint8_t *>(s->pixels);
+    auto  pitch = s->pitch;
+    int   tx    = static_cast<int>(tile) % m_tiles_x;
+    int   ty    = static_cast<int>(tile) / m_tiles_x;
+    auto  clip  = intersect(
+        {tx * m_tile_size, ty * m_tile_size, m_tile_size, m_tile_size},
+        {0, 0, s->w, s->h});
+
+    auto at = [base, pitch](int x, int y) {
+        return base + y * pitch + x * bytes_per_pixel;
+    };
+    auto inside = [&clip](int x, int y) {
+        return x >= clip.x && x < clip.x + clip.w && y >= clip.y &&
+               y < clip.y + clip.h;
+    };
+
+    for(auto index : bin) {
+        auto const   &o = m_ops[index];
+        uint8_t const src[bytes_per_pixel]{o.draw_color.r, o.draw_color.g,
+                                           o.draw_color.b, o.draw_color.a};
+        auto          plot = [&](int x, int y) {
+            if(inside(x, y)) {
+                blend_pixel(at(x, y), src);
+            }
+        };
+
+        switch(o.kind) {
+        case op_kind::clear: {
+            auto pixel = to_pixel(o.draw_color);
+            for(int y = clip.y; y < clip.y + clip.h; ++y) {
+                store_span(at(clip.x, y), pixel, clip.w);
+            }
+            break;
+        }
+        case op_kind::fill_rect: {
+            auto r = intersect(o.bounds, clip);
+            for(int y = r.y; y < r.y + r.h; ++y) {
+                blend_fill(at(r.x, y), o.draw_color, r.w);
+            }
+            break;
+        }
+        case op_kind::line: {
+            // Every pixel is computed from its step along the major axis
+            // rather than incrementally, so each tile only walks the steps
+            // that land inside it and all tiles agree on the line.
+            int  dx      = o.x1 - o.x0;
+            int  dy      = o.y1 - o.y0;
+            bool x_major = std::abs(dx) >= std::abs(dy);
+            int  major   = x_major ? dx : dy;
+            int  minor   = x_major ? dy : dx;
+            int  start   = x_major ? o.x0 : o.y0;
+            int  other   = x_major ? o.y0 : o.x0;
+            int  lo      = x_major ? clip.x : clip.y;
+            int  hi      = lo + (x_major ? clip.w : clip.h) - 1;
+            int  step    = major < 0 ? -1 : 1;
+            int  sign    = minor < 0 ? -1 : 1;
+            auto n       = static_cast<int64_t>(std::abs(major));
+            auto m       = static_cast<int64_t>(std::abs(minor));
+
+            int first = step > 0 ? lo - start : start - hi;
+            int last  = step > 0 ? hi - start : start - lo;
+            first     = std::max(first, 0);
+            last      = std::min(last, static_cast<int>(n));
+            for(int i = first; i <= last; ++i) {
+                int along  = start + i * step;
+                int across = n == 0 ? other
+                                    : other + sign * static_cast<int>(
+                                                         (2 * i * m + n) /
+                                                         (2 * n));
+                if(x_major) {
+                    plot(along, across);
+                } else {
+                    plot(across, along);
+                }
+            }
+            break;
+        }
+        case op_kind::fill_circle: {
+            auto r  = intersect(o.bounds, clip);
+            auto r2 = static_cast<int64_t>(o.x1) * o.x1;
+            for(int y = r.y; y < r.y + r.h; ++y) {
+                auto dy   = static_cast<int64_t>(y - o.y0);
+                auto half = static_cast<int>(
+                    std::sqrt(static_cast<double>(r2 - dy * dy)));
+                int x0 = std::max(o.x0 - half, r.x);
+                int x1 = std::min(o.x0 + half, r.x + r.w - 1);
+                if(x1 >= x0) {
+                    blend_fill(at(x0, y), o.draw_color, x1 - x0 + 1);
+                }
+            }
+            break;
+        }
+        case op_kind::circle: {
+            // Midpoint circle; points on the axes and diagonals are only
+            // plotted once so that translucent outlines have no dark dots.
+            auto plot4 = [&](int a, int b) {
+                plot(o.x0 + a, o.y0 + b);
+                if(a != 0) {
+                    plot(o.x0 - a, o.y0 + b);
+                }
+                if(b != 0) {
+                    plot(o.x0 + a, o.y0 - b);
+                }
+                if(a != 0 && b != 0) {
+                    plot(o.x0 - a, o.y0 - b);
+                }
+            };
+            int x   = o.x1;
+            int y   = 0;
+            int err = 1 - x;
+            while(x >= y) {
+                plot4(x, y);
+                if(x != y) {
+                    plot4(y, x);
+                }
+                ++y;
+                if(err < 0) {
+                    err += 2 * y + 1;
+                } else {
+                    --x;
+                    err += 2 * (y - x) + 1;
+                }
+            }
+            break;
+        }
+        case op_kind::blit: {
+            auto r       = intersect(o.bounds, clip);
+            auto src_row = [&o](int x, int y) {
+                return static_cast<uint8_t const *>(o.source->pixels) +
+                       (y - o.y0) * o.source->pitch +
+                       (x - o.x0) * bytes_per_pixel;
+            };
+            for(int y = r.y; y < r.y + r.h; ++y) {
+                blend_span(at(r.x, y), src_row(r.x, y), r.w);
+            }
+            break;
+        }
+        }
+    }
+}
+
+void software_rasterizer::flush() {
+    if(m_ops.empty()) {
+        return;
+    }
+    auto *s      = m_target->get_sdl_surface();
+    bool  locked = SDL_MUSTLOCK(s);
+    if(locked && SDL_LockSurface(s) < 0) {
+        throw std::runtime_error{
+            fmt::format("couldn't lock surface: {}", SDL_GetError())};
+    }
+    if(m_pool != nullptr) {
+        m_pool->parallel_for(m_bins.size(),
+                             [this](size_t tile) { rasterize(tile); });
+    } else {
+        for(size_t tile = 0; tile < m_bins.size(); ++tile) {
+            rasterize(tile);
+        }
+    }
+    if(locked) {
+        SDL_UnlockSurface(s);
+    }
+
+    for(auto &bin : m_bins) {
+        bin.clear();
+    }
+    m_ops.clear();
+    m_scratch.clear();
+}
+
+} // namespace gfx
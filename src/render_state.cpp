@@ -0,0 +1,114 @@
+#include <stdexcept>
+
+#include <fmt/core.h>
+
+#include "gfx/profiler.h"
+#include "gfx/render_state.h"
+
+namespace gfx {
+
+namespace {
+
+void check(int result, char const *what) {
+    if(result < 0) {
+        throw std::runtime_error{
+            fmt::format("couldn't {}: {}", what, SDL_GetError())};
+    }
+}
+
+auto same_rect(SDL_Rect const &a, SDL_Rect const &b) -> bool {
+    return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+}
+
+} // namespace
+
+render_state::render_state(SDL_Renderer *renderer) : m_renderer{renderer} {
+    sync();
+}
+
+void render_state::sync() {
+    check(SDL_GetRenderDrawColor(m_renderer, &m_color.r, &m_color.g,
+                                 &m_color.b, &m_color.a),
+          "get color");
+    check(SDL_GetRenderDrawBlendMode(m_renderer, &m_blend), "get blend mode");
+    m_target = SDL_GetRenderTarget(m_renderer);
+    read_clip();
+}
+
+void render_state::read_clip() {
+    if(SDL_RenderIsClipEnabled(m_renderer) == SDL_FALSE) {
+        m_clip.reset();
+        return;
+    }
+    SDL_Rect rect;
+    SDL_RenderGetClipRect(m_renderer, &rect);
+    m_clip = rect;
+}
+
+void render_state::skipped() {
+    ++m_stats.skipped;
+    GFX_PROFILE_COUNT(state_changes_skipped, 1);
+}
+
+void render_state::applied() {
+    ++m_stats.applied;
+    GFX_PROFILE_COUNT(state_changes, 1);
+}
+
+auto render_state::set_color(color const &c) -> bool {
+    if(c.packed() == m_color.packed()) {
+        skipped();
+        return false;
+    }
+    check(SDL_SetRenderDrawColor(m_renderer, c.r, c.g, c.b, c.a), "set color");
+    m_color = c;
+    applied();
+    return true;
+}
+
+auto render_state::set_blend_mode(SDL_BlendMode blend) -> bool {
+    if(blend == m_blend) {
+        skipped();
+        return false;
+    }
+    check(SDL_SetRenderDrawBlendMode(m_renderer, blend), "set blend mode");
+    m_blend = blend;
+    applied();
+    return true;
+}
+
+// A destroyed target leaves a dangling pointer here, which a texture
+// created since may share, so that setting it would be skipped.
+void render_state::read_target() const {
+    if(m_target != nullptr) {
+        m_target = SDL_GetRenderTarget(m_renderer);
+    }
+}
+
+auto render_state::set_target(SDL_Texture *target) -> bool {
+    read_target();
+    if(target == m_target) {
+        skipped();
+        return false;
+    }
+    check(SDL_SetRenderTarget(m_renderer, target), "set target");
+    m_target = target;
+    read_clip();
+    applied();
+    return true;
+}
+
+auto render_state::set_clip(std::optional<SDL_Rect> const &clip) -> bool {
+    if(clip.has_value() == m_clip.has_value() &&
+       (!clip || same_rect(*clip, *m_clip))) {
+        skipped();
+        return false;
+    }
+    check(SDL_RenderSetClipRect(m_renderer, clip ? &*clip : nullptr),
+          "set clip rect");
+    m_clip = clip;
+    applied();
+    return true;
+}
+
+} // namespace gfx
@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "gfx/gfx.h"
+
+namespace gfx {
+
+render_thread::render_thread(renderer &r, bool own_thread) : m_renderer{r} {
+    if(own_thread) {
+        m_thread = std::thread{[this] { run(); }};
+    }
+}
+
+render_thread::~render_thread() {
+    stop();
+    if(m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+// Expects m_mutex to be held.
+void render_thread::rethrow_error() {
+    if(m_error) {
+        std::rethrow_exception(m_error);
+    }
+}
+
+auto render_thread::begin_frame() -> render_frame & {
+    std::unique_lock lock{m_mutex};
+    auto free_slot = [this] {
+        return std::find(m_states.begin(), m_states.end(), slot_state::free);
+    };
+    if(free_slot() == m_states.end()) {
+        ++m_stats.recorder_stalls;
+    }
+    m_freed.wait(lock, [&] {
+        return m_error || m_stopping || free_slot() != m_states.end();
+    });
+    rethrow_error();
+    if(m_stopping) {
+        throw std::runtime_error{"render thread is stopped"};
+    }
+    auto slot      = static_cast<size_t>(free_slot() - m_states.begin());
+    m_states[slot] = slot_state::recording;
+    auto &frame    = m_frames[slot];
+    frame.m_index  = m_next_index++;
+    lock.unlock();
+
+    frame.m_clear.reset();
+    frame.m_commands.reset();
+    for(auto &list : frame.m_lists) {
+        list.reset();
+    }
+    return frame;
+}
+
+void render_thread::end_frame(render_frame &frame) {
+    auto slot = static_cast<size_t>(&frame - m_frames.data());
+    if(slot >= frame_count) {
+        throw std::runtime_error{"frame doesn't belong to this render thread"};
+    }
+    for(auto const &list : frame.m_lists) {
+        frame.m_commands.append(list);
+    }
+    {
+        std::scoped_lock lock{m_mutex};
+        rethrow_error();
+        if(m_states[slot] != slot_state::recording) {
+            throw std::runtime_error{"frame ended twice"};
+        }
+        m_states[slot] = slot_state::queued;
+        m_queue.push_back(slot);
+        ++m_stats.frames_recorded;
+    }
+    m_queued.notify_one();
+}
+
+void render_thread::replay(render_frame &frame) {
+    GFX_PROFILE_SCOPE("replay");
+    if(frame.m_clear) {
+        m_renderer.clear(*frame.m_clear);
+    }
+    m_renderer.submit(frame.m_commands);
+    m_renderer.present();
+}
+
+void render_thread::run() {
+    for(;;) {
+        size_t slot{};
+        {
+            std::unique_lock lock{m_mutex};
+            m_queued.wait(lock,
+                          [this] { return m_stopping || !m_queue.empty(); });
+            if(m_queue.empty()) {
+                return;
+            }
+            slot = m_queue.front();
+            m_queue.pop_front();
+            m_states[slot] = slot_state::replaying;
+        }
+
+        try {
+            replay(m_frames[slot]);
+        } catch(...) {
+            {
+                std::scoped_lock lock{m_mutex};
+                m_error    = std::current_exception();
+                m_stopping = true;
+                for(auto queued : m_queue) {
+                    m_states[queued] = slot_state::free;
+                }
+                m_queue.clear();
+                m_states[slot] = slot_state::free;
+            }
+            m_freed.notify_all();
+            return;
+        }
+
+        {
+            std::scoped_lock lock{m_mutex};
+            m_states[slot] = slot_state::free;
+            ++m_stats.frames_presented;
+        }
+        m_freed.notify_all();
+    }
+}
+
+void render_thread::stop() {
+    {
+        std::scoped_lock lock{m_mutex};
+        m_stopping = true;
+    }
+    m_queued.notify_all();
+    m_freed.notify_all();
+}
+
+void render_thread::wait_idle() {
+    std::unique_lock lock{m_mutex};
+    m_freed.wait(lock, [this] {
+        return m_error || std::none_of(m_states.begin(), m_states.end(),
+                                       [](slot_state s) {
+                                           return s == slot_state::queued ||
+                                                  s == slot_state::replaying;
+                                       });
+    });
+    rethrow_error();
+}
+
+auto render_thread::get_stats() const -> render_thread_stats {
+    std::scoped_lock lock{m_mutex};
+    return m_stats;
+}
+
+} // namespace gfx
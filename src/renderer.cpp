@@ -17,4 +17,64 @@ namespace gfx {
     return window_position / zoom + view.position;
 }
 
+void world_to_window(std::span<vec2d_t<double> const> world_positions,
+                     std::span<vec2d_t<double>>       window_positions,
+                     rect_t<double> view, double window_width) {
+    camera{view, window_width}.world_to_window(world_positions,
+                                               window_positions);
+}
+
+void world_to_window(std::span<vec2d_t<float> const> world_positions,
+                     std::span<vec2d_t<float>>       window_positions,
+                     rect_t<double> view, double window_width) {
+    camera{view, window_width}.world_to_window(world_positions,
+                                               window_positions);
+}
+
+void world_to_window(std::span<double const> world_x,
+                     std::span<double const> world_y,
+                     std::span<double> window_x, std::span<double> window_y,
+                     rect_t<double> view, double window_width) {
+    camera{view, window_width}.world_to_window(world_x, world_y, window_x,
+                                               window_y);
+}
+
+void world_to_window(std::span<float const> world_x,
+                     std::span<float const> world_y, std::span<float> window_x,
+                     std::span<float> window_y, rect_t<double> view,
+                     double window_width) {
+    camera{view, window_width}.world_to_window(world_x, world_y, window_x,
+                                               window_y);
+}
+
+void window_to_world(std::span<vec2d_t<double> const> window_positions,
+                     std::span<vec2d_t<double>>       world_positions,
+                     rect_t<double> view, double window_width) {
+    camera{view, window_width}.window_to_world(window_positions,
+                                               world_positions);
+}
+
+void window_to_world(std::span<vec2d_t<float> const> window_positions,
+                     std::span<vec2d_t<float>>       world_positions,
+                     rect_t<double> view, double window_width) {
+    camera{view, window_width}.window_to_world(window_positions,
+                                               world_positions);
+}
+
+void window_to_world(std::span<double const> window_x,
+                     std::span<double const> window_y,
+                     std::span<double> world_x, std::span<double> world_y,
+                     rect_t<double> view, double window_width) {
+    camera{view, window_width}.window_to_world(window_x, window_y, world_x,
+                                               world_y);
+}
+
+void window_to_world(std::span<float const> window_x,
+                     std::span<float const> window_y, std::span<float> world_x,
+                     std::span<float> world_y, rect_t<double> view,
+                     double window_width) {
+    camera{view, window_width}.window_to_world(window_x, window_y, world_x,
+                                               world_y);
+}
+
 } // namespace gfx
@@ -0,0 +1,205 @@
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "gfx/gfx.h"
+
+namespace gfx {
+
+#if defined(_WIN32)
+
+mapped_file::mapped_file(std::string const &path) {
+    auto *file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                             nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                             nullptr);
+    if(file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error{
+            fmt::format("couldn't open {}: error {}", path, GetLastError())};
+    }
+    LARGE_INTEGER size{};
+    if(GetFileSizeEx(file, &size) == 0) {
+        auto error = GetLastError();
+        CloseHandle(file);
+        throw std::runtime_error{
+            fmt::format("couldn't get size of {}: error {}", path, error)};
+    }
+    m_size = static_cast<size_t>(size.QuadPart);
+    if(m_size > 0) {
+        // The view keeps the mapping alive, so neither handle is needed
+        // afterwards.
+        auto *mapping =
+            CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        auto error = GetLastError();
+        if(mapping != nullptr) {
+            m_data = static_cast<std::byte const *>(
+                MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            error  = GetLastError();
+            CloseHandle(mapping);
+        }
+        if(m_data == nullptr) {
+            CloseHandle(file);
+            throw std::runtime_error{
+                fmt::format("couldn't map {}: error {}", path, error)};
+        }
+    }
+    CloseHandle(file);
+}
+
+mapped_file::~mapped_file() {
+    if(m_data != nullptr) {
+        UnmapViewOfFile(m_data);
+    }
+}
+
+#else
+
+mapped_file::mapped_file(std::string const &path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        throw std::runtime_error{
+            fmt::format("couldn't open {}: {}", path, std::strerror(errno))};
+    }
+    struct stat info {};
+    if(fstat(fd, &info) < 0) {
+        auto error = errno;
+        close(fd);
+        throw std::runtime_error{fmt::format("couldn't get size of {}: {}",
+                                             path, std::strerror(error))};
+    }
+    m_size = static_cast<size_t>(info.st_size);
+    if(m_size > 0) {
+        void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data == MAP_FAILED) {
+            auto error = errno;
+            close(fd);
+            throw std::runtime_error{fmt::format("couldn't map {}: {}", path,
+                                                 std::strerror(error))};
+        }
+        m_data = static_cast<std::byte const *>(data);
+    }
+    close(fd);
+}
+
+mapped_file::~mapped_file() {
+    if(m_data != nullptr) {
+        munmap(const_cast<std::byte *>(m_data), m_size);
+    }
+}
+
+#endif
+
+font::font(std::shared_ptr<mapped_file const> source, int size, int style)
+    : m_source{std::move(source)} {
+    std::lock_guard lock{ttf_mutex()};
+    auto *rw = SDL_RWFromConstMem(m_source->data().data(),
+                                  static_cast<int>(m_source->size()));
+    m_font   = TTF_OpenFontRW(rw, 1, size);
+    if(m_font == nullptr) {
+        throw std::runtime_error{
+            fmt::format("error opening font: {}", TTF_GetError())};
+    }
+    TTF_SetFontStyle(m_font, style);
+}
+
+auto resource_registry::font_key_hasher::operator()(font_key const &k) const
+    -> size_t {
+    size_t h = std::hash<std::string>{}(k.path);
+    for(auto v : {k.size, k.style}) {
+        h ^= std::hash<int>{}(v) + 0x9E3779B97F4A7C15ULL + (h << 6U) +
+             (h >> 2U);
+    }
+    return h;
+}
+
+auto resource_registry::map_locked(std::string const &path)
+    -> std::shared_ptr<mapped_file const> {
+    auto &file = m_files[path];
+    if(!file) {
+        try {
+            file = std::make_shared<mapped_file const>(path);
+        } catch(...) {
+            m_files.erase(path);
+            throw;
+        }
+        ++m_stats.files_mapped;
+        m_stats.bytes_mapped += file->size();
+    }
+    return file;
+}
+
+auto resource_registry::map(std::string const &path)
+    -> std::shared_ptr<mapped_file const> {
+    std::scoped_lock lock{m_mutex};
+    return map_locked(path);
+}
+
+auto resource_registry::get_font(std::string const &path, int size,
+                                 int style) -> std::shared_ptr<font> {
+    // Held while opening too: SDL_ttf shares one FreeType library between
+    // all fonts, which isn't safe to open faces from concurrently.
+    std::scoped_lock lock{m_mutex};
+    auto            &cached = m_fonts[{path, size, style}];
+    if(auto existing = cached.lock()) {
+        ++m_stats.font_hits;
+        return existing;
+    }
+    auto opened = std::make_shared<font>(map_locked(path), size, style);
+    cached      = opened;
+    ++m_stats.fonts_opened;
+    return opened;
+}
+
+auto resource_registry::load_surface(std::string const &path)
+    -> std::shared_ptr<surface> {
+    std::shared_ptr<mapped_file const> file;
+    {
+        std::scoped_lock lock{m_mutex};
+        if(auto it = m_files.find(path); it != m_files.end()) {
+            file = it->second;
+        }
+    }
+    if(!file) {
+        file = std::make_shared<mapped_file const>(path);
+        std::scoped_lock lock{m_mutex};
+        ++m_stats.files_mapped;
+        m_stats.bytes_mapped += file->size();
+    }
+    auto type = std::filesystem::path{path}.extension().string();
+    try {
+        return std::make_shared<surface>(
+            file->data(), type.empty() ? nullptr : type.c_str() + 1);
+    } catch(std::runtime_error const &e) {
+        throw std::runtime_error{
+            fmt::format("couldn't load {}: {}", path, e.what())};
+    }
+}
+
+void resource_registry::trim() {
+    std::scoped_lock lock{m_mutex};
+    std::erase_if(m_fonts, [](auto const &f) { return f.second.expired(); });
+    std::erase_if(m_files,
+                  [](auto const &f) { return f.second.use_count() == 1; });
+}
+
+auto resource_registry::get_stats() const -> resource_stats {
+    std::scoped_lock lock{m_mutex};
+    return m_stats;
+}
+
+auto resource_registry::shared() -> resource_registry & {
+    static resource_registry registry;
+    return registry;
+}
+
+} // namespace gfx
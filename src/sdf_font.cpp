@@ -0,0 +1,547 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <stdexcept>
+
+#include "gfx/gfx.h"
+
+namespace gfx {
+
+namespace {
+
+constexpr double far_away         = 1e20;
+constexpr int    glyph_padding    = 1;
+constexpr int    steps_per_octave = 4;
+constexpr int    min_step         = -4 * steps_per_octave;
+
+// Squared distance transform of one row or column in place (Felzenszwalb &
+// Huttenlocher): each sample becomes the smallest f[r] + (q - r)^2.
+void transform_1d(double *grid, size_t stride, size_t n,
+                  std::vector<double> &f, std::vector<size_t> &v,
+                  std::vector<double> &z) {
+    f.resize(n);
+    v.resize(n);
+    z.resize(n + 1);
+    for(size_t q = 0; q < n; ++q) {
+        f[q] = grid[q * stride];
+    }
+    auto parabola = [&f](size_t q, size_t r) {
+        auto dq = static_cast<double>(q);
+        auto dr = static_cast<double>(r);
+        return (f[q] + dq * dq - f[r] - dr * dr) / (2 * (dq - dr));
+    };
+
+    size_t k = 0;
+    v[0]     = 0;
+    z[0]     = -far_away;
+    z[1]     = far_away;
+    for(size_t q = 1; q < n; ++q) {
+        // z[0] is below any intersection, so k never runs past the start.
+        auto s = parabola(q, v[k]);
+        while(s <= z[k]) {
+            --k;
+            s = parabola(q, v[k]);
+        }
+        ++k;
+        v[k]     = q;
+        z[k]     = s;
+        z[k + 1] = far_away;
+    }
+
+    k = 0;
+    for(size_t q = 0; q < n; ++q) {
+        while(z[k + 1] < static_cast<double>(q)) {
+            ++k;
+        }
+        auto d           = static_cast<double>(q) - static_cast<double>(v[k]);
+        grid[q * stride] = f[v[k]] + d * d;
+    }
+}
+
+void transform_2d(std::vector<double> &grid, size_t width, size_t height) {
+    std::vector<double> f;
+    std::vector<size_t> v;
+    std::vector<double> z;
+    for(size_t x = 0; x < width; ++x) {
+        transform_1d(grid.data() + x, width, height, f, v, z);
+    }
+    for(size_t y = 0; y < height; ++y) {
+        transform_1d(grid.data() + y * width, 1, width, f, v, z);
+    }
+}
+
+auto coverage(float distance) -> float {
+    return std::clamp(distance + 0.5F, 0.0F, 1.0F);
+}
+
+auto scale_step(double scale) -> int {
+    return std::max(min_step,
+                    static_cast<int>(std::lround(std::log2(scale) *
+                                                 steps_per_octave)));
+}
+
+auto step_scale(int step) -> float {
+    return std::exp2(static_cast<float>(step) / steps_per_octave);
+}
+
+// Exact, since a bucket is only reused for the very same style.
+auto same_style(text_style const &a, text_style const &b) -> bool {
+    auto bits = [](float f) { return std::bit_cast<uint32_t>(f); };
+    return a.fill.packed() == b.fill.packed() &&
+           a.outline.packed() == b.outline.packed() &&
+           a.glow.packed() == b.glow.packed() &&
+           bits(a.outline_width) == bits(b.outline_width) &&
+           bits(a.glow_radius) == bits(b.glow_radius);
+}
+
+} // namespace
+
+auto signed_distance_field(std::span<uint8_t const> alpha, int width,
+                           int height, int spread) -> std::vector<uint8_t> {
+    auto const w = static_cast<size_t>(width);
+    auto const h = static_cast<size_t>(height);
+    if(alpha.size() != w * h || spread <= 0) {
+        throw std::runtime_error{"invalid distance field source"};
+    }
+
+    // Partly covered pixels start at their estimated distance to the edge
+    // instead of 0, which keeps antialiased edges from snapping to pixels.
+    std::vector<double> outside(w * h);
+    std::vector<double> inside(w * h);
+    for(size_t i = 0; i < alpha.size(); ++i) {
+        auto a = static_cast<double>(alpha[i]) / 255;
+        if(alpha[i] == 255) {
+            outside[i] = 0;
+            inside[i]  = far_away;
+        } else if(alpha[i] == 0) {
+            outside[i] = far_away;
+            inside[i]  = 0;
+        } else {
+            outside[i] = std::pow(std::max(0.0, 0.5 - a), 2);
+            inside[i]  = std::pow(std::max(0.0, a - 0.5), 2);
+        }
+    }
+    transform_2d(outside, w, h);
+    transform_2d(inside, w, h);
+
+    std::vector<uint8_t> field(w * h);
+    auto const           scale = 127.0 / spread;
+    for(size_t i = 0; i < field.size(); ++i) {
+        auto d   = std::sqrt(inside[i]) - std::sqrt(outside[i]);
+        field[i] = static_cast<uint8_t>(
+            std::clamp(std::lround(128 + d * scale), 0L, 255L));
+    }
+    return field;
+}
+
+sdf_font::sdf_font(font &source, int spread, int page_size, size_t max_pages)
+    : m_font{source.get_ttf_font()}, m_spread{spread}, m_page_size{page_size},
+      m_max_pages{max_pages}, m_height{TTF_FontHeight(m_font)},
+      m_line_skip{TTF_FontLineSkip(m_font)} {
+    if(spread <= 0 || page_size <= 0 || max_pages == 0) {
+        throw std::runtime_error{"sdf font sizes must be positive"};
+    }
+}
+
+auto sdf_font::get_field(uint32_t codepoint) -> field_glyph const & {
+    if(auto it = m_fields.find(codepoint); it != m_fields.end()) {
+        return it->second;
+    }
+
+    int minx{};
+    int maxx{};
+    int miny{};
+    int maxy{};
+    int advance{};
+    if(TTF_GlyphMetrics32(m_font, codepoint, &minx, &maxx, &miny, &maxy,
+                          &advance) < 0) {
+        throw std::runtime_error{
+            fmt::format("couldn't get glyph metrics: {}", TTF_GetError())};
+    }
+
+    field_glyph g{{}, 0, 0, glyph_surface_offset(minx), advance};
+    if(maxx > minx) {
+        surface rendered{TTF_RenderGlyph32_Blended(
+            m_font, codepoint, color_white.get_sdl_color())};
+        if(rendered.get_sdl_surface() == nullptr) {
+            throw std::runtime_error{
+                fmt::format("couldn't render glyph: {}", TTF_GetError())};
+        }
+        GFX_PROFILE_COUNT(text_rasterizations, 1);
+        surface rgba{SDL_ConvertSurfaceFormat(rendered.get_sdl_surface(),
+                                              SDL_PIXELFORMAT_RGBA32, 0)};
+        auto   *pixels = rgba.get_sdl_surface();
+        if(pixels == nullptr) {
+            throw std::runtime_error{
+                fmt::format("couldn't convert glyph: {}", SDL_GetError())};
+        }
+
+        // Padded so the field has room to fall off around the glyph.
+        g.width  = pixels->w + 2 * m_spread;
+        g.height = pixels->h + 2 * m_spread;
+        std::vector<uint8_t> alpha(static_cast<size_t>(g.width) *
+                                   static_cast<size_t>(g.height));
+        auto const          *src = static_cast<uint8_t const *>(pixels->pixels);
+        for(int y = 0; y < pixels->h; ++y) {
+            auto const *row = src + y * pixels->pitch;
+            auto       *out = alpha.data() + (y + m_spread) * g.width;
+            for(int x = 0; x < pixels->w; ++x) {
+                out[m_spread + x] = row[x * 4 + 3];
+            }
+        }
+        g.field = signed_distance_field(alpha, g.width, g.height, m_spread);
+    }
+    return m_fields.emplace(codepoint, std::move(g)).first->second;
+}
+
+auto sdf_font::get_bucket(int step, text_style const &style) -> bucket & {
+    for(auto &b : m_buckets) {
+        if(b.step == step && same_style(b.style, style)) {
+            b.last_used = m_draws;
+            return b;
+        }
+    }
+    return m_buckets.emplace_back(bucket{step, style, {}, {}, m_draws});
+}
+
+// Steps down from step until the largest glyph laid out fits a page.
+auto sdf_font::fitting_step(int step) const -> int {
+    int largest = 0;
+    for(auto const &p : m_placements) {
+        auto const &g = m_fields.at(p.codepoint);
+        largest       = std::max({largest, g.width, g.height});
+    }
+    auto fits = [&](int s) {
+        auto scaled = std::ceil(static_cast<float>(largest) * step_scale(s));
+        return static_cast<int>(scaled) + 2 * glyph_padding <= m_page_size;
+    };
+    while(step > min_step && !fits(step)) {
+        --step;
+    }
+    return step;
+}
+
+auto sdf_font::add_page(renderer &r, bucket const &owner) -> uint32_t {
+    if(m_free_pages.empty() && m_pages.size() >= m_max_pages) {
+        auto lru = m_buckets.end();
+        for(auto it = m_buckets.begin(); it != m_buckets.end(); ++it) {
+            if(&*it != &owner && !it->pages.empty() &&
+               (lru == m_buckets.end() || it->last_used < lru->last_used)) {
+                lru = it;
+            }
+        }
+        if(lru != m_buckets.end()) {
+            for(auto page : lru->pages) {
+                m_packers[page].reset();
+                m_free_pages.push_back(page);
+            }
+            m_buckets.erase(lru);
+        }
+    }
+    if(!m_free_pages.empty()) {
+        // Draws recorded earlier in the frame may still sample the page's
+        // old glyphs, so they have to go out before it is overwritten.
+        r.flush();
+        auto page = m_free_pages.back();
+        m_free_pages.pop_back();
+        return page;
+    }
+    // Past the budget only when the bucket being drawn needs every page.
+    m_pages.emplace_back(m_sdl_renderer, m_page_size, m_page_size,
+                         SDL_TEXTUREACCESS_STATIC);
+    m_packers.emplace_back(m_page_size, m_page_size);
+    return static_cast<uint32_t>(m_pages.size() - 1);
+}
+
+auto sdf_font::allocate(renderer &r, bucket &b, int width, int height)
+    -> std::pair<uint32_t, SDL_Point> {
+    if(width > m_page_size || height > m_page_size) {
+        throw std::runtime_error{"glyph doesn't fit in atlas page"};
+    }
+    for(auto page : b.pages) {
+        if(auto p = m_packers[page].insert(width, height)) {
+            return {page, *p};
+        }
+    }
+    auto page = add_page(r, b);
+    b.pages.push_back(page);
+    return {page, *m_packers[page].insert(width, height)};
+}
+
+auto sdf_font::place(renderer &r, bucket &b, uint32_t codepoint)
+    -> placed_glyph const & {
+    if(auto it = b.glyphs.find(codepoint); it != b.glyphs.end()) {
+        return it->second;
+    }
+    auto const &g = get_field(codepoint);
+    if(g.field.empty()) {
+        return b.glyphs.emplace(codepoint, placed_glyph{}).first->second;
+    }
+
+    // Every output pixel samples the field at its center and turns the
+    // distance, now in output pixels, into layered fill, outline and glow.
+    auto const scale  = step_scale(b.step);
+    auto const w      = std::max(1, static_cast<int>(std::ceil(
+                                        static_cast<float>(g.width) * scale)));
+    auto const h      = std::max(1, static_cast<int>(std::ceil(
+                                        static_cast<float>(g.height) * scale)));
+    auto const to_out = static_cast<float>(m_spread) * scale / 127.0F;
+    auto const sample = [&g](float x, float y) {
+        x       = std::clamp(x, 0.0F, static_cast<float>(g.width - 1));
+        y       = std::clamp(y, 0.0F, static_cast<float>(g.height - 1));
+        auto x0 = static_cast<int>(x);
+        auto y0 = static_cast<int>(y);
+        auto x1 = std::min(x0 + 1, g.width - 1);
+        auto y1 = std::min(y0 + 1, g.height - 1);
+        auto fx = x - static_cast<float>(x0);
+        auto fy = y - static_cast<float>(y0);
+        auto at = [&g](int px, int py) {
+            return static_cast<float>(
+                g.field[static_cast<size_t>(py * g.width + px)]);
+        };
+        auto top    = at(x0, y0) + (at(x1, y0) - at(x0, y0)) * fx;
+        auto bottom = at(x0, y1) + (at(x1, y1) - at(x0, y1)) * fx;
+        return top + (bottom - top) * fy - 128;
+    };
+
+    struct rgba {
+        float r, g, b, a;
+    };
+    auto const to_layer = [](color c) {
+        return rgba{static_cast<float>(c.r), static_cast<float>(c.g),
+                     static_cast<float>(c.b), static_cast<float>(c.a) / 255};
+    };
+    auto const &style   = b.style;
+    auto const  fill    = to_layer(style.fill);
+    auto const  outline = to_layer(style.outline);
+    auto const  glow    = to_layer(style.glow);
+    auto const  reach   = static_cast<float>(m_spread) * scale;
+    auto const  width   = std::min(style.outline_width, reach);
+    auto const  radius  = std::min(style.glow_radius, reach);
+
+    // Uploaded with a transparent border, so filtering at the glyph's edges
+    // reads neither its neighbours nor what an evicted bucket left behind.
+    auto const           pitch = w + 2 * glyph_padding;
+    std::vector<uint8_t> pixels(static_cast<size_t>(pitch) *
+                                static_cast<size_t>(h + 2 * glyph_padding) *
+                                4);
+    for(int y = 0; y < h; ++y) {
+        for(int x = 0; x < w; ++x) {
+            auto d = sample((static_cast<float>(x) + 0.5F) / scale - 0.5F,
+                            (static_cast<float>(y) + 0.5F) / scale - 0.5F) *
+                     to_out;
+            // Premultiplied, composited bottom to top.
+            rgba out{0, 0, 0, 0};
+            auto over = [&out](rgba const &c, float a) {
+                a     *= c.a;
+                out.r = c.r * a + out.r * (1 - a);
+                out.g = c.g * a + out.g * (1 - a);
+                out.b = c.b * a + out.b * (1 - a);
+                out.a = a + out.a * (1 - a);
+            };
+            if(radius > 0) {
+                auto t = std::clamp(1 + d / radius, 0.0F, 1.0F);
+                over(glow, t * t);
+            }
+            if(width > 0) {
+                over(outline, coverage(d + width));
+            }
+            over(fill, coverage(d));
+
+            auto *p = &pixels[static_cast<size_t>(
+                ((y + glyph_padding) * pitch + x + glyph_padding) * 4)];
+            if(out.a > 0) {
+                p[0] = static_cast<uint8_t>(std::min(255.0F, out.r / out.a));
+                p[1] = static_cast<uint8_t>(std::min(255.0F, out.g / out.a));
+                p[2] = static_cast<uint8_t>(std::min(255.0F, out.b / out.a));
+                p[3] = static_cast<uint8_t>(std::lround(out.a * 255));
+            }
+        }
+    }
+
+    auto [page, at] = allocate(r, b, pitch, h + 2 * glyph_padding);
+    SDL_Rect padded{at.x, at.y, pitch, h + 2 * glyph_padding};
+    if(SDL_UpdateTexture(m_pages[page].get_sdl_texture(), &padded,
+                         pixels.data(), pitch * 4) < 0) {
+        throw std::runtime_error{
+            fmt::format("couldn't upload glyph: {}", SDL_GetError())};
+    }
+    GFX_PROFILE_COUNT(texture_uploads, 1);
+    GFX_PROFILE_COUNT(bytes_uploaded, pixels.size());
+    placed_glyph placed{
+        page, {at.x + glyph_padding, at.y + glyph_padding, w, h}};
+    return b.glyphs.emplace(codepoint, placed).first->second;
+}
+
+auto sdf_font::layout(std::string_view text, int wrap_width) -> vec2d_t<int> {
+    m_codepoints.clear();
+    for(size_t pos = 0; pos < text.size();) {
+        m_codepoints.push_back(decode_utf8(text, pos));
+    }
+    m_placements.clear();
+
+    auto kerning = [this](uint32_t prev, uint32_t cp) {
+        return prev == 0 ? 0 : TTF_GetFontKerningSizeGlyphs32(m_font, prev, cp);
+    };
+    auto const count = m_codepoints.size();
+    int        y     = 0;
+    int        width = 0;
+
+    for(size_t line_start = 0;;) {
+        size_t   line_end   = count;
+        size_t   next_start = count + 1;
+        size_t   last_space = line_start;
+        int      x          = 0;
+        uint32_t prev       = 0;
+        for(size_t i = line_start; i < count; ++i) {
+            auto cp = m_codepoints[i];
+            if(cp == '\n') {
+                line_end   = i;
+                next_start = i + 1;
+                break;
+            }
+            if(cp == ' ') {
+                last_space = i;
+            }
+            int next = x + kerning(prev, cp) + get_field(cp).advance;
+            if(wrap_width > 0 && next > wrap_width && i > line_start) {
+                line_end   = last_space > line_start ? last_space : i;
+                next_start = last_space > line_start ? last_space + 1 : i;
+                break;
+            }
+            x    = next;
+            prev = cp;
+        }
+
+        x    = 0;
+        prev = 0;
+        for(size_t i = line_start; i < line_end; ++i) {
+            auto        cp = m_codepoints[i];
+            auto const &g  = get_field(cp);
+            x              += kerning(prev, cp);
+            if(!g.field.empty()) {
+                m_placements.push_back(
+                    {cp, x + g.offset_x - m_spread, y - m_spread});
+            }
+            x    += g.advance;
+            prev = cp;
+        }
+        width = std::max(width, x);
+        y     += m_line_skip;
+
+        if(next_start > count) {
+            break;
+        }
+        line_start = next_start;
+    }
+    return {width, y};
+}
+
+void sdf_font::draw(renderer &r, std::string_view text,
+                    vec2d_t<double> position, double size,
+                    text_style const &style, uint32_t wrap_width) {
+    if(size <= 0) {
+        return;
+    }
+    GFX_PROFILE_SCOPE("sdf_font");
+    if(m_sdl_renderer != r.get_sdl_renderer()) {
+        release_textures();
+        m_sdl_renderer = r.get_sdl_renderer();
+    }
+    ++m_draws;
+
+    auto const scale = size / m_height;
+    layout(text, wrap_width == 0 ? 0
+                                 : static_cast<int>(std::floor(
+                                       static_cast<double>(wrap_width) /
+                                       scale)));
+    // Stretched up from the largest step that fits, past that.
+    auto &b = get_bucket(fitting_step(scale_step(scale)), style);
+    // Glyphs are placed before building any mesh, since placing one may add
+    // a page.
+    for(auto const &p : m_placements) {
+        static_cast<void>(place(r, b, p.codepoint));
+    }
+
+    m_meshes.resize(m_pages.size());
+    for(auto &mesh : m_meshes) {
+        mesh.vertices.clear();
+        mesh.indices.clear();
+    }
+    auto const s        = static_cast<float>(scale);
+    auto const stretch  = s / step_scale(b.step);
+    auto const to_uv    = 1.0F / static_cast<float>(m_page_size);
+    auto const white    = color_white.get_sdl_color();
+    auto const origin_x = static_cast<float>(position.x);
+    auto const origin_y = static_cast<float>(position.y);
+    for(auto const &p : m_placements) {
+        auto const &g    = b.glyphs.at(p.codepoint);
+        auto       &mesh = m_meshes[g.page];
+        auto        base = static_cast<int>(mesh.vertices.size());
+
+        float x0 = origin_x + static_cast<float>(p.x) * s;
+        float y0 = origin_y + static_cast<float>(p.y) * s;
+        float x1 = x0 + static_cast<float>(g.source.w) * stretch;
+        float y1 = y0 + static_cast<float>(g.source.h) * stretch;
+        float u0 = static_cast<float>(g.source.x) * to_uv;
+        float v0 = static_cast<float>(g.source.y) * to_uv;
+        float u1 = static_cast<float>(g.source.x + g.source.w) * to_uv;
+        float v1 = static_cast<float>(g.source.y + g.source.h) * to_uv;
+
+        mesh.vertices.push_back({{x0, y0}, white, {u0, v0}});
+        mesh.vertices.push_back({{x1, y0}, white, {u1, v0}});
+        mesh.vertices.push_back({{x0, y1}, white, {u0, v1}});
+        mesh.vertices.push_back({{x1, y1}, white, {u1, v1}});
+        for(int i : {0, 1, 2, 2, 1, 3}) {
+            mesh.indices.push_back(base + i);
+        }
+    }
+
+    for(size_t page = 0; page < m_meshes.size(); ++page) {
+        auto const &mesh = m_meshes[page];
+        if(!mesh.indices.empty()) {
+            r.draw_geometry(mesh.vertices, mesh.indices,
+                            m_pages[page].get_sdl_texture());
+        }
+    }
+}
+
+void sdf_font::draw(renderer &r, std::string_view text,
+                    vec2d_t<double> position, double size, rect_t<double> view,
+                    text_style const &style, uint32_t wrap_width) {
+    auto const window_width = static_cast<double>(r.get_window_size().x);
+    auto const zoom         = window_width / view.size.x;
+    draw(r, text, world_to_window(position, view, window_width), size * zoom,
+         style,
+         static_cast<uint32_t>(static_cast<double>(wrap_width) * zoom));
+}
+
+auto sdf_font::measure(std::string_view text, double size,
+                       uint32_t wrap_width) -> vec2d_t<double> {
+    auto const scale = size / m_height;
+    auto const extent =
+        layout(text, wrap_width == 0 ? 0
+                                     : static_cast<int>(std::floor(
+                                           static_cast<double>(wrap_width) /
+                                           scale)));
+    return {extent.x * scale, extent.y * scale};
+}
+
+void sdf_font::clear_cache() {
+    m_buckets.clear();
+    m_free_pages.clear();
+    for(size_t page = 0; page < m_packers.size(); ++page) {
+        m_packers[page].reset();
+        m_free_pages.push_back(static_cast<uint32_t>(page));
+    }
+}
+
+void sdf_font::release_textures() {
+    m_buckets.clear();
+    m_pages.clear();
+    m_packers.clear();
+    m_free_pages.clear();
+    m_sdl_renderer = nullptr;
+}
+
+} // namespace gfx
@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <array>
+
+#include "gfx/gfx.h"
+
+namespace gfx {
+
+void sprite_batch::submit(renderer &r) {
+    m_order.resize(m_sprites.size());
+    for(uint32_t i = 0; i < m_order.size(); ++i) {
+        m_order[i] = i;
+    }
+    std::stable_sort(m_order.begin(), m_order.end(),
+                     [this](uint32_t a, uint32_t b) {
+                         return m_sprites[a].layer < m_sprites[b].layer;
+                     });
+
+    auto const window_width = r.get_window_size().x;
+    auto const zoom         = m_resize ? window_width / m_view.size.x : 1.0;
+
+    for(size_t begin = 0; begin < m_order.size();) {
+        auto const *source = m_sprites[m_order[begin]].region.source;
+        auto const  u_scale = 1.0F / static_cast<float>(source->width());
+        auto const  v_scale = 1.0F / static_cast<float>(source->height());
+
+        m_vertices.clear();
+        m_indices.clear();
+        size_t end = begin;
+        for(; end < m_order.size() &&
+              m_sprites[m_order[end]].region.source == source;
+            ++end) {
+            auto const &s      = m_sprites[m_order[end]];
+            auto const &bounds = s.region.bounds;
+
+            auto pivot = world_to_window(s.position, m_view, window_width);
+            auto c     = s.center * zoom;
+            auto w     = bounds.w * zoom;
+            auto h     = bounds.h * zoom;
+            auto angle = deg_to_rad(s.angle);
+            auto cos_a = std::cos(angle);
+            auto sin_a = std::sin(angle);
+
+            float u0 = static_cast<float>(bounds.x) * u_scale;
+            float v0 = static_cast<float>(bounds.y) * v_scale;
+            float u1 = static_cast<float>(bounds.x + bounds.w) * u_scale;
+            float v1 = static_cast<float>(bounds.y + bounds.h) * v_scale;
+
+            std::array<vec2d_t<double>, 4> corners{
+                vec2d_t<double>{-c.x, -c.y}, vec2d_t<double>{w - c.x, -c.y},
+                vec2d_t<double>{-c.x, h - c.y},
+                vec2d_t<double>{w - c.x, h - c.y}};
+            std::array<SDL_FPoint, 4> uvs{
+                {{u0, v0}, {u1, v0}, {u0, v1}, {u1, v1}}};
+
+            auto base      = static_cast<int>(m_vertices.size());
+            auto sdl_color = s.tint.get_sdl_color();
+            for(size_t i = 0; i < corners.size(); ++i) {
+                auto const &k = corners[i];
+                m_vertices.push_back(
+                    {{static_cast<float>(pivot.x + k.x * cos_a - k.y * sin_a),
+                      static_cast<float>(pivot.y + k.x * sin_a + k.y * cos_a)},
+                     sdl_color,
+                     uvs[i]});
+            }
+            for(int i : {0, 1, 2, 2, 1, 3}) {
+                m_indices.push_back(base + i);
+            }
+        }
+
+        r.draw_geometry(m_vertices, m_indices, source->get_sdl_texture());
+        begin = end;
+    }
+}
+
+} // namespace gfx
@@ -0,0 +1,64 @@
+#include "gfx/gfx.h"
+
+namespace gfx {
+
+streaming_texture::streaming_texture(SDL_Renderer *renderer, int width,
+                                     int height, size_t buffers) {
+    if(buffers < 2) {
+        throw std::runtime_error{"streaming texture needs at least 2 buffers"};
+    }
+    m_buffers.reserve(buffers);
+    for(size_t i = 0; i < buffers; ++i) {
+        m_buffers.emplace_back(renderer, width, height,
+                               SDL_TEXTUREACCESS_STREAMING);
+    }
+}
+
+auto streaming_texture::lock() -> locked_pixels {
+    auto const &b = back();
+    return lock({0, 0, b.width(), b.height()});
+}
+
+auto streaming_texture::lock(SDL_Rect const &area) -> locked_pixels {
+    if(m_locked) {
+        throw std::runtime_error{"streaming texture is already locked"};
+    }
+    void *pixels{};
+    int   pitch{};
+    if(SDL_LockTexture(back().get_sdl_texture(), &area, &pixels, &pitch) < 0) {
+        throw std::runtime_error{
+            fmt::format("couldn't lock texture: {}", SDL_GetError())};
+    }
+    m_locked = true;
+    GFX_PROFILE_COUNT(texture_uploads, 1);
+    GFX_PROFILE_COUNT(bytes_uploaded, area.w * bits_per_pixel / 8 * area.h);
+    return {static_cast<std::byte *>(pixels), pitch, area.w, area.h};
+}
+
+void streaming_texture::unlock() {
+    if(m_locked) {
+        SDL_UnlockTexture(back().get_sdl_texture());
+        m_locked = false;
+    }
+}
+
+void streaming_texture::update(void const *pixels, int pitch,
+                               SDL_Rect const *area) {
+    if(m_locked) {
+        throw std::runtime_error{"streaming texture is locked"};
+    }
+    if(SDL_UpdateTexture(back().get_sdl_texture(), area, pixels, pitch) < 0) {
+        throw std::runtime_error{
+            fmt::format("couldn't update texture: {}", SDL_GetError())};
+    }
+    GFX_PROFILE_COUNT(texture_uploads, 1);
+    GFX_PROFILE_COUNT(bytes_uploaded,
+                      pitch * (area != nullptr ? area->h : back().height()));
+}
+
+void streaming_texture::swap() {
+    unlock();
+    m_front = back_index();
+}
+
+} // namespace gfx
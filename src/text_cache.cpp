@@ -0,0 +1,71 @@
+#include "gfx/gfx.h"
+
+namespace gfx {
+
+auto text_cache::key_hasher::operator()(key const &k) const -> size_t {
+    size_t h = std::hash<std::string_view>{}(k.text);
+    for(uint64_t v : {k.font_id, uint64_t{k.color}, uint64_t{k.wrap_width}}) {
+        h ^= std::hash<uint64_t>{}(v) + 0x9E3779B97F4A7C15ULL + (h << 6U) +
+             (h >> 2U);
+    }
+    return h;
+}
+
+auto text_cache::find(key const &k) -> std::shared_ptr<texture> {
+    auto it = m_index.find(k);
+    if(it == m_index.end()) {
+        ++m_stats.misses;
+        return nullptr;
+    }
+    ++m_stats.hits;
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return it->second->tex;
+}
+
+auto text_cache::insert(key const &k, std::shared_ptr<texture> tex)
+    -> std::shared_ptr<texture> {
+    if(auto it = m_index.find(k); it != m_index.end()) {
+        m_stats.bytes -= it->second->bytes;
+        m_entries.erase(it->second);
+        m_index.erase(it);
+    }
+
+    auto   size  = tex->size();
+    size_t bytes = static_cast<size_t>(size.x) * static_cast<size_t>(size.y) *
+                   SDL_BYTESPERPIXEL(SDL_PIXELFORMAT_RGBA32);
+    evict_to(m_budget > bytes ? m_budget - bytes : 0);
+
+    m_entries.push_front({k.font_id, std::string{k.text}, k.color,
+                          k.wrap_width, std::move(tex), bytes});
+    auto &e = m_entries.front();
+    m_index.emplace(key{e.font_id, e.text, e.color, e.wrap_width},
+                    m_entries.begin());
+    m_stats.bytes   += bytes;
+    m_stats.entries = m_entries.size();
+    return e.tex;
+}
+
+void text_cache::evict_to(size_t budget) {
+    while(!m_entries.empty() && m_stats.bytes > budget) {
+        auto &e = m_entries.back();
+        m_index.erase(key{e.font_id, e.text, e.color, e.wrap_width});
+        m_stats.bytes -= e.bytes;
+        m_entries.pop_back();
+        ++m_stats.evictions;
+    }
+    m_stats.entries = m_entries.size();
+}
+
+void text_cache::set_budget(size_t budget) {
+    m_budget = budget;
+    evict_to(m_budget);
+}
+
+void text_cache::clear() {
+    m_index.clear();
+    m_entries.clear();
+    m_stats.bytes   = 0;
+    m_stats.entries = 0;
+}
+
+} // namespace gfx
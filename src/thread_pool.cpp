@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <atomic>
+#include <latch>
+
+#include "gfx/thread_pool.h"
+
+namespace gfx {
+
+thread_pool::thread_pool(size_t threads) {
+    m_threads.reserve(threads);
+    for(size_t i = 0; i < threads; ++i) {
+        m_threads.emplace_back([this] { run(); });
+    }
+}
+
+thread_pool::~thread_pool() {
+    {
+        std::scoped_lock lock{m_mutex};
+        m_stopping = true;
+        m_jobs.clear();
+    }
+    m_wake.notify_all();
+    for(auto &t : m_threads) {
+        t.join();
+    }
+}
+
+void thread_pool::submit(std::function<void()> job) {
+    {
+        std::scoped_lock lock{m_mutex};
+        m_jobs.push_back(std::move(job));
+    }
+    m_wake.notify_one();
+}
+
+void thread_pool::parallel_for(size_t                             count,
+                               std::function<void(size_t)> const &fn) {
+    if(count == 0) {
+        return;
+    }
+    std::atomic<size_t> next{0};
+    auto                work = [&next, count, &fn] {
+        for(size_t i = next++; i < count; i = next++) {
+            fn(i);
+        }
+    };
+
+    auto       helpers = std::min(size(), count - 1);
+    std::latch done{static_cast<std::ptrdiff_t>(helpers)};
+    for(size_t i = 0; i < helpers; ++i) {
+        submit([&work, &done] {
+            work();
+            done.count_down();
+        });
+    }
+    work();
+    done.wait();
+}
+
+auto thread_pool::pending() -> size_t {
+    std::scoped_lock lock{m_mutex};
+    return m_jobs.size();
+}
+
+void thread_pool::run() {
+    for(;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock lock{m_mutex};
+            m_wake.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+            if(m_stopping) {
+                return;
+            }
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        job();
+    }
+}
+
+} // namespace gfx
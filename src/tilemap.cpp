@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+
+#include "gfx/gfx.h"
+
+namespace gfx {
+
+namespace {
+
+constexpr std::array<int, 6> quad_indices{0, 1, 2, 2, 1, 3};
+
+void append_quad(std::vector<SDL_Vertex> &vertices, std::vector<int> &indices,
+                 SDL_FRect const &rect, SDL_FPoint uv0, SDL_FPoint uv1,
+                 SDL_Color c) {
+    auto base = static_cast<int>(vertices.size());
+    vertices.push_back({{rect.x, rect.y}, c, uv0});
+    vertices.push_back({{rect.x + rect.w, rect.y}, c, {uv1.x, uv0.y}});
+    vertices.push_back({{rect.x, rect.y + rect.h}, c, {uv0.x, uv1.y}});
+    vertices.push_back({{rect.x + rect.w, rect.y + rect.h}, c, uv1});
+    for(int i : quad_indices) {
+        indices.push_back(base + i);
+    }
+}
+
+} // namespace
+
+tilemap::tilemap(vec2d_t<int> size, int tile_size, int chunk_size,
+                 size_t max_chunk_textures)
+    : m_size{size}, m_tile_size{tile_size}, m_chunk_size{chunk_size},
+      m_max_chunk_textures{max_chunk_textures} {
+    if(size.x <= 0 || size.y <= 0 || tile_size <= 0 || chunk_size <= 0) {
+        throw std::runtime_error{"tilemap dimensions must be positive"};
+    }
+    m_chunks = {(size.x + chunk_size - 1) / chunk_size,
+                (size.y + chunk_size - 1) / chunk_size};
+    m_tiles.assign(static_cast<size_t>(size.x) * static_cast<size_t>(size.y),
+                   no_tile);
+    m_chunk_data.resize(static_cast<size_t>(m_chunks.x) *
+                        static_cast<size_t>(m_chunks.y));
+}
+
+auto tilemap::add_tile(texture_region const &region) -> tile_id {
+    if(m_tileset.size() >= no_tile) {
+        throw std::runtime_error{"tileset is full"};
+    }
+    m_tileset.push_back(region);
+    return static_cast<tile_id>(m_tileset.size() - 1);
+}
+
+auto tilemap::chunk_index(vec2d_t<int> tile) const -> size_t {
+    if(tile.x < 0 || tile.y < 0 || tile.x >= m_size.x || tile.y >= m_size.y) {
+        throw std::runtime_error{
+            fmt::format("tile {},{} is outside the map", tile.x, tile.y)};
+    }
+    return static_cast<size_t>((tile.y / m_chunk_size) * m_chunks.x +
+                               tile.x / m_chunk_size);
+}
+
+auto tilemap::get(vec2d_t<int> tile) const -> tile_id {
+    static_cast<void>(chunk_index(tile)); // throws outside the map
+    return m_tiles[static_cast<size_t>(vec2d_to_index(tile, m_size.x))];
+}
+
+void tilemap::set(vec2d_t<int> tile, tile_id id) {
+    auto  c     = chunk_index(tile);
+    auto  index = static_cast<size_t>(vec2d_to_index(tile, m_size.x));
+    auto &current = m_tiles[index];
+    if(current != id) {
+        current               = id;
+        m_chunk_data[c].dirty = true;
+    }
+}
+
+void tilemap::fill(tile_id id) {
+    std::fill(m_tiles.begin(), m_tiles.end(), id);
+    invalidate();
+}
+
+void tilemap::invalidate() {
+    for(auto &c : m_chunk_data) {
+        c.dirty = true;
+    }
+}
+
+auto tilemap::dirty_count() const -> size_t {
+    return static_cast<size_t>(
+        std::count_if(m_chunk_data.begin(), m_chunk_data.end(),
+                      [](chunk const &c) { return c.dirty; }));
+}
+
+void tilemap::rebuild(renderer &r, vec2d_t<int> c) {
+    auto  slot   = static_cast<uint32_t>(c.y * m_chunks.x + c.x);
+    auto &target = m_chunk_data[slot];
+    target.dirty = false;
+
+    auto first = c * m_chunk_size;
+    auto end_x = std::min(first.x + m_chunk_size, m_size.x);
+    auto end_y = std::min(first.y + m_chunk_size, m_size.y);
+    m_order.clear();
+    for(int y = first.y; y < end_y; ++y) {
+        for(int x = first.x; x < end_x; ++x) {
+            auto index = static_cast<size_t>(vec2d_to_index(vec2d_t<int>{x, y},
+                                                            m_size.x));
+            if(m_tiles[index] < m_tileset.size()) {
+                m_order.push_back(static_cast<uint32_t>(index));
+            }
+        }
+    }
+    target.empty = m_order.empty();
+    if(target.empty) {
+        return;
+    }
+    std::stable_sort(m_order.begin(), m_order.end(),
+                     [this](uint32_t a, uint32_t b) {
+                         return m_tileset[m_tiles[a]].source <
+                                m_tileset[m_tiles[b]].source;
+                     });
+
+    if(target.pixels.get_sdl_texture() == nullptr) {
+        auto side     = m_chunk_size * m_tile_size;
+        target.pixels = texture{r.get_sdl_renderer(), side, side};
+        // Tiles blended onto the cleared chunk are premultiplied; where the
+        // renderer can't blend that, chunks stay blended as before.
+        target.pixels.set_blend_mode(premultiplied_blend_mode());
+        m_resident.push_back(slot);
+    }
+    auto *previous_target = r.get_target();
+    auto  previous_color  = r.get_draw_color();
+    r.set_target(target.pixels);
+    r.clear(color_clear);
+
+    auto const tile  = static_cast<float>(m_tile_size);
+    auto const white = color_white.get_sdl_color();
+    for(size_t begin = 0; begin < m_order.size();) {
+        auto const *source = m_tileset[m_tiles[m_order[begin]]].source;
+        auto const  w      = static_cast<float>(source->width());
+        auto const  h      = static_cast<float>(source->height());
+        m_vertices.clear();
+        m_indices.clear();
+        auto end = begin;
+        for(; end < m_order.size() &&
+              m_tileset[m_tiles[m_order[end]]].source == source;
+            ++end) {
+            auto index = m_order[end];
+            auto pos =
+                index_to_vec2d(static_cast<int>(index), m_size.x) - first;
+            auto const &b = m_tileset[m_tiles[index]].bounds;
+            append_quad(m_vertices, m_indices,
+                        {static_cast<float>(pos.x) * tile,
+                         static_cast<float>(pos.y) * tile, tile, tile},
+                        {static_cast<float>(b.x) / w,
+                         static_cast<float>(b.y) / h},
+                        {static_cast<float>(b.x + b.w) / w,
+                         static_cast<float>(b.y + b.h) / h},
+                        white);
+        }
+        r.draw_geometry(m_vertices, m_indices, source->get_sdl_texture());
+        begin = end;
+    }
+
+    r.set_target(previous_target);
+    r.set_draw_color(previous_color);
+}
+
+void tilemap::draw(renderer &r, rect_t<double> view) {
+    GFX_PROFILE_SCOPE("tilemap");
+    m_stats = {};
+    ++m_draws;
+
+    auto chunk_units = static_cast<double>(m_chunk_size * m_tile_size);
+    auto first_x     = std::max(
+        0, static_cast<int>(std::floor(view.position.x / chunk_units)));
+    auto first_y = std::max(
+        0, static_cast<int>(std::floor(view.position.y / chunk_units)));
+    auto end_x = std::min(
+        m_chunks.x, static_cast<int>(std::ceil(
+                        (view.position.x + view.size.x) / chunk_units)));
+    auto end_y = std::min(
+        m_chunks.y, static_cast<int>(std::ceil(
+                        (view.position.y + view.size.y) / chunk_units)));
+
+    // All rebuilds come first, so drawing the chunks doesn't alternate
+    // between targets.
+    for(int y = first_y; y < end_y; ++y) {
+        for(int x = first_x; x < end_x; ++x) {
+            if(m_chunk_data[static_cast<size_t>(y * m_chunks.x + x)].dirty) {
+                rebuild(r, {x, y});
+                ++m_stats.chunks_rebuilt;
+            }
+        }
+    }
+
+    auto zoom  = r.get_window_size().x / view.size.x;
+    auto side  = static_cast<float>(chunk_units * zoom);
+    auto white = color_white.get_sdl_color();
+    for(int y = first_y; y < end_y; ++y) {
+        for(int x = first_x; x < end_x; ++x) {
+            auto &c = m_chunk_data[static_cast<size_t>(y * m_chunks.x + x)];
+            c.last_drawn = m_draws;
+            if(c.empty) {
+                continue;
+            }
+            auto p = (vec2d_t<double>{x * chunk_units, y * chunk_units} -
+                      view.position) *
+                     zoom;
+            m_vertices.clear();
+            m_indices.clear();
+            append_quad(m_vertices, m_indices,
+                        {static_cast<float>(p.x), static_cast<float>(p.y),
+                         side, side},
+                        {0, 0}, {1, 1}, white);
+            r.draw_geometry(m_vertices, m_indices,
+                            c.pixels.get_sdl_texture());
+            ++m_stats.chunks_drawn;
+        }
+    }
+    release_unused(r);
+}
+
+void tilemap::release_unused(renderer &r) {
+    if(m_resident.size() <= m_max_chunk_textures) {
+        return;
+    }
+    std::sort(m_resident.begin(), m_resident.end(),
+              [this](uint32_t a, uint32_t b) {
+                  return m_chunk_data[a].last_drawn <
+                         m_chunk_data[b].last_drawn;
+              });
+    // Draws recorded earlier in the frame may still read these textures.
+    r.flush();
+    auto const excess   = m_resident.size() - m_max_chunk_textures;
+    size_t     released = 0;
+    for(; released < excess; ++released) {
+        auto &c = m_chunk_data[m_resident[released]];
+        if(c.last_drawn == m_draws) {
+            break;
+        }
+        c.pixels = texture{};
+        c.dirty  = true;
+    }
+    m_resident.erase(m_resident.begin(),
+                     m_resident.begin() + static_cast<ptrdiff_t>(released));
+    m_stats.chunks_released = released;
+}
+
+} // namespace gfx
@@ -1,5 +1,20 @@
+#include <algorithm>
+#include <array>
 #include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <memory_resource>
+#include <set>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "gfx/gfx.h"
 
@@ -12,3 +27,1096 @@ TEST_CASE("Can create window", "[gfx]") {
     gfx::gfx gfx{};
     REQUIRE_NOTHROW(gfx::create_window("Can create window", 100, 100));
 }
+
+TEST_CASE("Command buffer submits each state group in one call",
+          "[gfx][headless]") {
+    gfx::gfx      gfx{0};
+    gfx::headless target{32, 32};
+    auto         &r = target.get_renderer();
+    r.clear(gfx::color{0, 0, 0, 255});
+
+    gfx::command_buffer commands;
+    commands.set_color(gfx::color{255, 255, 255, 255});
+    // A polyline drawn a segment at a time, then separate lines.
+    commands.record_line({1, 1}, {8, 1});
+    commands.record_line({8, 1}, {8, 8});
+    gfx::command_buffer lines;
+    lines.set_color(gfx::color{255, 0, 0, 255});
+    for(int i = 0; i < 8; ++i) {
+        auto y = static_cast<float>(12 + 2 * i);
+        lines.record_line({2, y}, {20, y});
+    }
+    for(int i = 0; i < 4; ++i) {
+        lines.record_point({30, static_cast<float>(i)});
+    }
+    REQUIRE(commands.get_stats().recorded_calls == 3);
+    REQUIRE(lines.get_stats().recorded_calls == 13);
+
+    r.submit(commands);
+    // The color and the polyline.
+    REQUIRE(commands.get_stats().submitted_calls == 2);
+    REQUIRE(commands.get_stats().saved_calls() == 1);
+    REQUIRE(commands.empty());
+
+    r.submit(lines);
+    // The color, the lines and the points.
+    REQUIRE(lines.get_stats().submitted_calls == 3);
+    REQUIRE(lines.get_stats().saved_calls() == 10);
+
+    auto frame = target.frame();
+    auto pixel = [&](int x, int y) {
+        return frame.pixels[static_cast<size_t>(y * frame.pitch + x * 4)];
+    };
+    REQUIRE(pixel(8, 5) == std::byte{255});
+    REQUIRE(pixel(2, 12) == std::byte{255});
+    REQUIRE(pixel(20, 26) == std::byte{255});
+    REQUIRE(pixel(11, 13) == std::byte{0});
+    REQUIRE(pixel(21, 12) == std::byte{0});
+}
+
+TEST_CASE("Command buffer keeps overlapping draws in order",
+          "[gfx][headless]") {
+    gfx::gfx      gfx{0};
+    gfx::headless target{16, 16};
+    auto         &r = target.get_renderer();
+    r.clear(gfx::color{0, 0, 0, 255});
+    gfx::texture layer{r.get_sdl_renderer(), 4, 4};
+
+    r.set_batching(true);
+    // The window is drawn to before the texture it later samples.
+    r.set_draw_color(gfx::color{0, 0, 255, 255});
+    r.draw_point(vec2d_t<int>{15, 15});
+    r.set_target(layer);
+    r.set_draw_color(gfx::color{255, 255, 255, 255});
+    r.fill_rect(rect_t<int>{{0, 0}, {4, 4}});
+    r.reset_target();
+    auto                      white = gfx::color_white.get_sdl_color();
+    std::array<SDL_Vertex, 4> quad{{{{0, 0}, white, {0, 0}},
+                                    {{4, 0}, white, {1, 0}},
+                                    {{0, 4}, white, {0, 1}},
+                                    {{4, 4}, white, {1, 1}}}};
+    constexpr std::array<int, 6> indices{0, 1, 2, 2, 1, 3};
+    r.draw_geometry(quad, indices, layer.get_sdl_texture());
+    // A fill and then a line across it.
+    r.set_draw_color(gfx::color{255, 0, 0, 255});
+    r.fill_rect(rect_t<int>{{4, 4}, {8, 8}});
+    r.set_draw_color(gfx::color{0, 255, 0, 255});
+    r.draw_line(vec2d_t<int>{0, 8}, vec2d_t<int>{15, 8});
+    r.set_batching(false);
+
+    auto frame = target.frame();
+    auto pixel = [&](int x, int y) {
+        auto const *p = frame.pixels + y * frame.pitch + x * 4;
+        return std::array<int, 3>{static_cast<int>(p[0]),
+                                  static_cast<int>(p[1]),
+                                  static_cast<int>(p[2])};
+    };
+    REQUIRE(pixel(1, 1) == std::array<int, 3>{255, 255, 255});
+    REQUIRE(pixel(6, 8) == std::array<int, 3>{0, 255, 0});
+    REQUIRE(pixel(6, 6) == std::array<int, 3>{255, 0, 0});
+    REQUIRE(pixel(15, 15) == std::array<int, 3>{0, 0, 255});
+}
+
+TEST_CASE("UTF-8 decoding replaces malformed sequences", "[text]") {
+    std::string_view text = "a\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80\xC3";
+    size_t           pos  = 0;
+    REQUIRE(gfx::decode_utf8(text, pos) == 'a');
+    REQUIRE(gfx::decode_utf8(text, pos) == 0xE9);
+    REQUIRE(gfx::decode_utf8(text, pos) == 0x20AC);
+    REQUIRE(gfx::decode_utf8(text, pos) == 0x1F600);
+    REQUIRE(pos == 10);
+    // Cut short by the end of the text.
+    REQUIRE(gfx::decode_utf8(text, pos) == 0xFFFD);
+    REQUIRE(pos == text.size());
+
+    // A stray continuation byte, then a lead byte followed by ASCII.
+    std::string_view broken = "\x80\xE2x";
+    pos                     = 0;
+    REQUIRE(gfx::decode_utf8(broken, pos) == 0xFFFD);
+    REQUIRE(gfx::decode_utf8(broken, pos) == 0xFFFD);
+    REQUIRE(gfx::decode_utf8(broken, pos) == 'x');
+}
+
+namespace {
+
+// Tests that need a font use GFX_TEST_FONT, or a common system font.
+auto test_font_path() -> std::string {
+    if(auto const *path = std::getenv("GFX_TEST_FONT")) {
+        return path;
+    }
+    for(auto const *path :
+        {"/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf",
+         "/usr/share/fonts/TTF/DejaVuSans.ttf",
+         "/System/Library/Fonts/Supplemental/Arial.ttf",
+         "C:/Windows/Fonts/arial.ttf"}) {
+        if(std::filesystem::exists(path)) {
+            return path;
+        }
+    }
+    return {};
+}
+
+} // namespace
+
+TEST_CASE("Atlas text wraps between words", "[gfx][headless]") {
+    auto path = test_font_path();
+    if(path.empty()) {
+        WARN("no font found, set GFX_TEST_FONT to run this test");
+        return;
+    }
+    gfx::gfx      gfx{0};
+    gfx::headless target{200, 100};
+    auto         &r = target.get_renderer();
+    gfx::font     font{path, 16};
+    auto         &atlas = r.get_glyph_atlas(font);
+    auto const    line  = atlas.line_skip();
+
+    auto one_line = atlas.measure("aaaa bbbb");
+    auto wrapped =
+        atlas.measure("aaaa bbbb", static_cast<uint32_t>(one_line.x - 1));
+    REQUIRE(one_line.y == line);
+    REQUIRE(wrapped.y == 2 * line);
+    REQUIRE(wrapped.x < one_line.x);
+    // A word wider than the line is broken between letters.
+    auto word = static_cast<uint32_t>(atlas.measure("aaaa").x);
+    REQUIRE(atlas.measure("aaaaaaaa", word).y == 2 * line);
+
+    r.clear(gfx::color{0, 0, 0, 255});
+    r.draw_text(font, "aaaa bbbb", vec2d_t<int>{0, 0},
+                gfx::color{255, 255, 255, 255},
+                static_cast<uint32_t>(wrapped.x));
+    auto frame = target.frame();
+    int  below = 0;
+    int  past  = 0;
+    for(int y = 0; y < frame.height; ++y) {
+        for(int x = 0; x < frame.width; ++x) {
+            if(frame.pixels[y * frame.pitch + x * 4] != std::byte{0}) {
+                below += y >= line ? 1 : 0;
+                past  += x > wrapped.x + 2 ? 1 : 0;
+            }
+        }
+    }
+    REQUIRE(below > 0);
+    REQUIRE(past == 0);
+}
+
+TEST_CASE("Text cache evicts least recently used textures over budget",
+          "[gfx][headless]") {
+    gfx::gfx gfx{0};
+    auto     target = std::make_unique<gfx::headless>(16, 16);
+    auto    &r      = target->get_renderer();
+    auto    &cache  = r.get_text_cache();
+    auto     make   = [&] {
+        return std::make_shared<gfx::texture>(r.get_sdl_renderer(), 16, 16);
+    };
+    constexpr size_t bytes = 16 * 16 * 4;
+
+    cache.set_budget(3 * bytes);
+    cache.insert({1, "a", 0}, make());
+    cache.insert({1, "b", 0}, make());
+    cache.insert({1, "c", 0}, make());
+    REQUIRE(cache.find({1, "a", 0}) != nullptr);
+    // b is now the least recently used.
+    cache.insert({1, "d", 0}, make());
+    REQUIRE(cache.find({1, "b", 0}) == nullptr);
+    REQUIRE(cache.find({1, "a", 0}) != nullptr);
+    REQUIRE(cache.find({2, "a", 0}) == nullptr);
+    REQUIRE(cache.find({1, "a", 0, 100}) == nullptr);
+
+    auto const &stats = cache.get_stats();
+    REQUIRE(stats.entries == 3);
+    REQUIRE(stats.bytes == 3 * bytes);
+    REQUIRE(stats.evictions == 1);
+    REQUIRE(stats.hits == 2);
+    REQUIRE(stats.misses == 3);
+    REQUIRE(std::abs(stats.hit_rate() - 0.4) < 1e-9);
+
+    cache.set_budget(bytes);
+    REQUIRE(stats.entries == 1);
+    REQUIRE(stats.evictions == 3);
+    REQUIRE(cache.find({1, "a", 0}) != nullptr);
+
+    // The cached textures go before the SDL renderer they belong to.
+    cache.set_budget(gfx::text_cache::default_budget);
+    cache.insert({1, "e", 0}, make());
+    target.reset();
+}
+
+TEST_CASE("Circle segment count follows radius", "[circle]") {
+    REQUIRE(gfx::circle_segments(0.5) == gfx::min_circle_segments);
+    REQUIRE(gfx::circle_segments(10.0) <= gfx::circle_segments(100.0));
+    REQUIRE(gfx::circle_segments(1e9) == gfx::max_circle_segments);
+
+    auto table = gfx::unit_circle(16);
+    REQUIRE(table.size() == 17);
+    REQUIRE(table.data() == gfx::unit_circle(16).data());
+
+    // Counts past the cached tables aren't clamped.
+    auto fine = gfx::unit_circle(4 * gfx::max_circle_segments);
+    REQUIRE(fine.size() == 4 * gfx::max_circle_segments + 1);
+    REQUIRE(std::abs(fine[gfx::max_circle_segments].y - 1.0F) < 1e-6F);
+}
+
+TEST_CASE("Sprite batch draws by layer, rotated and tinted",
+          "[gfx][headless]") {
+    gfx::gfx      gfx{0};
+    gfx::headless target{32, 32};
+    auto         &r = target.get_renderer();
+    r.clear(gfx::color{0, 0, 0, 255});
+
+    auto white = [&](int w, int h) {
+        gfx::surface pixels{w, h};
+        SDL_FillRect(pixels.get_sdl_surface(), nullptr, 0xFFFFFFFF);
+        return gfx::texture{r.get_sdl_renderer(), pixels};
+    };
+    auto square = white(4, 4);
+    auto other  = white(4, 4);
+    auto bar    = white(8, 2);
+
+    gfx::sprite_batch batch;
+    batch.begin({{0, 0}, {32, 32}});
+    batch.add(square, {2, 2}, 0, {}, gfx::color{255, 0, 0}, 1);
+    batch.add(other, {2, 2}, 0, {}, gfx::color{0, 255, 0}, 0);
+    batch.add(other, {4, 4}, 0, {}, gfx::color{0, 0, 255}, 1);
+    // Turned a quarter around the middle of its left edge.
+    batch.add(bar, {16, 16}, 90, {0, 1}, gfx::color{255, 255, 0});
+    batch.submit(r);
+
+    auto frame = target.frame();
+    auto pixel = [&](int x, int y) {
+        auto const *p = frame.pixels + y * frame.pitch + x * 4;
+        return std::array<int, 3>{static_cast<int>(p[0]),
+                                  static_cast<int>(p[1]),
+                                  static_cast<int>(p[2])};
+    };
+    // The lower layer is covered, and within a layer the later sprite wins.
+    REQUIRE(pixel(3, 3) == std::array<int, 3>{255, 0, 0});
+    REQUIRE(pixel(5, 5) == std::array<int, 3>{0, 0, 255});
+    REQUIRE(pixel(16, 21) == std::array<int, 3>{255, 255, 0});
+    REQUIRE(pixel(21, 16) == std::array<int, 3>{0, 0, 0});
+}
+
+TEST_CASE("Skyline packer places rectangles without overlap", "[atlas]") {
+    gfx::skyline_packer   packer{64, 64};
+    std::vector<SDL_Rect> placed;
+    for(int i = 0; i < 12; ++i) {
+        int  w        = 8 + (i % 3) * 4;
+        int  h        = 8 + (i % 4) * 2;
+        auto position = packer.insert(w, h);
+        REQUIRE(position.has_value());
+        SDL_Rect r{position->x, position->y, w, h};
+        REQUIRE(r.x + r.w <= 64);
+        REQUIRE(r.y + r.h <= 64);
+        for(auto const &other : placed) {
+            bool apart = r.x >= other.x + other.w || other.x >= r.x + r.w ||
+                         r.y >= other.y + other.h || other.y >= r.y + r.h;
+            REQUIRE(apart);
+        }
+        placed.push_back(r);
+    }
+    REQUIRE_FALSE(packer.insert(65, 1).has_value());
+}
+
+TEST_CASE("Atlas layout round-trips through a file", "[atlas]") {
+    auto path =
+        (std::filesystem::temp_directory_path() / "gfx_atlas_test").string();
+    gfx::atlas_builder builder{64, 1};
+    builder.add("hero idle", std::make_shared<gfx::surface>(20, 30));
+    builder.add("coin", std::make_shared<gfx::surface>(8, 8));
+    builder.add("wall", std::make_shared<gfx::surface>(60, 40));
+    auto layout = builder.pack();
+    REQUIRE(layout.page_count == 2);
+    layout.save(path);
+
+    auto loaded = gfx::atlas_layout::load(path);
+    REQUIRE(loaded.page_size == layout.page_size);
+    REQUIRE(loaded.page_count == layout.page_count);
+    REQUIRE(loaded.entries.size() == layout.entries.size());
+    for(size_t i = 0; i < layout.entries.size(); ++i) {
+        auto const &a = layout.entries[i];
+        auto const &b = loaded.entries[i];
+        REQUIRE(a.name == b.name);
+        REQUIRE(a.page == b.page);
+        REQUIRE(a.bounds.x == b.bounds.x);
+        REQUIRE(a.bounds.y == b.bounds.y);
+        REQUIRE(a.bounds.w == b.bounds.w);
+        REQUIRE(a.bounds.h == b.bounds.h);
+    }
+
+    std::ofstream{path} << "not an atlas\n";
+    REQUIRE_THROWS(gfx::atlas_layout::load(path));
+    std::filesystem::remove(path);
+    REQUIRE_THROWS(gfx::atlas_layout::load(path));
+}
+
+TEST_CASE("Span transforms match the scalar ones", "[camera]") {
+    rect_t<double>               view{10, -5, 200, 150};
+    std::vector<vec2d_t<double>> world;
+    for(int i = 0; i < 37; ++i) {
+        world.push_back({i * 3.5 - 20, 7.25 - i});
+    }
+    std::vector<vec2d_t<double>> window(world.size());
+    gfx::world_to_window(world, window, view, 800);
+    for(size_t i = 0; i < world.size(); ++i) {
+        auto expected = gfx::world_to_window(world[i], view, 800);
+        REQUIRE(std::abs(window[i].x - expected.x) < 1e-9);
+        REQUIRE(std::abs(window[i].y - expected.y) < 1e-9);
+    }
+
+    std::vector<vec2d_t<double>> back(world.size());
+    gfx::window_to_world(window, back, view, 800);
+    for(size_t i = 0; i < world.size(); ++i) {
+        REQUIRE(std::abs(back[i].x - world[i].x) < 1e-9);
+        REQUIRE(std::abs(back[i].y - world[i].y) < 1e-9);
+    }
+
+    // Far from the origin, floats only keep their precision if the view
+    // position is subtracted before scaling.
+    rect_t<double>              far{1e6, -1e6, 100, 100};
+    std::vector<vec2d_t<float>> near;
+    for(int i = 0; i < 37; ++i) {
+        near.push_back({1e6F + 0.0625F * static_cast<float>(i),
+                        -1e6F - 0.0625F * static_cast<float>(i)});
+    }
+    std::vector<vec2d_t<float>> near_window(near.size());
+    gfx::world_to_window(near, near_window, far, 1000);
+    for(size_t i = 0; i < near.size(); ++i) {
+        auto expected = 0.625F * static_cast<float>(i);
+        REQUIRE(std::abs(near_window[i].x - expected) < 1e-3F);
+        REQUIRE(std::abs(near_window[i].y + expected) < 1e-3F);
+    }
+}
+
+TEST_CASE("Spatial grid finds objects by area and point", "[spatial]") {
+    gfx::spatial_grid<double, int> grid{{0, 0, 1000, 1000}, 50};
+    auto a = grid.insert(1, {10, 10, 20, 20});
+    grid.insert(2, {500, 500, 300, 300});
+    auto c = grid.insert(3, {990, 990, 5, 5});
+
+    auto found = [&grid](auto const &where) {
+        std::vector<int> ids;
+        grid.query(where, [&ids](int id, rect_t<double> const &) {
+            ids.push_back(id);
+        });
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    };
+
+    REQUIRE(found(rect_t<double>{0, 0, 100, 100}) == std::vector<int>{1});
+    REQUIRE(found(rect_t<double>{450, 450, 100, 100}) == std::vector<int>{2});
+    REQUIRE(found(vec2d_t<double>{790, 790}) == std::vector<int>{2});
+    REQUIRE(found(vec2d_t<double>{5, 5}).empty());
+
+    grid.move(a, {600, 100, 20, 20});
+    REQUIRE(found(rect_t<double>{0, 0, 100, 100}).empty());
+    REQUIRE(found(rect_t<double>{595, 95, 10, 20}) == std::vector<int>{1});
+
+    grid.remove(c);
+    REQUIRE(grid.size() == 2);
+    REQUIRE(found(rect_t<double>{0, 0, 1000, 1000}) == std::vector<int>{1, 2});
+
+    // Objects larger than a cell are kept aside instead of widening every
+    // query, and go back into the cells when they shrink.
+    REQUIRE(grid.large_count() == 1);
+    auto big = grid.insert(4, {100, 100, 250, 250});
+    REQUIRE(grid.large_count() == 2);
+    REQUIRE(found(vec2d_t<double>{340, 120}) == std::vector<int>{4});
+    grid.move(big, {100, 100, 20, 20});
+    REQUIRE(grid.large_count() == 1);
+    REQUIRE(found(rect_t<double>{110, 110, 5, 5}) == std::vector<int>{4});
+    REQUIRE(found(vec2d_t<double>{340, 120}).empty());
+}
+
+TEST_CASE("Streaming texture writes the back buffer and swaps",
+          "[gfx][headless]") {
+    gfx::gfx               gfx{0};
+    gfx::headless          target{8, 4};
+    auto                  &r = target.get_renderer();
+    gfx::streaming_texture frames{r.get_sdl_renderer(), 8, 4,
+                                  gfx::streaming_texture::triple_buffered};
+    REQUIRE(frames.buffer_count() == 3);
+    REQUIRE(frames.size().x == 8);
+    REQUIRE(frames.size().y == 4);
+    REQUIRE_THROWS(gfx::streaming_texture{r.get_sdl_renderer(), 8, 4, 1});
+
+    auto *first   = frames.front().get_sdl_texture();
+    auto *written = frames.back().get_sdl_texture();
+    REQUIRE(first != written);
+
+    auto pixels = frames.lock();
+    REQUIRE(pixels.width == 8);
+    REQUIRE(pixels.height == 4);
+    REQUIRE(pixels.pitch >= 8 * 4);
+    REQUIRE_THROWS(frames.lock());
+    std::array<uint8_t, 4> const red{255, 0, 0, 255};
+    for(int y = 0; y < pixels.height; ++y) {
+        for(auto &p : pixels.row(y)) {
+            std::memcpy(&p, red.data(), red.size());
+        }
+    }
+    REQUIRE_THROWS(frames.update(red.data(), 4));
+    frames.swap();
+    REQUIRE(frames.front().get_sdl_texture() == written);
+
+    // A partial update only touches its area of the next back buffer.
+    std::array<uint8_t, 4> const blue{0, 0, 255, 255};
+    SDL_Rect const               corner{0, 0, 1, 1};
+    frames.update(blue.data(), 4, &corner);
+    frames.swap();
+    frames.swap();
+    REQUIRE(frames.front().get_sdl_texture() == first);
+    frames.swap();
+    REQUIRE(frames.front().get_sdl_texture() == written);
+
+    r.clear({0, 0, 0});
+    r.draw_texture(frames.front(), vec2d_t<double>{0, 0},
+                   rect_t<double>{0, 0, 8, 4});
+    auto frame = target.frame();
+    for(int y = 0; y < 4; ++y) {
+        auto *row = frame.pixels + static_cast<ptrdiff_t>(y) * frame.pitch;
+        REQUIRE(std::memcmp(row, red.data(), red.size()) == 0);
+        REQUIRE(std::memcmp(row + 7 * 4, red.data(), red.size()) == 0);
+    }
+}
+
+TEST_CASE("Software rasterizer output doesn't depend on threads", "[raster]") {
+    auto draw = [](gfx::software_rasterizer &r) {
+        r.clear({10, 20, 30});
+        r.fill_rect({5, 5, 70, 40}, {200, 100, 50, 128});
+        r.draw_line({0, 79}, {95, 0}, {255, 255, 255, 200});
+        r.fill_circle({48, 40}, 30, {0, 0, 255, 90});
+        r.draw_circle({48, 40}, 35, {0, 255, 0, 160});
+        r.flush();
+    };
+    gfx::surface     serial{96, 80};
+    gfx::surface     parallel{96, 80};
+    gfx::thread_pool pool{4};
+    {
+        gfx::software_rasterizer r{serial, nullptr, 16};
+        REQUIRE(r.thread_count() == 1);
+        draw(r);
+    }
+    {
+        gfx::software_rasterizer r{parallel, &pool, 16};
+        REQUIRE(r.thread_count() == 5);
+        draw(r);
+    }
+
+    auto *a = serial.get_sdl_surface();
+    auto *b = parallel.get_sdl_surface();
+    REQUIRE(std::memcmp(a->pixels, b->pixels,
+                        static_cast<size_t>(a->pitch * a->h)) == 0);
+
+    auto pixel = [a](int x, int y) {
+        auto const *p = static_cast<uint8_t const *>(a->pixels) + y * a->pitch +
+                        x * 4;
+        return std::array<int, 4>{p[0], p[1], p[2], p[3]};
+    };
+    REQUIRE(pixel(1, 1) == std::array<int, 4>{10, 20, 30, 255});
+    REQUIRE(pixel(10, 10) == std::array<int, 4>{105, 60, 40, 255});
+}
+
+TEST_CASE("Profiler closes frames and exports them", "[profile]") {
+    auto &p = gfx::profiler::instance();
+    p.reset();
+    p.add(gfx::counter::draw_calls, 3);
+    p.add(gfx::counter::bytes_uploaded, 1024);
+    p.end_frame();
+    p.add(gfx::counter::draw_calls);
+    REQUIRE(p.current()[gfx::counter::draw_calls] == 1);
+
+    auto frames = p.frames();
+    REQUIRE(frames.size() == 1);
+    REQUIRE(frames[0][gfx::counter::draw_calls] == 3);
+    REQUIRE(frames[0][gfx::counter::bytes_uploaded] == 1024);
+
+    std::ostringstream json;
+    p.write_json(json);
+    REQUIRE(json.str().find("\"draw_calls\": 3") != std::string::npos);
+
+    std::ostringstream trace;
+    p.write_chrome_trace(trace);
+    REQUIRE(trace.str().find("\"traceEvents\"") != std::string::npos);
+    REQUIRE(trace.str().find("\"name\": \"frame\"") != std::string::npos);
+    p.reset();
+}
+
+TEST_CASE("Headless renderer draws into caller memory", "[gfx][headless]") {
+    gfx::gfx               gfx{0};
+    std::vector<std::byte> pixels(16 * 8 * 4);
+    gfx::headless          target{pixels, 16, 8};
+    target.get_renderer().clear({255, 0, 0});
+    auto frame = target.frame();
+    REQUIRE(frame.pixels == pixels.data());
+    REQUIRE(pixels[0] == std::byte{255});
+    REQUIRE(pixels[1] == std::byte{0});
+    REQUIRE(pixels[3] == std::byte{255});
+
+    std::vector<std::byte> copy(pixels.size());
+    target.read_frame(copy);
+    REQUIRE(copy == pixels);
+}
+
+TEST_CASE("Random engine fills are deterministic and in range", "[random]") {
+    gfx::random_engine a{7};
+    gfx::random_engine b{7};
+    REQUIRE(a() == b());
+
+    auto other = a.split();
+    REQUIRE(other() != a());
+
+    std::vector<double> uniform(1003);
+    a.fill_uniform(uniform, -2.0, 3.0);
+    double sum = 0;
+    for(auto v : uniform) {
+        REQUIRE(v >= -2.0);
+        REQUIRE(v < 3.0);
+        sum += v;
+    }
+    REQUIRE(sum / 1003 > 0.3);
+    REQUIRE(sum / 1003 < 0.7);
+
+    std::vector<vec2d_t<float>> points(101);
+    b.fill_uniform(points, {0, 10}, {1, 11});
+    for(auto p : points) {
+        REQUIRE(p.x >= 0);
+        REQUIRE(p.x < 1);
+        REQUIRE(p.y >= 10);
+        REQUIRE(p.y < 11);
+    }
+
+    std::vector<double> normal(10001);
+    gfx::random_engine{7}.fill_normal(normal, 5.0, 2.0);
+    double mean = 0;
+    double sq   = 0;
+    for(auto v : normal) {
+        mean += v;
+        sq   += v * v;
+    }
+    mean       /= 10001;
+    auto stddev = std::sqrt(sq / 10001 - mean * mean);
+    REQUIRE(mean > 4.9);
+    REQUIRE(mean < 5.1);
+    REQUIRE(stddev > 1.9);
+    REQUIRE(stddev < 2.1);
+}
+
+TEST_CASE("Renderer skips redundant state changes", "[gfx][headless]") {
+    gfx::gfx      gfx{0};
+    gfx::headless target{16, 8};
+    auto         &r = target.get_renderer();
+    r.set_draw_color(gfx::color{0, 0, 0, 255});
+    r.reset_state_stats();
+
+    gfx::color red{255, 0, 0, 255};
+    r.set_draw_color(red);
+    r.set_draw_color(red);
+    r.set_blend_mode(SDL_BLENDMODE_BLEND);
+    r.reset_target();
+    REQUIRE(r.get_draw_color().packed() == red.packed());
+    REQUIRE(r.get_state_stats().applied == 1);
+    REQUIRE(r.get_state_stats().skipped == 3);
+
+    r.set_clip_rect(SDL_Rect{0, 0, 4, 4});
+    r.set_clip_rect(SDL_Rect{0, 0, 4, 4});
+    REQUIRE(r.get_clip_rect().has_value());
+    r.set_clip_rect(std::nullopt);
+    REQUIRE_FALSE(r.get_clip_rect().has_value());
+    REQUIRE(r.get_state_stats().applied == 3);
+    REQUIRE(r.get_state_stats().skipped == 4);
+}
+
+TEST_CASE("Renderer notices when its target texture is destroyed",
+          "[gfx][headless]") {
+    gfx::gfx      gfx{0};
+    gfx::headless target{16, 8};
+    auto         &r = target.get_renderer();
+    auto first = std::make_unique<gfx::texture>(r.get_sdl_renderer(), 4, 4);
+    r.set_target(*first);
+    first.reset();
+    // SDL went back to the window, and a new texture may get the address of
+    // the old one.
+    REQUIRE(r.get_target() == nullptr);
+    gfx::texture second{r.get_sdl_renderer(), 4, 4};
+    r.set_target(second);
+    REQUIRE(SDL_GetRenderTarget(r.get_sdl_renderer()) ==
+            second.get_sdl_texture());
+    r.reset_target();
+    REQUIRE(SDL_GetRenderTarget(r.get_sdl_renderer()) == nullptr);
+}
+
+TEST_CASE("Particle emitter integrates, ages and compacts", "[particles]") {
+    gfx::particle_settings settings;
+    settings.position     = {10, 20};
+    settings.velocity     = {2, -4};
+    settings.acceleration = {0, 8};
+    settings.lifetime     = 1;
+    gfx::particle_emitter emitter{100, settings};
+
+    REQUIRE(emitter.emit(60) == 60);
+    REQUIRE(emitter.emit(60) == 40);
+    REQUIRE(emitter.size() == 100);
+
+    emitter.update(0.5F);
+    REQUIRE(emitter.size() == 100);
+    for(size_t i = 0; i < emitter.size(); ++i) {
+        REQUIRE(std::abs(emitter.x()[i] - 11.0F) < 1e-5F);
+        REQUIRE(std::abs(emitter.y()[i] - 20.0F) < 1e-5F);
+        REQUIRE(std::abs(emitter.life()[i] - 0.5F) < 1e-5F);
+    }
+
+    emitter.update(0.5F);
+    REQUIRE(emitter.empty());
+
+    gfx::thread_pool pool{2};
+    gfx::particle_emitter serial{50000, settings, 3};
+    gfx::particle_emitter parallel{50000, settings, 3};
+    serial.emit(50000);
+    parallel.emit(50000);
+    serial.update(0.25F);
+    parallel.update(0.25F, &pool);
+    REQUIRE(std::memcmp(serial.x().data(), parallel.x().data(),
+                        serial.size() * sizeof(float)) == 0);
+}
+
+TEST_CASE("Tilemap only rebuilds dirty chunks in view", "[gfx][headless]") {
+    gfx::gfx      gfx{0};
+    gfx::headless target{64, 64};
+    auto         &r = target.get_renderer();
+    gfx::texture  tiles{r.get_sdl_renderer(), 8, 8};
+    gfx::tilemap  map{{64, 64}, 8, 4};
+    auto          grass = map.add_tile(tiles);
+    map.fill(grass);
+    REQUIRE(map.chunk_count() == 256);
+
+    rect_t<double> view{0, 0, 64, 64};
+    map.draw(r, view);
+    REQUIRE(map.get_stats().chunks_drawn == 4);
+    REQUIRE(map.get_stats().chunks_rebuilt == 4);
+    map.draw(r, view);
+    REQUIRE(map.get_stats().chunks_rebuilt == 0);
+    REQUIRE(map.dirty_count() == 252);
+
+    map.set({1, 1}, grass);
+    REQUIRE(map.dirty_count() == 252);
+    map.set({1, 1}, gfx::tilemap::no_tile);
+    REQUIRE(map.dirty_count() == 253);
+    map.draw(r, view);
+    REQUIRE(map.get_stats().chunks_rebuilt == 1);
+    REQUIRE(map.get({1, 1}) == gfx::tilemap::no_tile);
+
+    // Chunks out of view give their textures up past the budget.
+    gfx::tilemap small{{64, 64}, 8, 4, 4};
+    small.fill(small.add_tile(tiles));
+    small.draw(r, view);
+    REQUIRE(small.texture_count() == 4);
+    small.draw(r, {64, 0, 64, 64});
+    REQUIRE(small.get_stats().chunks_rebuilt == 4);
+    REQUIRE(small.get_stats().chunks_released == 4);
+    REQUIRE(small.texture_count() == 4);
+    small.draw(r, {0, 0, 128, 128});
+    REQUIRE(small.get_stats().chunks_rebuilt == 12);
+    REQUIRE(small.get_stats().chunks_released == 0);
+    REQUIRE(small.texture_count() == 16);
+    small.draw(r, view);
+    REQUIRE(small.get_stats().chunks_rebuilt == 0);
+    REQUIRE(small.get_stats().chunks_released == 12);
+    REQUIRE(small.texture_count() == 4);
+}
+
+TEST_CASE("Compositor redraws only damaged regions", "[gfx][headless]") {
+    gfx::damage_region damage{{0, 0, 100, 100}};
+    damage.add({10, 10, 20, 20});
+    damage.add({25, 25, 20, 20});
+    damage.add({80, 80, 40, 40});
+    REQUIRE(damage.rects().size() == 2);
+    REQUIRE(damage.area() == 35 * 35 + 20 * 20);
+
+    gfx::gfx        gfx{0};
+    gfx::headless   target{100, 100};
+    auto           &r = target.get_renderer();
+    gfx::compositor layers{{100, 100}};
+    int             background_draws = 0;
+    int             cursor_draws     = 0;
+    layers.add_layer([&](gfx::renderer &, rect_t<int> const &) {
+        ++background_draws;
+    });
+    auto &cursor = layers.add_layer(
+        [&](gfx::renderer &, rect_t<int> const &) { ++cursor_draws; });
+
+    layers.compose(r);
+    REQUIRE(background_draws == 1);
+    REQUIRE(cursor_draws == 1);
+
+    layers.compose(r);
+    REQUIRE(layers.get_stats().regions_redrawn == 0);
+    REQUIRE(layers.get_stats().regions_composited == 0);
+
+    cursor.invalidate({40, 40, 8, 8});
+    layers.compose(r);
+    REQUIRE(background_draws == 1);
+    REQUIRE(cursor_draws == 2);
+    REQUIRE(layers.get_stats().pixels_redrawn == 64);
+    REQUIRE(layers.get_stats().regions_composited == 1);
+}
+
+TEST_CASE("Compositor blends translucent layers once", "[gfx][headless]") {
+    gfx::gfx        gfx{0};
+    gfx::headless   target{8, 8};
+    auto           &r = target.get_renderer();
+    gfx::compositor layers{{8, 8}};
+    layers.add_layer([](gfx::renderer &lr, rect_t<int> const &region) {
+        lr.set_draw_color(gfx::color{0, 0, 255});
+        lr.fill_rect(region);
+    });
+    auto &overlay =
+        layers.add_layer([](gfx::renderer &lr, rect_t<int> const &) {
+            lr.set_draw_color(gfx::color{255, 255, 255, 128});
+            lr.fill_rect(rect_t<int>{{0, 0}, {4, 8}});
+        });
+
+    auto pixel = [&](int x) {
+        auto frame = target.frame();
+        auto at    = static_cast<size_t>(x) * 4;
+        return std::array<int, 3>{static_cast<int>(frame.pixels[at]),
+                                  static_cast<int>(frame.pixels[at + 1]),
+                                  static_cast<int>(frame.pixels[at + 2])};
+    };
+    layers.compose(r);
+    REQUIRE(pixel(6) == std::array<int, 3>{0, 0, 255});
+    if(layers.is_premultiplied()) {
+        // Blended once: half white over blue, not a darker quarter.
+        auto mixed = pixel(1);
+        REQUIRE(std::abs(mixed[0] - 128) <= 2);
+        REQUIRE(std::abs(mixed[1] - 128) <= 2);
+        REQUIRE(mixed[2] >= 253);
+    }
+
+    overlay.set_visible(false);
+    layers.compose(r);
+    REQUIRE(pixel(1) == std::array<int, 3>{0, 0, 255});
+}
+
+TEST_CASE("Premultiplied layers composite as if drawn directly",
+          "[compositor]") {
+    gfx::color const clear{0, 0, 0, 0};
+    gfx::color const black{0, 0, 0};
+    gfx::color const blue{0, 0, 255};
+    gfx::color const white{255, 255, 255, 128};
+    gfx::color const red{255, 0, 0, 64};
+    auto over = [](gfx::color src, gfx::color dst) {
+        return gfx::blend_pixel(gfx::straight_over, src, dst);
+    };
+    auto copy = [](gfx::color src, gfx::color dst) {
+        return gfx::blend_pixel(gfx::premultiplied_over, src, dst);
+    };
+    auto near = [](gfx::color a, gfx::color b, int tolerance) {
+        return std::abs(a.r - b.r) <= tolerance &&
+               std::abs(a.g - b.g) <= tolerance &&
+               std::abs(a.b - b.b) <= tolerance &&
+               std::abs(a.a - b.a) <= tolerance;
+    };
+
+    auto direct = over(red, over(white, over(blue, black)));
+    // Each layer is drawn into its own cleared target, the layers are
+    // copied into the cleared output, and the output onto the screen.
+    auto bottom = over(blue, clear);
+    auto top    = over(red, over(white, clear));
+    auto output = copy(top, copy(bottom, clear));
+    REQUIRE(near(copy(output, black), direct, 2));
+    REQUIRE(near(copy(top, blue), over(red, over(white, blue)), 2));
+    // Blending the layer as straight alpha multiplies by alpha twice.
+    REQUIRE_FALSE(near(over(top, blue), over(red, over(white, blue)), 16));
+}
+
+TEST_CASE("Render thread replays frames recorded in parallel",
+          "[gfx][headless]") {
+    gfx::gfx         gfx{0};
+    gfx::headless    target{32, 32};
+    gfx::thread_pool pool{3};
+    {
+        // Replayed here, on the thread that created the renderer.
+        gfx::render_thread render{target.get_renderer()};
+        std::thread        recorder{[&] {
+            for(int n = 0; n < 5; ++n) {
+                auto &frame = render.begin_frame();
+                frame.set_clear(gfx::color{0, 0, 0});
+                frame.set_list_count(4);
+                pool.parallel_for(4, [&frame](size_t i) {
+                    auto &list = frame.list(i);
+                    list.set_color({255, 255, 255});
+                    list.record_point({static_cast<float>(i), 0});
+                });
+                render.end_frame(frame);
+            }
+            render.stop();
+        }};
+        render.run();
+        recorder.join();
+        REQUIRE(render.get_stats().frames_recorded == 5);
+        REQUIRE(render.get_stats().frames_presented == 5);
+    }
+    REQUIRE(target.frame().pixels[3 * 4] == std::byte{255});
+
+    // The software renderer can also be driven from a thread of its own.
+    gfx::render_thread render{target.get_renderer(), true};
+    auto              &frame = render.begin_frame();
+    frame.set_clear(gfx::color{0, 0, 0});
+    render.end_frame(frame);
+    render.wait_idle();
+    REQUIRE(render.get_stats().frames_presented == 1);
+}
+
+TEST_CASE("Distance field measures distance to the edge", "[sdf]") {
+    constexpr int        size   = 32;
+    constexpr int        spread = 8;
+    std::vector<uint8_t> alpha(size * size, 0);
+    for(int y = 8; y < 24; ++y) {
+        for(int x = 8; x < 24; ++x) {
+            alpha[static_cast<size_t>(y * size + x)] = 255;
+        }
+    }
+    auto field = gfx::signed_distance_field(alpha, size, size, spread);
+    REQUIRE(field.size() == alpha.size());
+
+    auto at = [&field](int x, int y) {
+        return static_cast<int>(field[static_cast<size_t>(y * size + x)]);
+    };
+    // The edge lies at 128 between the last pixel in and the first out, and
+    // each pixel center from there adds 127 / spread.
+    REQUIRE(at(16, 16) == 255);
+    REQUIRE(at(0, 0) == 0);
+    REQUIRE(at(8, 16) + at(7, 16) == 256);
+    REQUIRE(std::abs(at(12, 16) - (128 + 127 * 5 / spread)) <= 1);
+    REQUIRE(std::abs(at(3, 16) - (128 - 127 * 5 / spread)) <= 1);
+    REQUIRE(at(16, 12) == at(12, 16));
+    REQUIRE(at(8, 8) > at(7, 7));
+}
+
+TEST_CASE("Resource registry maps each file once", "[resources]") {
+    auto path = (std::filesystem::temp_directory_path() / "gfx_registry_test")
+                    .string();
+    std::string contents = "not really a font";
+    std::ofstream{path, std::ios::binary} << contents;
+
+    gfx::resource_registry registry;
+    auto                   first  = registry.map(path);
+    auto                   second = registry.map(path);
+    REQUIRE(first == second);
+    REQUIRE(first->size() == contents.size());
+    REQUIRE(std::memcmp(first->data().data(), contents.data(),
+                        contents.size()) == 0);
+    REQUIRE(registry.get_stats().files_mapped == 1);
+    REQUIRE(registry.get_stats().bytes_mapped == contents.size());
+    REQUIRE_THROWS(registry.map(path + ".missing"));
+
+    // Trimming keeps mappings in use and drops the rest.
+    registry.trim();
+    REQUIRE(registry.map(path) == first);
+    first.reset();
+    second.reset();
+    registry.trim();
+    static_cast<void>(registry.map(path));
+    REQUIRE(registry.get_stats().files_mapped == 2);
+
+    // Images are decoded from a mapping of their own, dropped afterwards.
+    registry.trim();
+    REQUIRE_THROWS(registry.load_surface(path));
+    static_cast<void>(registry.map(path));
+    REQUIRE(registry.get_stats().files_mapped == 4);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Asset archive round-trips pre-decoded images", "[archive]") {
+    auto path =
+        (std::filesystem::temp_directory_path() / "gfx_archive_test").string();
+    std::vector<std::byte> red(3 * 2 * 4);
+    std::vector<std::byte> blue(5 * 1 * 4);
+    for(size_t i = 0; i < red.size(); i += 4) {
+        red[i]     = std::byte{0xFF};
+        red[i + 3] = std::byte{0xFF};
+    }
+    for(size_t i = 0; i < blue.size(); i += 4) {
+        blue[i + 2] = std::byte{0xFF};
+        blue[i + 3] = std::byte{0x80};
+    }
+
+    for(bool compress : {false, true}) {
+        if(compress && !gfx::archive_writer::can_compress()) {
+            continue;
+        }
+        gfx::archive_writer writer;
+        writer.add("sprites/red", 3, 2, red);
+        writer.add("blue", 5, 1, blue);
+        REQUIRE_THROWS(writer.add("wrong", 4, 4, red));
+        writer.save(path, compress);
+
+        gfx::asset_archive archive{path};
+        REQUIRE(archive.size() == 2);
+        REQUIRE(archive.name(0) == "blue");
+        REQUIRE(archive.contains("sprites/red"));
+        REQUIRE_FALSE(archive.contains("sprites"));
+        REQUIRE_THROWS(archive.is_compressed("missing"));
+
+        std::vector<std::byte> scratch;
+        auto                   image = archive.read("sprites/red", scratch);
+        REQUIRE(image.width == 3);
+        REQUIRE(image.height == 2);
+        REQUIRE(std::equal(image.pixels.begin(), image.pixels.end(),
+                           red.begin(), red.end()));
+        if(!compress) {
+            // Straight from the mapping, aligned for SDL.
+            REQUIRE(scratch.empty());
+            REQUIRE(reinterpret_cast<uintptr_t>(image.pixels.data()) % 64 ==
+                    0);
+        }
+        image = archive.read("blue", scratch);
+        REQUIRE(std::equal(image.pixels.begin(), image.pixels.end(),
+                           blue.begin(), blue.end()));
+        gfx::resource_registry::shared().trim();
+    }
+
+    // Sizes in the index that don't add up are rejected when opening.
+    gfx::archive_writer writer;
+    writer.add("blue", 5, 1, blue);
+    using field  = std::pair<size_t, uint32_t>;
+    auto corrupt = [&](std::initializer_list<field> fields) {
+        writer.save(path);
+        std::fstream file{path, std::ios::in | std::ios::out |
+                                    std::ios::binary};
+        for(auto [offset, value] : fields) {
+            file.seekp(static_cast<std::streamoff>(offset));
+            file.write(reinterpret_cast<char const *>(&value), sizeof value);
+        }
+        file.close();
+        bool thrown = false;
+        try {
+            gfx::asset_archive archive{path};
+        } catch(std::runtime_error const &) {
+            thrown = true;
+        }
+        gfx::resource_registry::shared().trim();
+        return thrown;
+    };
+    // The first entry follows a 32 byte header.
+    constexpr size_t width  = 32 + 24;
+    constexpr size_t height = 32 + 28;
+    constexpr size_t method = 32 + 32;
+    REQUIRE_FALSE(corrupt({{width, 5}}));
+    REQUIRE(corrupt({{width, 6}}));
+    REQUIRE(corrupt({{width, 0x40000000}}));
+    REQUIRE(corrupt({{height, 0xFFFFFFFF}}));
+    REQUIRE(corrupt({{method, 2}}));
+    // LZ4 can't have packed 20 bytes from more than 255 times that.
+    REQUIRE_FALSE(corrupt({{method, 1}, {width, 1275}}));
+    REQUIRE(corrupt({{method, 1}, {width, 1276}}));
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Handle pool defers destruction and rejects stale handles",
+          "[pool]") {
+    gfx::handle_pool<std::string> pool;
+    auto                          a = pool.create("a");
+    auto                          b = pool.create("b");
+    REQUIRE(pool.get(a) != nullptr);
+    REQUIRE(*pool.get(b) == "b");
+    REQUIRE_FALSE(pool.contains(gfx::handle_pool<std::string>::handle{}));
+
+    // Gone for lookups at once, destroyed only when collected.
+    pool.release(a);
+    pool.release(a);
+    REQUIRE(pool.get(a) == nullptr);
+    REQUIRE(pool.size() == 2);
+    REQUIRE(pool.pending() == 1);
+    pool.collect();
+    REQUIRE(pool.size() == 1);
+    REQUIRE(*pool.get(b) == "b");
+
+    // The slot is reused under a new generation.
+    auto c = pool.create("c");
+    REQUIRE(c.index() == a.index());
+    REQUIRE(c != a);
+    REQUIRE(pool.get(a) == nullptr);
+    REQUIRE(*pool.get(c) == "c");
+
+    std::string joined;
+    for(auto const &s : pool) {
+        joined += s;
+    }
+    std::sort(joined.begin(), joined.end());
+    REQUIRE(joined == "bc");
+}
+
+TEST_CASE("Frame arena destroys its objects on reset", "[pool]") {
+    struct counted {
+        int *destroyed;
+        explicit counted(int *d) : destroyed{d} {}
+        counted(counted const &)                     = delete;
+        auto operator=(counted const &) -> counted & = delete;
+        ~counted() { ++*destroyed; }
+    };
+
+    gfx::frame_arena arena{64};
+    int              destroyed = 0;
+    for(int i = 0; i < 10; ++i) {
+        static_cast<void>(arena.make<counted>(&destroyed));
+    }
+    std::pmr::vector<int> scratch{arena.resource()};
+    scratch.assign(100, 7);
+    REQUIRE(destroyed == 0);
+    scratch = std::pmr::vector<int>{arena.resource()};
+    arena.reset();
+    REQUIRE(destroyed == 10);
+    // The block grew to fit the frame, so the next one doesn't spill.
+    REQUIRE(arena.capacity() > 64);
+    REQUIRE(arena.used() == 0);
+}
+
+TEST_CASE("Sparse grid stores far apart cells in row-major order",
+          "[sparse]") {
+    // Neighbouring positions no longer collide and -0.0 hashes like 0.0.
+    std::set<size_t> hashes;
+    for(int y = -32; y < 32; ++y) {
+        for(int x = -32; x < 32; ++x) {
+            hashes.insert(vec2d_hasher<int>{}({x, y}) & 0xFFFFU);
+        }
+    }
+    REQUIRE(hashes.size() > 4096 * 9 / 10);
+    REQUIRE(vec2d_hasher<double>{}({-0.0, 1.0}) ==
+            vec2d_hasher<double>{}({0.0, 1.0}));
+
+    gfx::sparse_grid<int> grid;
+    std::vector<vec2d_t<int>> cells{{1000000, -5}, {-1, -1},  {0, 0},
+                                    {15, 0},       {16, 0},   {-17, 3},
+                                    {0, -1},       {-1000000, 2000000}};
+    for(size_t i = 0; i < cells.size(); ++i) {
+        grid.set(cells[i], static_cast<int>(i));
+    }
+    REQUIRE(grid.size() == cells.size());
+    REQUIRE(grid.chunk_count() == 7);
+    REQUIRE(*grid.find({-1, -1}) == 1);
+    REQUIRE(grid.find({-1, 0}) == nullptr);
+
+    std::vector<vec2d_t<int>> visited;
+    grid.for_each([&](vec2d_t<int> p, int &) { visited.push_back(p); });
+    std::sort(cells.begin(), cells.end());
+    REQUIRE(visited == cells);
+
+    int neighbours = 0;
+    grid.for_each_neighbor({0, 0}, [&](vec2d_t<int>, int &) { ++neighbours; });
+    REQUIRE(neighbours == 2);
+    neighbours = 0;
+    grid.for_each_neighbor({0, 0}, [&](vec2d_t<int>, int &) { ++neighbours; },
+                           false);
+    REQUIRE(neighbours == 1);
+
+    // Emptying chunks frees them without losing the cells probed past them.
+    REQUIRE(grid.erase({15, 0}));
+    REQUIRE(grid.erase({16, 0}));
+    REQUIRE(!grid.erase({16, 0}));
+    REQUIRE(grid.chunk_count() == 6);
+    for(auto p : std::vector<vec2d_t<int>>{{1000000, -5}, {-17, 3}, {0, -1}}) {
+        REQUIRE(grid.contains(p));
+    }
+    REQUIRE(grid.size() == cells.size() - 2);
+}
@@ -0,0 +1,77 @@
+// Packs images into an archive that asset_archive loads without decoding.
+//
+//   gfx_pack [--lz4] [--root DIR] OUTPUT IMAGE...
+//
+// Images are stored under their path relative to --root (the current
+// directory by default), with forward slashes. --lz4 compresses the images
+// it makes smaller, trading a little load time for disk space.
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "gfx/gfx.h"
+
+namespace {
+
+struct options {
+    bool                     compress{false};
+    std::filesystem::path    root{"."};
+    std::string              output;
+    std::vector<std::string> inputs;
+};
+
+auto parse(int argc, char **argv) -> options {
+    options opts;
+    for(int i = 1; i < argc; ++i) {
+        std::string_view arg{argv[i]};
+        if(arg == "--lz4") {
+            opts.compress = true;
+        } else if(arg == "--root" && i + 1 < argc) {
+            opts.root = argv[++i];
+        } else if(opts.output.empty()) {
+            opts.output = arg;
+        } else {
+            opts.inputs.emplace_back(arg);
+        }
+    }
+    if(opts.output.empty() || opts.inputs.empty()) {
+        throw std::runtime_error{
+            "usage: gfx_pack [--lz4] [--root DIR] OUTPUT IMAGE..."};
+    }
+    return opts;
+}
+
+} // namespace
+
+auto main(int argc, char **argv) -> int {
+    try {
+        auto opts = parse(argc, argv);
+
+        gfx::archive_writer writer;
+        size_t              bytes = 0;
+        for(auto const &input : opts.inputs) {
+            auto name = std::filesystem::relative(input, opts.root)
+                            .lexically_normal()
+                            .generic_string();
+            auto image = gfx::create_surface_from_file(input);
+            writer.add(name, *image);
+            auto *s = image->get_sdl_surface();
+            bytes   += static_cast<size_t>(s->w) * static_cast<size_t>(s->h) *
+                     gfx::bytes_per_pixel;
+        }
+        writer.save(opts.output, opts.compress);
+
+        fmt::print(stderr, "gfx_pack: {} images, {} KiB of pixels -> {}\n",
+                   writer.size(), bytes / 1024, opts.output);
+    } catch(std::exception const &e) {
+        fmt::print(stderr, "gfx_pack: {}\n", e.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}